@@ -0,0 +1,747 @@
+#ifndef ADAPTIVERADIXTREE_H
+#define ADAPTIVERADIXTREE_H
+
+#include "IDictionary.h"
+#include "IndexPair.h"
+#include "UnqPtr.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Ключ ART - восемь байт в порядке big-endian, так что лексикографический
+// порядок байт совпадает с порядком ключей. У знаковых целых инвертируется
+// знаковый бит, IndexPair упаковывается через IndexPair::Pack().
+template<typename TKey>
+struct ArtKeyTraits;
+
+template<typename TKey> requires std::is_integral_v<TKey>
+struct ArtKeyTraits<TKey> {
+    static_assert(sizeof(TKey) <= sizeof(uint64_t), "ART keys are at most 64 bits");
+
+    static uint64_t Encode(TKey key) {
+        if constexpr (std::is_signed_v<TKey>)
+            return static_cast<uint64_t>(static_cast<int64_t>(key)) ^ (uint64_t(1) << 63);
+        else
+            return static_cast<uint64_t>(key);
+    }
+
+    static TKey Decode(uint64_t encoded) {
+        if constexpr (std::is_signed_v<TKey>)
+            return static_cast<TKey>(static_cast<int64_t>(encoded ^ (uint64_t(1) << 63)));
+        else
+            return static_cast<TKey>(encoded);
+    }
+};
+
+template<>
+struct ArtKeyTraits<IndexPair> {
+    static uint64_t Encode(const IndexPair &key) {
+        return key.Pack();
+    }
+
+    static IndexPair Decode(uint64_t encoded) {
+        return IndexPair::Unpack(encoded);
+    }
+};
+
+// Адаптивное префиксное дерево (Leis et al., "The Adaptive Radix Tree").
+// Внутренний узел ветвится по одному байту ключа и меняет представление по
+// числу детей: Node4, Node16 (отсортированные массивы), Node48 (индекс на 256
+// байт) и Node256 (прямой массив). Общие байты пути хранятся в узле целиком
+// (сжатие пути), поэтому плотные диапазоны ключей занимают мало уровней.
+// Обход идёт по возрастанию ключей.
+template<typename TKey, typename TElement>
+class AdaptiveRadixTree : public IDictionary<TKey, TElement> {
+public:
+    AdaptiveRadixTree();
+
+    virtual ~AdaptiveRadixTree();
+
+    AdaptiveRadixTree(const AdaptiveRadixTree &) = delete;
+    AdaptiveRadixTree &operator=(const AdaptiveRadixTree &) = delete;
+
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const TKey &key) const override;
+
+    virtual bool ContainsKey(const TKey &key) const override;
+
+    virtual void Add(const TKey &key, const TElement &element) override;
+
+    virtual void Remove(const TKey &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
+
+    virtual bool IsOrdered() const override;
+
+    virtual TElement &operator[](const TKey &key) override;
+
+private:
+    using KeyTraits = ArtKeyTraits<TKey>;
+
+    static constexpr int KEY_BYTES = 8;
+
+    enum NodeType : uint8_t {
+        LEAF,
+        NODE4,
+        NODE16,
+        NODE48,
+        NODE256
+    };
+
+    struct Node {
+        NodeType type;
+        uint8_t prefixLength;
+        uint16_t childCount;
+        uint8_t prefix[KEY_BYTES];
+
+        explicit Node(NodeType type) : type(type), prefixLength(0), childCount(0), prefix() {}
+    };
+
+    struct Leaf : Node {
+        uint64_t key;
+        TElement value;
+
+        Leaf(uint64_t key, const TElement &value) : Node(LEAF), key(key), value(value) {}
+    };
+
+    struct Node4 : Node {
+        uint8_t keys[4];
+        Node *children[4];
+
+        Node4() : Node(NODE4), keys(), children() {}
+    };
+
+    struct Node16 : Node {
+        uint8_t keys[16];
+        Node *children[16];
+
+        Node16() : Node(NODE16), keys(), children() {}
+    };
+
+    struct Node48 : Node {
+        // 0 - нет ребёнка, иначе номер слота в children плюс один.
+        uint8_t childIndex[256];
+        Node *children[48];
+
+        Node48() : Node(NODE48), childIndex(), children() {}
+    };
+
+    struct Node256 : Node {
+        Node *children[256];
+
+        Node256() : Node(NODE256), children() {}
+    };
+
+    Node *root;
+    size_t count;
+
+    static uint8_t KeyByte(uint64_t key, int depth) {
+        return static_cast<uint8_t>(key >> (8 * (KEY_BYTES - 1 - depth)));
+    }
+
+    static int PrefixMismatch(const Node *node, uint64_t key, int depth);
+
+    static Node **FindChild(Node *node, uint8_t byte);
+
+    static const Leaf *FindLeaf(const Node *node, uint64_t key);
+
+    static void CopyHeader(Node *to, const Node *from);
+
+    static void AddChild(Node *&ref, uint8_t byte, Node *child);
+
+    static void RemoveChild(Node *&ref, uint8_t byte);
+
+    static void FreeNode(Node *node);
+
+    // Следующий по возрастанию байта ребёнок после позиции position.
+    static const Node *NextChild(const Node *node, int &position);
+
+    TElement &InsertImpl(Node *&ref, uint64_t key, int depth, const TElement &value, bool &inserted);
+
+    bool RemoveImpl(Node *&ref, uint64_t key, int depth);
+
+    class AdaptiveRadixTreeIterator : public IDictionaryIterator<TKey, TElement> {
+    public:
+        AdaptiveRadixTreeIterator(const AdaptiveRadixTree *tree);
+
+        virtual ~AdaptiveRadixTreeIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        struct StackEntry {
+            const Node *node;
+            int position;
+        };
+
+        const AdaptiveRadixTree *tree;
+        StackEntry stack[KEY_BYTES + 1];
+        int depth;
+        const Leaf *current;
+        bool started;
+    };
+};
+
+template<typename TKey, typename TElement>
+AdaptiveRadixTree<TKey, TElement>::AdaptiveRadixTree() : root(nullptr), count(0) {
+}
+
+template<typename TKey, typename TElement>
+AdaptiveRadixTree<TKey, TElement>::~AdaptiveRadixTree() {
+    FreeNode(root);
+}
+
+template<typename TKey, typename TElement>
+size_t AdaptiveRadixTree<TKey, TElement>::GetCount() const {
+    return count;
+}
+
+template<typename TKey, typename TElement>
+TElement AdaptiveRadixTree<TKey, TElement>::Get(const TKey &key) const {
+    const Leaf *leaf = FindLeaf(root, KeyTraits::Encode(key));
+    if (!leaf)
+        throw std::runtime_error("Key not found.");
+    return leaf->value;
+}
+
+template<typename TKey, typename TElement>
+bool AdaptiveRadixTree<TKey, TElement>::ContainsKey(const TKey &key) const {
+    return FindLeaf(root, KeyTraits::Encode(key)) != nullptr;
+}
+
+template<typename TKey, typename TElement>
+void AdaptiveRadixTree<TKey, TElement>::Add(const TKey &key, const TElement &element) {
+    bool inserted = false;
+    TElement &slot = InsertImpl(root, KeyTraits::Encode(key), 0, element, inserted);
+    if (!inserted)
+        slot = element;
+}
+
+template<typename TKey, typename TElement>
+void AdaptiveRadixTree<TKey, TElement>::Remove(const TKey &key) {
+    if (!RemoveImpl(root, KeyTraits::Encode(key), 0))
+        throw std::runtime_error("Key not found.");
+    --count;
+}
+
+template<typename TKey, typename TElement>
+TElement &AdaptiveRadixTree<TKey, TElement>::operator[](const TKey &key) {
+    bool inserted = false;
+    return InsertImpl(root, KeyTraits::Encode(key), 0, TElement(), inserted);
+}
+
+template<typename TKey, typename TElement>
+int AdaptiveRadixTree<TKey, TElement>::PrefixMismatch(const Node *node, uint64_t key, int depth) {
+    int matched = 0;
+    while (matched < node->prefixLength && node->prefix[matched] == KeyByte(key, depth + matched))
+        ++matched;
+    return matched;
+}
+
+template<typename TKey, typename TElement>
+typename AdaptiveRadixTree<TKey, TElement>::Node **
+AdaptiveRadixTree<TKey, TElement>::FindChild(Node *node, uint8_t byte) {
+    switch (node->type) {
+        case NODE4: {
+            Node4 *n = static_cast<Node4 *>(node);
+            for (int i = 0; i < n->childCount; ++i) {
+                if (n->keys[i] == byte)
+                    return &n->children[i];
+            }
+            return nullptr;
+        }
+        case NODE16: {
+            Node16 *n = static_cast<Node16 *>(node);
+#if defined(__SSE2__)
+            __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i *>(n->keys)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1u << n->childCount) - 1);
+            return mask ? &n->children[std::countr_zero(mask)] : nullptr;
+#else
+            for (int i = 0; i < n->childCount; ++i) {
+                if (n->keys[i] == byte)
+                    return &n->children[i];
+            }
+            return nullptr;
+#endif
+        }
+        case NODE48: {
+            Node48 *n = static_cast<Node48 *>(node);
+            return n->childIndex[byte] ? &n->children[n->childIndex[byte] - 1] : nullptr;
+        }
+        case NODE256: {
+            Node256 *n = static_cast<Node256 *>(node);
+            return n->children[byte] ? &n->children[byte] : nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+template<typename TKey, typename TElement>
+const typename AdaptiveRadixTree<TKey, TElement>::Leaf *
+AdaptiveRadixTree<TKey, TElement>::FindLeaf(const Node *node, uint64_t key) {
+    int depth = 0;
+    while (node) {
+        if (node->type == LEAF) {
+            const Leaf *leaf = static_cast<const Leaf *>(node);
+            return leaf->key == key ? leaf : nullptr;
+        }
+        if (PrefixMismatch(node, key, depth) != node->prefixLength)
+            return nullptr;
+        depth += node->prefixLength;
+        Node **child = FindChild(const_cast<Node *>(node), KeyByte(key, depth));
+        node = child ? *child : nullptr;
+        ++depth;
+    }
+    return nullptr;
+}
+
+template<typename TKey, typename TElement>
+void AdaptiveRadixTree<TKey, TElement>::CopyHeader(Node *to, const Node *from) {
+    to->prefixLength = from->prefixLength;
+    to->childCount = from->childCount;
+    std::memcpy(to->prefix, from->prefix, KEY_BYTES);
+}
+
+// Добавление ребёнка; заполненный узел заменяется следующим по размеру.
+template<typename TKey, typename TElement>
+void AdaptiveRadixTree<TKey, TElement>::AddChild(Node *&ref, uint8_t byte, Node *child) {
+    Node *node = ref;
+    switch (node->type) {
+        case NODE4: {
+            Node4 *n = static_cast<Node4 *>(node);
+            if (n->childCount < 4) {
+                int position = 0;
+                while (position < n->childCount && n->keys[position] < byte)
+                    ++position;
+                for (int i = n->childCount; i > position; --i) {
+                    n->keys[i] = n->keys[i - 1];
+                    n->children[i] = n->children[i - 1];
+                }
+                n->keys[position] = byte;
+                n->children[position] = child;
+                ++n->childCount;
+                return;
+            }
+            Node16 *grown = new Node16();
+            CopyHeader(grown, n);
+            std::memcpy(grown->keys, n->keys, sizeof(n->keys));
+            std::memcpy(grown->children, n->children, sizeof(n->children));
+            delete n;
+            ref = grown;
+            AddChild(ref, byte, child);
+            return;
+        }
+        case NODE16: {
+            Node16 *n = static_cast<Node16 *>(node);
+            if (n->childCount < 16) {
+                int position = 0;
+                while (position < n->childCount && n->keys[position] < byte)
+                    ++position;
+                for (int i = n->childCount; i > position; --i) {
+                    n->keys[i] = n->keys[i - 1];
+                    n->children[i] = n->children[i - 1];
+                }
+                n->keys[position] = byte;
+                n->children[position] = child;
+                ++n->childCount;
+                return;
+            }
+            Node48 *grown = new Node48();
+            CopyHeader(grown, n);
+            for (int i = 0; i < 16; ++i) {
+                grown->children[i] = n->children[i];
+                grown->childIndex[n->keys[i]] = static_cast<uint8_t>(i + 1);
+            }
+            delete n;
+            ref = grown;
+            AddChild(ref, byte, child);
+            return;
+        }
+        case NODE48: {
+            Node48 *n = static_cast<Node48 *>(node);
+            if (n->childCount < 48) {
+                int slot = 0;
+                while (n->children[slot])
+                    ++slot;
+                n->children[slot] = child;
+                n->childIndex[byte] = static_cast<uint8_t>(slot + 1);
+                ++n->childCount;
+                return;
+            }
+            Node256 *grown = new Node256();
+            CopyHeader(grown, n);
+            for (int b = 0; b < 256; ++b) {
+                if (n->childIndex[b])
+                    grown->children[b] = n->children[n->childIndex[b] - 1];
+            }
+            delete n;
+            ref = grown;
+            AddChild(ref, byte, child);
+            return;
+        }
+        case NODE256: {
+            Node256 *n = static_cast<Node256 *>(node);
+            n->children[byte] = child;
+            ++n->childCount;
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+// Удаление ребёнка; при малом числе детей узел заменяется меньшим, а Node4
+// с единственным ребёнком сливается с ним (префиксы склеиваются).
+template<typename TKey, typename TElement>
+void AdaptiveRadixTree<TKey, TElement>::RemoveChild(Node *&ref, uint8_t byte) {
+    Node *node = ref;
+    switch (node->type) {
+        case NODE4: {
+            Node4 *n = static_cast<Node4 *>(node);
+            int position = 0;
+            while (n->keys[position] != byte)
+                ++position;
+            for (int i = position + 1; i < n->childCount; ++i) {
+                n->keys[i - 1] = n->keys[i];
+                n->children[i - 1] = n->children[i];
+            }
+            --n->childCount;
+            if (n->childCount == 1) {
+                Node *only = n->children[0];
+                if (only->type != LEAF) {
+                    uint8_t prefix[KEY_BYTES];
+                    int length = n->prefixLength;
+                    std::memcpy(prefix, n->prefix, length);
+                    prefix[length++] = n->keys[0];
+                    std::memcpy(prefix + length, only->prefix, only->prefixLength);
+                    length += only->prefixLength;
+                    std::memcpy(only->prefix, prefix, length);
+                    only->prefixLength = static_cast<uint8_t>(length);
+                }
+                delete n;
+                ref = only;
+            }
+            return;
+        }
+        case NODE16: {
+            Node16 *n = static_cast<Node16 *>(node);
+            int position = 0;
+            while (n->keys[position] != byte)
+                ++position;
+            for (int i = position + 1; i < n->childCount; ++i) {
+                n->keys[i - 1] = n->keys[i];
+                n->children[i - 1] = n->children[i];
+            }
+            --n->childCount;
+            if (n->childCount == 3) {
+                Node4 *shrunk = new Node4();
+                CopyHeader(shrunk, n);
+                std::memcpy(shrunk->keys, n->keys, 3);
+                std::memcpy(shrunk->children, n->children, 3 * sizeof(Node *));
+                delete n;
+                ref = shrunk;
+            }
+            return;
+        }
+        case NODE48: {
+            Node48 *n = static_cast<Node48 *>(node);
+            n->children[n->childIndex[byte] - 1] = nullptr;
+            n->childIndex[byte] = 0;
+            --n->childCount;
+            if (n->childCount == 12) {
+                Node16 *shrunk = new Node16();
+                CopyHeader(shrunk, n);
+                int position = 0;
+                for (int b = 0; b < 256; ++b) {
+                    if (n->childIndex[b]) {
+                        shrunk->keys[position] = static_cast<uint8_t>(b);
+                        shrunk->children[position++] = n->children[n->childIndex[b] - 1];
+                    }
+                }
+                delete n;
+                ref = shrunk;
+            }
+            return;
+        }
+        case NODE256: {
+            Node256 *n = static_cast<Node256 *>(node);
+            n->children[byte] = nullptr;
+            --n->childCount;
+            if (n->childCount == 37) {
+                Node48 *shrunk = new Node48();
+                CopyHeader(shrunk, n);
+                int slot = 0;
+                for (int b = 0; b < 256; ++b) {
+                    if (n->children[b]) {
+                        shrunk->children[slot] = n->children[b];
+                        shrunk->childIndex[b] = static_cast<uint8_t>(++slot);
+                    }
+                }
+                delete n;
+                ref = shrunk;
+            }
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+template<typename TKey, typename TElement>
+void AdaptiveRadixTree<TKey, TElement>::FreeNode(Node *node) {
+    if (!node)
+        return;
+    switch (node->type) {
+        case LEAF:
+            delete static_cast<Leaf *>(node);
+            return;
+        case NODE4: {
+            Node4 *n = static_cast<Node4 *>(node);
+            for (int i = 0; i < n->childCount; ++i)
+                FreeNode(n->children[i]);
+            delete n;
+            return;
+        }
+        case NODE16: {
+            Node16 *n = static_cast<Node16 *>(node);
+            for (int i = 0; i < n->childCount; ++i)
+                FreeNode(n->children[i]);
+            delete n;
+            return;
+        }
+        case NODE48: {
+            Node48 *n = static_cast<Node48 *>(node);
+            for (int i = 0; i < 48; ++i)
+                FreeNode(n->children[i]);
+            delete n;
+            return;
+        }
+        case NODE256: {
+            Node256 *n = static_cast<Node256 *>(node);
+            for (int i = 0; i < 256; ++i)
+                FreeNode(n->children[i]);
+            delete n;
+            return;
+        }
+    }
+}
+
+template<typename TKey, typename TElement>
+const typename AdaptiveRadixTree<TKey, TElement>::Node *
+AdaptiveRadixTree<TKey, TElement>::NextChild(const Node *node, int &position) {
+    switch (node->type) {
+        case NODE4: {
+            const Node4 *n = static_cast<const Node4 *>(node);
+            return position < n->childCount ? n->children[position++] : nullptr;
+        }
+        case NODE16: {
+            const Node16 *n = static_cast<const Node16 *>(node);
+            return position < n->childCount ? n->children[position++] : nullptr;
+        }
+        case NODE48: {
+            const Node48 *n = static_cast<const Node48 *>(node);
+            while (position < 256) {
+                uint8_t slot = n->childIndex[position++];
+                if (slot)
+                    return n->children[slot - 1];
+            }
+            return nullptr;
+        }
+        case NODE256: {
+            const Node256 *n = static_cast<const Node256 *>(node);
+            while (position < 256) {
+                const Node *child = n->children[position++];
+                if (child)
+                    return child;
+            }
+            return nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+template<typename TKey, typename TElement>
+TElement &AdaptiveRadixTree<TKey, TElement>::InsertImpl(Node *&ref, uint64_t key, int depth, const TElement &value,
+                                                        bool &inserted) {
+    Node *node = ref;
+    if (!node) {
+        Leaf *leaf = new Leaf(key, value);
+        ref = leaf;
+        ++count;
+        inserted = true;
+        return leaf->value;
+    }
+
+    if (node->type == LEAF) {
+        Leaf *existing = static_cast<Leaf *>(node);
+        if (existing->key == key) {
+            inserted = false;
+            return existing->value;
+        }
+        // Два листа расходятся на первом отличающемся байте; общие байты
+        // становятся префиксом нового Node4.
+        Node4 *parent = new Node4();
+        int length = 0;
+        while (KeyByte(existing->key, depth + length) == KeyByte(key, depth + length)) {
+            parent->prefix[length] = KeyByte(key, depth + length);
+            ++length;
+        }
+        parent->prefixLength = static_cast<uint8_t>(length);
+        Leaf *leaf = new Leaf(key, value);
+        Node *parentNode = parent;
+        AddChild(parentNode, KeyByte(existing->key, depth + length), existing);
+        AddChild(parentNode, KeyByte(key, depth + length), leaf);
+        ref = parentNode;
+        ++count;
+        inserted = true;
+        return leaf->value;
+    }
+
+    int matched = PrefixMismatch(node, key, depth);
+    if (matched < node->prefixLength) {
+        // Ключ расходится со сжатым путём: путь разрезается новым Node4.
+        Node4 *parent = new Node4();
+        parent->prefixLength = static_cast<uint8_t>(matched);
+        std::memcpy(parent->prefix, node->prefix, matched);
+        uint8_t oldByte = node->prefix[matched];
+        node->prefixLength = static_cast<uint8_t>(node->prefixLength - matched - 1);
+        std::memmove(node->prefix, node->prefix + matched + 1, node->prefixLength);
+        Leaf *leaf = new Leaf(key, value);
+        Node *parentNode = parent;
+        AddChild(parentNode, oldByte, node);
+        AddChild(parentNode, KeyByte(key, depth + matched), leaf);
+        ref = parentNode;
+        ++count;
+        inserted = true;
+        return leaf->value;
+    }
+
+    depth += node->prefixLength;
+    uint8_t byte = KeyByte(key, depth);
+    Node **child = FindChild(node, byte);
+    if (child)
+        return InsertImpl(*child, key, depth + 1, value, inserted);
+
+    Leaf *leaf = new Leaf(key, value);
+    AddChild(ref, byte, leaf);
+    ++count;
+    inserted = true;
+    return leaf->value;
+}
+
+template<typename TKey, typename TElement>
+bool AdaptiveRadixTree<TKey, TElement>::RemoveImpl(Node *&ref, uint64_t key, int depth) {
+    Node *node = ref;
+    if (!node)
+        return false;
+    if (node->type == LEAF) {
+        if (static_cast<Leaf *>(node)->key != key)
+            return false;
+        delete static_cast<Leaf *>(node);
+        ref = nullptr;
+        return true;
+    }
+
+    if (PrefixMismatch(node, key, depth) != node->prefixLength)
+        return false;
+    depth += node->prefixLength;
+    uint8_t byte = KeyByte(key, depth);
+    Node **child = FindChild(node, byte);
+    if (!child)
+        return false;
+
+    if ((*child)->type == LEAF) {
+        Leaf *leaf = static_cast<Leaf *>(*child);
+        if (leaf->key != key)
+            return false;
+        delete leaf;
+        RemoveChild(ref, byte);
+        return true;
+    }
+    return RemoveImpl(*child, key, depth + 1);
+}
+
+template<typename TKey, typename TElement>
+AdaptiveRadixTree<TKey, TElement>::AdaptiveRadixTreeIterator::AdaptiveRadixTreeIterator(const AdaptiveRadixTree *tree)
+        : tree(tree), depth(0), current(nullptr), started(false) {
+}
+
+template<typename TKey, typename TElement>
+bool AdaptiveRadixTree<TKey, TElement>::AdaptiveRadixTreeIterator::MoveNext() {
+    if (!started) {
+        started = true;
+        depth = 0;
+        if (!tree->root)
+            return false;
+        if (tree->root->type == LEAF) {
+            current = static_cast<const Leaf *>(tree->root);
+            return true;
+        }
+        stack[depth++] = StackEntry{tree->root, 0};
+    }
+
+    while (depth > 0) {
+        StackEntry &top = stack[depth - 1];
+        const Node *child = NextChild(top.node, top.position);
+        if (!child) {
+            --depth;
+            continue;
+        }
+        if (child->type == LEAF) {
+            current = static_cast<const Leaf *>(child);
+            return true;
+        }
+        stack[depth++] = StackEntry{child, 0};
+    }
+    current = nullptr;
+    return false;
+}
+
+template<typename TKey, typename TElement>
+void AdaptiveRadixTree<TKey, TElement>::AdaptiveRadixTreeIterator::Reset() {
+    started = false;
+    depth = 0;
+    current = nullptr;
+}
+
+template<typename TKey, typename TElement>
+TKey AdaptiveRadixTree<TKey, TElement>::AdaptiveRadixTreeIterator::GetCurrentKey() const {
+    if (!current)
+        throw std::out_of_range("Iterator out of range");
+    return KeyTraits::Decode(current->key);
+}
+
+template<typename TKey, typename TElement>
+TElement AdaptiveRadixTree<TKey, TElement>::AdaptiveRadixTreeIterator::GetCurrentValue() const {
+    if (!current)
+        throw std::out_of_range("Iterator out of range");
+    return current->value;
+}
+
+template<typename TKey, typename TElement>
+bool AdaptiveRadixTree<TKey, TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IDictionaryIterator<TKey, TElement>> AdaptiveRadixTree<TKey, TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new AdaptiveRadixTreeIterator(this));
+}
+
+#endif // ADAPTIVERADIXTREE_H
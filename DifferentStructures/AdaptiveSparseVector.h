@@ -0,0 +1,438 @@
+#ifndef ADAPTIVESPARSEVECTOR_H
+#define ADAPTIVESPARSEVECTOR_H
+
+#include "CompressedSparseVector.h"
+#include "IDictionaryIterator.h"
+#include "UnqPtr.h"
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Разреженный вектор, который сам выбирает представление по числу ненулевых
+// элементов:
+// - Sparse: отсортированные массивы индексов и значений (CompressedSparseVector);
+// - Bitmap: блоки по 512 индексов, битовая маска и упакованные значения блока;
+// - Dense: обычный массив длины length.
+// Граница между соседними формами - число ненулевых, при котором они занимают
+// одинаковую память (плотной форме прощается перерасход DENSE_SLACK ради
+// доступа без поиска). Форма повышается при переходе через границу и
+// понижается, только когда число ненулевых упадёт ниже границы на четверть,
+// чтобы запись около границы не переключала форму туда и обратно.
+template<typename TElement>
+class AdaptiveSparseVector {
+public:
+    enum class Representation {
+        Sparse,
+        Bitmap,
+        Dense
+    };
+
+    explicit AdaptiveSparseVector(int length);
+
+    int GetLength() const;
+
+    size_t GetNonZeroCount() const;
+
+    TElement GetElement(int index) const;
+
+    void SetElement(int index, const TElement &value);
+
+    void RemoveElement(int index);
+
+    template<typename TFunc> requires std::invocable<TFunc &, int, const TElement &>
+    void ForEach(TFunc func) const;
+
+    template<typename TFunc> requires std::invocable<TFunc &, TElement>
+    void Map(TFunc func);
+
+    void MultiplyByScalar(TElement scalar);
+
+    template<typename TFunc> requires std::invocable<TFunc &, TElement, TElement>
+    TElement Reduce(TFunc func, TElement initial) const;
+
+    // Обход по возрастанию индексов; недействителен после записи.
+    UnqPtr<IDictionaryIterator<int, TElement>> GetIterator() const;
+
+    Representation GetRepresentation() const;
+
+    // Память текущего представления без самого объекта.
+    size_t GetMemoryBytes() const;
+
+private:
+    static constexpr int BLOCK_BITS = 512;
+    static constexpr int BLOCK_WORDS = BLOCK_BITS / 64;
+    static constexpr double DENSE_SLACK = 1.25;
+
+    struct Block {
+        uint64_t bits[BLOCK_WORDS] = {};
+        std::vector<TElement> values;
+    };
+
+    int length;
+    Representation form;
+    // Точное число ненулевых в формах Bitmap и Dense; в Sparse его знает sparse.
+    size_t nonZeroCount;
+    size_t bitmapThreshold;
+    size_t denseThreshold;
+    CompressedSparseVector<TElement> sparse;
+    std::vector<Block> blocks;
+    std::vector<TElement> dense;
+
+    void CheckIndex(int index) const;
+
+    // Позиция значения index в block.values среди предшествующих ему битов.
+    static int Rank(const Block &block, int offset);
+
+    Representation TargetRepresentation(size_t count) const;
+
+    void Rebalance();
+
+    void ConvertTo(Representation target);
+
+    class AdaptiveSparseVectorIterator : public IDictionaryIterator<int, TElement> {
+    public:
+        AdaptiveSparseVectorIterator(const AdaptiveSparseVector *vector);
+
+        virtual ~AdaptiveSparseVectorIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual int GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const AdaptiveSparseVector *vector;
+        long long position;
+    };
+};
+
+template<typename TElement>
+AdaptiveSparseVector<TElement>::AdaptiveSparseVector(int length)
+        : length(length), form(Representation::Sparse), nonZeroCount(0), sparse(length) {
+    double blockBytesPerIndex = static_cast<double>(sizeof(Block)) / BLOCK_BITS;
+    double elementBytes = static_cast<double>(sizeof(TElement));
+    // (sizeof(int) + E) * n = L * blockBytesPerIndex + E * n
+    bitmapThreshold = static_cast<size_t>(length * blockBytesPerIndex / sizeof(int));
+    // E * L = DENSE_SLACK * (L * blockBytesPerIndex + E * n)
+    double denseFraction = (elementBytes / DENSE_SLACK - blockBytesPerIndex) / elementBytes;
+    denseThreshold = static_cast<size_t>(std::max(0.0, denseFraction) * length);
+}
+
+template<typename TElement>
+void AdaptiveSparseVector<TElement>::CheckIndex(int index) const {
+    if (index < 0 || index >= length) {
+        throw std::out_of_range("Index is out of bounds.");
+    }
+}
+
+template<typename TElement>
+int AdaptiveSparseVector<TElement>::GetLength() const {
+    return length;
+}
+
+template<typename TElement>
+size_t AdaptiveSparseVector<TElement>::GetNonZeroCount() const {
+    return form == Representation::Sparse ? sparse.GetNonZeroCount() : nonZeroCount;
+}
+
+template<typename TElement>
+typename AdaptiveSparseVector<TElement>::Representation AdaptiveSparseVector<TElement>::GetRepresentation() const {
+    return form;
+}
+
+template<typename TElement>
+size_t AdaptiveSparseVector<TElement>::GetMemoryBytes() const {
+    switch (form) {
+        case Representation::Sparse:
+            return sparse.GetStoredCount() * (sizeof(int) + sizeof(TElement));
+        case Representation::Bitmap:
+            return blocks.size() * sizeof(Block) + nonZeroCount * sizeof(TElement);
+        default:
+            return dense.size() * sizeof(TElement);
+    }
+}
+
+template<typename TElement>
+int AdaptiveSparseVector<TElement>::Rank(const Block &block, int offset) {
+    int word = offset / 64;
+    int rank = 0;
+    for (int w = 0; w < word; ++w)
+        rank += std::popcount(block.bits[w]);
+    return rank + std::popcount(block.bits[word] & ((uint64_t(1) << (offset % 64)) - 1));
+}
+
+template<typename TElement>
+TElement AdaptiveSparseVector<TElement>::GetElement(int index) const {
+    CheckIndex(index);
+    switch (form) {
+        case Representation::Sparse:
+            return sparse.GetElement(index);
+        case Representation::Bitmap: {
+            const Block &block = blocks[index / BLOCK_BITS];
+            int offset = index % BLOCK_BITS;
+            if (!(block.bits[offset / 64] >> (offset % 64) & 1))
+                return TElement();
+            return block.values[Rank(block, offset)];
+        }
+        default:
+            return dense[index];
+    }
+}
+
+template<typename TElement>
+void AdaptiveSparseVector<TElement>::SetElement(int index, const TElement &value) {
+    CheckIndex(index);
+    switch (form) {
+        case Representation::Sparse:
+            sparse.SetElement(index, value);
+            // Оценка сверху растёт и от перезаписей в буфере, поэтому число
+            // ненулевых уточняется слиянием, только когда она выходит за границу
+            // с запасом в четверть: иначе у самой границы сливать пришлось бы
+            // почти на каждой записи.
+            if (sparse.GetStoredCount() > bitmapThreshold + bitmapThreshold / 4)
+                Rebalance();
+            return;
+        case Representation::Bitmap: {
+            Block &block = blocks[index / BLOCK_BITS];
+            int offset = index % BLOCK_BITS;
+            uint64_t mask = uint64_t(1) << (offset % 64);
+            bool present = block.bits[offset / 64] & mask;
+            int rank = Rank(block, offset);
+            if (value != TElement()) {
+                if (present) {
+                    block.values[rank] = value;
+                    return;
+                }
+                block.bits[offset / 64] |= mask;
+                block.values.insert(block.values.begin() + rank, value);
+                ++nonZeroCount;
+            } else {
+                if (!present)
+                    return;
+                block.bits[offset / 64] &= ~mask;
+                block.values.erase(block.values.begin() + rank);
+                --nonZeroCount;
+            }
+            break;
+        }
+        default: {
+            bool wasZero = dense[index] == TElement();
+            bool isZero = value == TElement();
+            dense[index] = value;
+            if (wasZero == isZero)
+                return;
+            isZero ? --nonZeroCount : ++nonZeroCount;
+            break;
+        }
+    }
+    Rebalance();
+}
+
+template<typename TElement>
+void AdaptiveSparseVector<TElement>::RemoveElement(int index) {
+    SetElement(index, TElement());
+}
+
+template<typename TElement>
+typename AdaptiveSparseVector<TElement>::Representation AdaptiveSparseVector<TElement>::TargetRepresentation(size_t count) const {
+    Representation target = form;
+    if (count > denseThreshold)
+        target = Representation::Dense;
+    else if (count > bitmapThreshold && form == Representation::Sparse)
+        target = Representation::Bitmap;
+
+    if (form == Representation::Dense && count < denseThreshold / 4 * 3)
+        target = Representation::Bitmap;
+    if (target == Representation::Bitmap && count < bitmapThreshold / 4 * 3)
+        target = Representation::Sparse;
+    return target;
+}
+
+template<typename TElement>
+void AdaptiveSparseVector<TElement>::Rebalance() {
+    Representation target = TargetRepresentation(GetNonZeroCount());
+    if (target != form)
+        ConvertTo(target);
+}
+
+// Элементы переносятся по возрастанию индексов, поэтому каждая форма
+// заполняется дописыванием в конец.
+template<typename TElement>
+void AdaptiveSparseVector<TElement>::ConvertTo(Representation target) {
+    size_t count = GetNonZeroCount();
+    CompressedSparseVector<TElement> newSparse(length);
+    std::vector<Block> newBlocks;
+    std::vector<TElement> newDense;
+    if (target == Representation::Bitmap)
+        newBlocks.resize((static_cast<size_t>(length) + BLOCK_BITS - 1) / BLOCK_BITS);
+    else if (target == Representation::Dense)
+        newDense.assign(length, TElement());
+
+    ForEach([&](int index, const TElement &value) {
+        switch (target) {
+            case Representation::Sparse:
+                newSparse.SetElement(index, value);
+                break;
+            case Representation::Bitmap: {
+                Block &block = newBlocks[index / BLOCK_BITS];
+                int offset = index % BLOCK_BITS;
+                block.bits[offset / 64] |= uint64_t(1) << (offset % 64);
+                block.values.push_back(value);
+                break;
+            }
+            default:
+                newDense[index] = value;
+                break;
+        }
+    });
+
+    sparse = std::move(newSparse);
+    blocks.swap(newBlocks);
+    dense.swap(newDense);
+    form = target;
+    nonZeroCount = count;
+}
+
+template<typename TElement>
+template<typename TFunc> requires std::invocable<TFunc &, int, const TElement &>
+void AdaptiveSparseVector<TElement>::ForEach(TFunc func) const {
+    switch (form) {
+        case Representation::Sparse:
+            sparse.ForEach(func);
+            return;
+        case Representation::Bitmap:
+            for (size_t b = 0; b < blocks.size(); ++b) {
+                const Block &block = blocks[b];
+                int rank = 0;
+                for (int w = 0; w < BLOCK_WORDS; ++w) {
+                    for (uint64_t bits = block.bits[w]; bits != 0; bits &= bits - 1) {
+                        int index = static_cast<int>(b * BLOCK_BITS) + w * 64 + std::countr_zero(bits);
+                        func(index, block.values[rank++]);
+                    }
+                }
+            }
+            return;
+        default:
+            for (int index = 0; index < length; ++index) {
+                if (dense[index] != TElement())
+                    func(index, dense[index]);
+            }
+            return;
+    }
+}
+
+// Как и в SparseVector, func применяется только к ненулевым элементам, а
+// обнулившиеся удаляются.
+template<typename TElement>
+template<typename TFunc> requires std::invocable<TFunc &, TElement>
+void AdaptiveSparseVector<TElement>::Map(TFunc func) {
+    switch (form) {
+        case Representation::Sparse:
+            sparse.Map(func);
+            return;
+        case Representation::Bitmap:
+            for (Block &block : blocks) {
+                size_t rank = 0;
+                size_t kept = 0;
+                for (int w = 0; w < BLOCK_WORDS; ++w) {
+                    for (uint64_t bits = block.bits[w]; bits != 0; bits &= bits - 1) {
+                        TElement mapped = func(block.values[rank++]);
+                        if (mapped == TElement()) {
+                            block.bits[w] &= ~(bits & -bits);
+                            --nonZeroCount;
+                        } else {
+                            block.values[kept++] = mapped;
+                        }
+                    }
+                }
+                block.values.resize(kept);
+            }
+            break;
+        default:
+            for (TElement &value : dense) {
+                if (value == TElement())
+                    continue;
+                value = func(value);
+                if (value == TElement())
+                    --nonZeroCount;
+            }
+            break;
+    }
+    Rebalance();
+}
+
+template<typename TElement>
+void AdaptiveSparseVector<TElement>::MultiplyByScalar(TElement scalar) {
+    Map([scalar](TElement x) { return x * scalar; });
+}
+
+template<typename TElement>
+template<typename TFunc> requires std::invocable<TFunc &, TElement, TElement>
+TElement AdaptiveSparseVector<TElement>::Reduce(TFunc func, TElement initial) const {
+    TElement result = initial;
+    ForEach([&](int, const TElement &value) { result = func(result, value); });
+    return result;
+}
+
+template<typename TElement>
+UnqPtr<IDictionaryIterator<int, TElement>> AdaptiveSparseVector<TElement>::GetIterator() const {
+    if (form == Representation::Sparse)
+        return sparse.GetIterator();
+    return UnqPtr<IDictionaryIterator<int, TElement>>(new AdaptiveSparseVectorIterator(this));
+}
+
+template<typename TElement>
+AdaptiveSparseVector<TElement>::AdaptiveSparseVectorIterator::AdaptiveSparseVectorIterator(
+        const AdaptiveSparseVector *vector)
+        : vector(vector), position(-1) {
+}
+
+// Следующий ненулевой индекс: в форме Bitmap - следующий установленный бит.
+template<typename TElement>
+bool AdaptiveSparseVector<TElement>::AdaptiveSparseVectorIterator::MoveNext() {
+    long long length = vector->length;
+    while (++position < length) {
+        if (vector->form == Representation::Dense) {
+            if (vector->dense[position] != TElement())
+                return true;
+            continue;
+        }
+        const Block &block = vector->blocks[position / BLOCK_BITS];
+        int offset = static_cast<int>(position % BLOCK_BITS);
+        uint64_t bits = block.bits[offset / 64] >> (offset % 64);
+        if (bits != 0) {
+            position += std::countr_zero(bits);
+            return true;
+        }
+        position += 63 - offset % 64;
+    }
+    position = length;
+    return false;
+}
+
+template<typename TElement>
+void AdaptiveSparseVector<TElement>::AdaptiveSparseVectorIterator::Reset() {
+    position = -1;
+}
+
+template<typename TElement>
+int AdaptiveSparseVector<TElement>::AdaptiveSparseVectorIterator::GetCurrentKey() const {
+    if (position < 0 || position >= vector->length)
+        throw std::out_of_range("Iterator out of range");
+    return static_cast<int>(position);
+}
+
+template<typename TElement>
+TElement AdaptiveSparseVector<TElement>::AdaptiveSparseVectorIterator::GetCurrentValue() const {
+    if (position < 0 || position >= vector->length)
+        throw std::out_of_range("Iterator out of range");
+    return vector->GetElement(static_cast<int>(position));
+}
+
+#endif // ADAPTIVESPARSEVECTOR_H
@@ -0,0 +1,551 @@
+#ifndef BEPSILONTREE_H
+#define BEPSILONTREE_H
+
+#include "IDictionary.h"
+#include "KeyValue.h"
+#include "UnqPtr.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// B^ε-дерево, оптимизированное для записи. Внутренние узлы хранят буфер
+// сообщений (вставка, обновление, удаление), отсортированный по ключу.
+// Изменение попадает в буфер корня; когда буфер переполняется, самая большая
+// группа сообщений одного ребёнка сбрасывается в него пакетом. Так случайные
+// обновления листьев заменяются редкими пакетными слияниями.
+// Поиск на пути вниз проверяет буферы: сообщение выше по дереву новее.
+// Узлы не объединяются; удалённые ключи просто исчезают из листьев.
+// Число ключей точное: сообщение сверяется с ключами листа, когда пакет
+// применяется к нему, и там же меняет счётчик.
+template<typename TKey, typename TElement>
+class BEpsilonTree : public IDictionary<TKey, TElement> {
+public:
+    BEpsilonTree(int fanout = 16, int bufferCapacity = 1024, int leafCapacity = 64);
+
+    virtual ~BEpsilonTree() {}
+
+    BEpsilonTree(const BEpsilonTree &) = delete;
+    BEpsilonTree &operator=(const BEpsilonTree &) = delete;
+
+    // Число ключей с учётом буферов. Сначала до листьев доходят сообщения
+    // из ещё не сброшенных ветвей (только из них), поэтому после вызова
+    // ссылки из operator[] недействительны, как после изменения.
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const TKey &key) const override;
+
+    virtual bool ContainsKey(const TKey &key) const override;
+
+    // Вставка или обновление без чтения листа.
+    virtual void Add(const TKey &key, const TElement &element) override;
+
+    virtual void Remove(const TKey &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
+
+    virtual bool IsOrdered() const override;
+
+    // Проталкивает сообщения для key до листа и возвращает ссылку на значение
+    // в листе. Ссылка действительна до следующего изменения дерева.
+    virtual TElement &operator[](const TKey &key) override;
+
+    // Удаление без проверки наличия ключа.
+    void Erase(const TKey &key);
+
+    // Сбрасывает все буферы в листья.
+    void FlushAll();
+
+private:
+    struct Message {
+        TKey key;
+        TElement value;
+        bool erase;
+    };
+
+    struct Node {
+        bool isLeaf;
+        // В листе - ключи, во внутреннем узле - разделители детей.
+        std::vector<TKey> keys;
+        std::vector<TElement> values;
+        std::vector<UnqPtr<Node>> children;
+        std::vector<Message> buffer;
+        // В буфере этого узла или ниже могут быть сообщения. Оценка сверху:
+        // флаг снимается только полным сбросом поддерева.
+        bool hasPending;
+
+        explicit Node(bool leaf) : isLeaf(leaf), hasPending(false) {}
+    };
+
+    UnqPtr<Node> root;
+    int fanout;
+    int bufferCapacity;
+    int leafCapacity;
+    // Ключей в листьях; сообщения в буферах ещё не учтены.
+    size_t count;
+
+    void Apply(const Message &message);
+
+    int ChildIndex(const Node *node, const TKey &key) const;
+
+    bool Lookup(const TKey &key, TElement &value) const;
+
+    bool Oversized(const Node *node) const;
+
+    void FlushNode(Node *node, size_t limit);
+
+    void FlushSubtree(Node *node);
+
+    void Deliver(Node *child, typename std::vector<Message>::iterator begin,
+                 typename std::vector<Message>::iterator end);
+
+    static void InsertIntoBuffer(Node *node, const Message &message);
+
+    void ApplyToLeaf(Node *leaf, typename std::vector<Message>::const_iterator begin,
+                     typename std::vector<Message>::const_iterator end);
+
+    void SplitOversized(Node *parent, int index);
+
+    void SplitChild(Node *parent, int index);
+
+    void GrowRoot();
+
+    void Collect(const Node *node, std::vector<KeyValue<TKey, TElement>> &out) const;
+
+    class BEpsilonTreeIterator : public IDictionaryIterator<TKey, TElement> {
+    public:
+        BEpsilonTreeIterator(const BEpsilonTree *tree);
+
+        virtual ~BEpsilonTreeIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        std::vector<KeyValue<TKey, TElement>> entries;
+        size_t position;
+    };
+};
+
+template<typename TKey, typename TElement>
+BEpsilonTree<TKey, TElement>::BEpsilonTree(int fanout, int bufferCapacity, int leafCapacity)
+        : root(new Node(true)), fanout(fanout < 3 ? 3 : fanout),
+          bufferCapacity(bufferCapacity < fanout ? fanout : bufferCapacity),
+          leafCapacity(leafCapacity < 2 ? 2 : leafCapacity), count(0) {
+}
+
+template<typename TKey, typename TElement>
+size_t BEpsilonTree<TKey, TElement>::GetCount() const {
+    if (root->hasPending)
+        const_cast<BEpsilonTree *>(this)->FlushAll();
+    return count;
+}
+
+template<typename TKey, typename TElement>
+TElement BEpsilonTree<TKey, TElement>::Get(const TKey &key) const {
+    TElement value;
+    if (!Lookup(key, value))
+        throw std::runtime_error("Key not found.");
+    return value;
+}
+
+template<typename TKey, typename TElement>
+bool BEpsilonTree<TKey, TElement>::ContainsKey(const TKey &key) const {
+    TElement value;
+    return Lookup(key, value);
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::Add(const TKey &key, const TElement &element) {
+    Apply(Message{key, element, false});
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::Remove(const TKey &key) {
+    if (!ContainsKey(key))
+        throw std::runtime_error("Key not found.");
+    Apply(Message{key, TElement(), true});
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::Erase(const TKey &key) {
+    Apply(Message{key, TElement(), true});
+}
+
+template<typename TKey, typename TElement>
+TElement &BEpsilonTree<TKey, TElement>::operator[](const TKey &key) {
+    std::vector<Node *> path;
+    std::vector<int> indices;
+    Message carried{key, TElement(), true};
+    bool hasCarried = false;
+
+    // Забираем сообщения для key из буферов на пути; верхнее - самое новое.
+    Node *node = root.get();
+    while (!node->isLeaf) {
+        auto it = std::lower_bound(node->buffer.begin(), node->buffer.end(), key,
+                                   [](const Message &m, const TKey &k) { return m.key < k; });
+        if (it != node->buffer.end() && it->key == key) {
+            if (!hasCarried) {
+                carried = *it;
+                hasCarried = true;
+            }
+            node->buffer.erase(it);
+        }
+        int index = ChildIndex(node, key);
+        path.push_back(node);
+        indices.push_back(index);
+        node = node->children[index].get();
+    }
+
+    auto pos = std::lower_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin();
+    bool exists = pos < static_cast<long>(node->keys.size()) && node->keys[pos] == key;
+    TElement value = hasCarried && !carried.erase ? carried.value : TElement();
+    if (exists) {
+        if (hasCarried)
+            node->values[pos] = value;
+    } else {
+        node->keys.insert(node->keys.begin() + pos, key);
+        node->values.insert(node->values.begin() + pos, value);
+        ++count;
+    }
+
+    if (Oversized(node)) {
+        for (int depth = static_cast<int>(path.size()) - 1; depth >= 0; --depth)
+            SplitOversized(path[depth], indices[depth]);
+        GrowRoot();
+    }
+
+    node = root.get();
+    while (!node->isLeaf)
+        node = node->children[ChildIndex(node, key)].get();
+    pos = std::lower_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin();
+    return node->values[pos];
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::FlushAll() {
+    if (root->isLeaf)
+        return;
+    FlushSubtree(root.get());
+    GrowRoot();
+}
+
+// Поддеревья без сообщений пропускаются, поэтому после нескольких записей
+// сброс проходит только по путям, куда эти сообщения ушли.
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::FlushSubtree(Node *node) {
+    if (!node->hasPending)
+        return;
+    FlushNode(node, 0);
+    node->hasPending = false;
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        if (node->children[i]->isLeaf || !node->children[i]->hasPending)
+            continue;
+        FlushSubtree(node->children[i].get());
+        size_t before = node->children.size();
+        SplitOversized(node, static_cast<int>(i));
+        i += node->children.size() - before;
+    }
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::Apply(const Message &message) {
+    Node *node = root.get();
+    if (node->isLeaf) {
+        std::vector<Message> single(1, message);
+        ApplyToLeaf(node, single.cbegin(), single.cend());
+    } else {
+        InsertIntoBuffer(node, message);
+        if (node->buffer.size() > static_cast<size_t>(bufferCapacity))
+            FlushNode(node, bufferCapacity);
+    }
+    GrowRoot();
+}
+
+template<typename TKey, typename TElement>
+int BEpsilonTree<TKey, TElement>::ChildIndex(const Node *node, const TKey &key) const {
+    return static_cast<int>(std::upper_bound(node->keys.begin(), node->keys.end(), key) - node->keys.begin());
+}
+
+template<typename TKey, typename TElement>
+bool BEpsilonTree<TKey, TElement>::Lookup(const TKey &key, TElement &value) const {
+    const Node *node = root.get();
+    while (!node->isLeaf) {
+        auto it = std::lower_bound(node->buffer.begin(), node->buffer.end(), key,
+                                   [](const Message &m, const TKey &k) { return m.key < k; });
+        if (it != node->buffer.end() && it->key == key) {
+            if (it->erase)
+                return false;
+            value = it->value;
+            return true;
+        }
+        node = node->children[ChildIndex(node, key)].get();
+    }
+    auto it = std::lower_bound(node->keys.begin(), node->keys.end(), key);
+    if (it == node->keys.end() || !(*it == key))
+        return false;
+    value = node->values[it - node->keys.begin()];
+    return true;
+}
+
+template<typename TKey, typename TElement>
+bool BEpsilonTree<TKey, TElement>::Oversized(const Node *node) const {
+    if (node->isLeaf)
+        return node->keys.size() > static_cast<size_t>(leafCapacity);
+    return node->children.size() > static_cast<size_t>(fanout);
+}
+
+// Пока в буфере больше limit сообщений, пакет для ребёнка с наибольшим числом
+// сообщений уходит вниз. Переполненные после этого дети расщепляются.
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::FlushNode(Node *node, size_t limit) {
+    while (node->buffer.size() > limit) {
+        int best = 0;
+        size_t bestBegin = 0, bestEnd = 0, begin = 0;
+        int childCount = static_cast<int>(node->children.size());
+        for (int i = 0; i < childCount && begin < node->buffer.size(); ++i) {
+            size_t end = node->buffer.size();
+            if (i < childCount - 1) {
+                const TKey &pivot = node->keys[i];
+                end = std::lower_bound(node->buffer.begin() + begin, node->buffer.end(), pivot,
+                                       [](const Message &m, const TKey &k) { return m.key < k; }) -
+                      node->buffer.begin();
+            }
+            if (end - begin > bestEnd - bestBegin) {
+                best = i;
+                bestBegin = begin;
+                bestEnd = end;
+            }
+            begin = end;
+        }
+
+        Deliver(node->children[best].get(), node->buffer.begin() + bestBegin, node->buffer.begin() + bestEnd);
+        node->buffer.erase(node->buffer.begin() + bestBegin, node->buffer.begin() + bestEnd);
+        SplitOversized(node, best);
+    }
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::Deliver(Node *child, typename std::vector<Message>::iterator begin,
+                                          typename std::vector<Message>::iterator end) {
+    if (child->isLeaf) {
+        ApplyToLeaf(child, begin, end);
+        return;
+    }
+
+    // Слияние двух отсортированных буферов; сообщения родителя новее.
+    child->hasPending = true;
+    std::vector<Message> merged;
+    merged.reserve(child->buffer.size() + (end - begin));
+    auto own = child->buffer.begin();
+    for (auto it = begin; it != end; ++it) {
+        while (own != child->buffer.end() && own->key < it->key)
+            merged.push_back(std::move(*own++));
+        if (own != child->buffer.end() && own->key == it->key)
+            ++own;
+        merged.push_back(std::move(*it));
+    }
+    while (own != child->buffer.end())
+        merged.push_back(std::move(*own++));
+    child->buffer.swap(merged);
+
+    if (child->buffer.size() > static_cast<size_t>(bufferCapacity))
+        FlushNode(child, bufferCapacity);
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::InsertIntoBuffer(Node *node, const Message &message) {
+    auto it = std::lower_bound(node->buffer.begin(), node->buffer.end(), message.key,
+                               [](const Message &m, const TKey &k) { return m.key < k; });
+    if (it != node->buffer.end() && it->key == message.key)
+        *it = message;
+    else
+        node->buffer.insert(it, message);
+    node->hasPending = true;
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::ApplyToLeaf(Node *leaf, typename std::vector<Message>::const_iterator begin,
+                                              typename std::vector<Message>::const_iterator end) {
+    if (end - begin == 1) {
+        auto pos = std::lower_bound(leaf->keys.begin(), leaf->keys.end(), begin->key) - leaf->keys.begin();
+        bool exists = pos < static_cast<long>(leaf->keys.size()) && leaf->keys[pos] == begin->key;
+        if (begin->erase) {
+            if (exists) {
+                leaf->keys.erase(leaf->keys.begin() + pos);
+                leaf->values.erase(leaf->values.begin() + pos);
+                --count;
+            }
+        } else if (exists) {
+            leaf->values[pos] = begin->value;
+        } else {
+            leaf->keys.insert(leaf->keys.begin() + pos, begin->key);
+            leaf->values.insert(leaf->values.begin() + pos, begin->value);
+            ++count;
+        }
+        return;
+    }
+
+    std::vector<TKey> keys;
+    std::vector<TElement> values;
+    keys.reserve(leaf->keys.size() + (end - begin));
+    values.reserve(leaf->keys.size() + (end - begin));
+    size_t i = 0;
+    for (auto it = begin; it != end; ++it) {
+        while (i < leaf->keys.size() && leaf->keys[i] < it->key) {
+            keys.push_back(std::move(leaf->keys[i]));
+            values.push_back(std::move(leaf->values[i]));
+            ++i;
+        }
+        bool exists = i < leaf->keys.size() && leaf->keys[i] == it->key;
+        if (exists)
+            ++i;
+        if (!it->erase) {
+            keys.push_back(it->key);
+            values.push_back(it->value);
+            if (!exists)
+                ++count;
+        } else if (exists) {
+            --count;
+        }
+    }
+    for (; i < leaf->keys.size(); ++i) {
+        keys.push_back(std::move(leaf->keys[i]));
+        values.push_back(std::move(leaf->values[i]));
+    }
+    leaf->keys.swap(keys);
+    leaf->values.swap(values);
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::SplitOversized(Node *parent, int index) {
+    int last = index;
+    while (index <= last) {
+        if (Oversized(parent->children[index].get())) {
+            SplitChild(parent, index);
+            ++last;
+        } else {
+            ++index;
+        }
+    }
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::SplitChild(Node *parent, int index) {
+    Node *left = parent->children[index].get();
+    UnqPtr<Node> right(new Node(left->isLeaf));
+    TKey separator;
+
+    if (left->isLeaf) {
+        size_t mid = left->keys.size() / 2;
+        right->keys.assign(std::make_move_iterator(left->keys.begin() + mid),
+                           std::make_move_iterator(left->keys.end()));
+        right->values.assign(std::make_move_iterator(left->values.begin() + mid),
+                             std::make_move_iterator(left->values.end()));
+        left->keys.resize(mid);
+        left->values.resize(mid);
+        separator = right->keys.front();
+    } else {
+        size_t mid = left->children.size() / 2;
+        separator = left->keys[mid - 1];
+        right->keys.assign(std::make_move_iterator(left->keys.begin() + mid),
+                           std::make_move_iterator(left->keys.end()));
+        left->keys.resize(mid - 1);
+        for (size_t i = mid; i < left->children.size(); ++i)
+            right->children.push_back(std::move(left->children[i]));
+        left->children.resize(mid);
+
+        auto split = std::lower_bound(left->buffer.begin(), left->buffer.end(), separator,
+                                      [](const Message &m, const TKey &k) { return m.key < k; });
+        right->buffer.assign(std::make_move_iterator(split), std::make_move_iterator(left->buffer.end()));
+        left->buffer.erase(split, left->buffer.end());
+        right->hasPending = left->hasPending;
+    }
+
+    parent->keys.insert(parent->keys.begin() + index, separator);
+    parent->children.insert(parent->children.begin() + index + 1, std::move(right));
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::GrowRoot() {
+    while (Oversized(root.get())) {
+        UnqPtr<Node> newRoot(new Node(false));
+        newRoot->hasPending = root->hasPending;
+        newRoot->children.push_back(std::move(root));
+        root = std::move(newRoot);
+        SplitOversized(root.get(), 0);
+    }
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::Collect(const Node *node, std::vector<KeyValue<TKey, TElement>> &out) const {
+    if (node->isLeaf) {
+        for (size_t i = 0; i < node->keys.size(); ++i)
+            out.push_back(KeyValue<TKey, TElement>(node->keys[i], node->values[i]));
+        return;
+    }
+
+    std::vector<KeyValue<TKey, TElement>> below;
+    for (size_t i = 0; i < node->children.size(); ++i)
+        Collect(node->children[i].get(), below);
+
+    size_t j = 0;
+    for (const Message &message : node->buffer) {
+        while (j < below.size() && below[j].key < message.key)
+            out.push_back(std::move(below[j++]));
+        if (j < below.size() && below[j].key == message.key)
+            ++j;
+        if (!message.erase)
+            out.push_back(KeyValue<TKey, TElement>(message.key, message.value));
+    }
+    while (j < below.size())
+        out.push_back(std::move(below[j++]));
+}
+
+template<typename TKey, typename TElement>
+BEpsilonTree<TKey, TElement>::BEpsilonTreeIterator::BEpsilonTreeIterator(const BEpsilonTree *tree) : position(0) {
+    tree->Collect(tree->root.get(), entries);
+}
+
+template<typename TKey, typename TElement>
+bool BEpsilonTree<TKey, TElement>::BEpsilonTreeIterator::MoveNext() {
+    if (position >= entries.size())
+        return false;
+    ++position;
+    return true;
+}
+
+template<typename TKey, typename TElement>
+void BEpsilonTree<TKey, TElement>::BEpsilonTreeIterator::Reset() {
+    position = 0;
+}
+
+template<typename TKey, typename TElement>
+TKey BEpsilonTree<TKey, TElement>::BEpsilonTreeIterator::GetCurrentKey() const {
+    if (position == 0 || position > entries.size())
+        throw std::out_of_range("Iterator out of range");
+    return entries[position - 1].key;
+}
+
+template<typename TKey, typename TElement>
+TElement BEpsilonTree<TKey, TElement>::BEpsilonTreeIterator::GetCurrentValue() const {
+    if (position == 0 || position > entries.size())
+        throw std::out_of_range("Iterator out of range");
+    return entries[position - 1].value;
+}
+
+template<typename TKey, typename TElement>
+bool BEpsilonTree<TKey, TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IDictionaryIterator<TKey, TElement>> BEpsilonTree<TKey, TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new BEpsilonTreeIterator(this));
+}
+
+#endif // BEPSILONTREE_H
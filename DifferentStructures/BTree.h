@@ -5,11 +5,134 @@
 #include "ShrdPtr.h"
 #include "DynamicArraySmart.h"
 #include "UnqPtr.h"
+#include "IndexPair.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Представление ключа внутри узла. По умолчанию ключ хранится как есть;
+// IndexPair упаковывается в uint64_t с сохранением порядка, и сравнение
+// ключей матрицы становится одним целочисленным сравнением.
+template<typename TKey>
+struct BTreeKeyTraits {
+    using Stored = TKey;
+
+    static const TKey &Encode(const TKey &key) {
+        return key;
+    }
+
+    static const TKey &Decode(const TKey &key) {
+        return key;
+    }
+};
+
+template<>
+struct BTreeKeyTraits<IndexPair> {
+    using Stored = uint64_t;
+
+    static uint64_t Encode(const IndexPair &key) {
+        return key.Pack();
+    }
+
+    static IndexPair Decode(uint64_t key) {
+        return IndexPair::Unpack(key);
+    }
+};
+
+// Хранилище ключей, значений и детей узла. При Order > 0 порядок известен на
+// этапе компиляции и массивы лежат прямо в узле, выровненном по кэш-линии;
+// при Order == 0 порядок задаётся в конструкторе и массивы выделяются в куче.
+template<typename TKey, typename TElement, typename TChild, int Order>
+struct alignas(64) alignas(TKey) alignas(TElement) BTreeNodeStorage {
+    TKey keys[2 * Order - 1];
+    TElement values[2 * Order - 1];
+    TChild children[2 * Order];
+
+    explicit BTreeNodeStorage(int) {}
+};
+
+template<typename TKey, typename TElement, typename TChild>
+struct BTreeNodeStorage<TKey, TElement, TChild, 0> {
+    UnqPtr<TKey[]> keys;
+    UnqPtr<TElement[]> values;
+    UnqPtr<TChild[]> children;
+
+    explicit BTreeNodeStorage(int order)
+            : keys(new TKey[2 * order - 1]), values(new TElement[2 * order - 1]), children(new TChild[2 * order]) {}
+};
+
+// Размер поддерева узла; хранится только в деревьях с порядковой статистикой.
+template<bool Counted>
+struct BTreeSubtreeSize {
+    size_t subtreeSize = 0;
+};
+
+template<>
+struct BTreeSubtreeSize<false> {
+};
 
-template<typename TKey, typename TElement>
+// Форма и эффективность BTree для выбора порядка и поиска фрагментации.
+struct BTreeMetrics {
+    int order = 0;
+    // Число уровней; дерево из одного листа имеет высоту 1.
+    int height = 0;
+    // Число узлов на каждом уровне, начиная с корня.
+    std::vector<size_t> nodesPerLevel;
+    size_t nodeCount = 0;
+    size_t entryCount = 0;
+    // Доля занятых ячеек ключей по всем узлам.
+    double fillFactor = 0;
+    // Память узлов по массивам keys/values/children и служебным полям
+    // (заголовок узла и счётчик ссылок); внешняя память значений не учитывается.
+    size_t keyBytes = 0;
+    size_t valueBytes = 0;
+    size_t childBytes = 0;
+    size_t overheadBytes = 0;
+    double bytesPerEntry = 0;
+    // Расщепления и слияния узлов с момента создания или ResetOperationCounters().
+    size_t splits = 0;
+    size_t merges = 0;
+    // Среднее число сравнений ключей при спуске от корня к каждому хранимому ключу.
+    double comparisonsPerLookup = 0;
+
+    // Пары "metric,value", по одной на строку.
+    void WriteCsv(std::ostream &out) const {
+        out << "metric,value\n";
+        out << "order," << order << "\n";
+        out << "height," << height << "\n";
+        for (size_t level = 0; level < nodesPerLevel.size(); ++level)
+            out << "nodes_level_" << level << "," << nodesPerLevel[level] << "\n";
+        out << "node_count," << nodeCount << "\n";
+        out << "entry_count," << entryCount << "\n";
+        out << "fill_factor," << fillFactor << "\n";
+        out << "key_bytes," << keyBytes << "\n";
+        out << "value_bytes," << valueBytes << "\n";
+        out << "child_bytes," << childBytes << "\n";
+        out << "overhead_bytes," << overheadBytes << "\n";
+        out << "bytes_per_entry," << bytesPerEntry << "\n";
+        out << "splits," << splits << "\n";
+        out << "merges," << merges << "\n";
+        out << "comparisons_per_lookup," << comparisonsPerLookup << "\n";
+    }
+};
+
+// Результат изменения BTree за один проход: ключ вставлен, обновлён,
+// удалён или отсутствовал.
+enum class BTreeUpdateResult {
+    Inserted,
+    Updated,
+    Removed,
+    Absent
+};
+
+template<typename TKey, typename TElement, int Order = 0, bool Counted = false>
 class BTree : public IDictionary<TKey, TElement> {
+    static_assert(Order == 0 || Order >= 2, "BTree order must be at least 2");
+
 public:
 
     BTree(int order = 3);
@@ -28,50 +151,158 @@ public:
 
     virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
 
+    virtual bool IsOrdered() const override;
+
+    // Значения меняются прямо в узлах (общие со снимком узлы копируются по
+    // пути обхода). Удалённые через RemoveCurrent() ключи убираются из
+    // дерева, когда обход доходит до конца или итератор разрушается.
+    virtual UnqPtr<IMutableDictionaryIterator<TKey, TElement>> GetMutableIterator() override;
+
+    // Части - непрерывные диапазоны ключей: верхние уровни дерева
+    // раскрываются, пока поддеревьев не станет не меньше parts.
+    virtual std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> GetPartitions(size_t parts) const override;
+
+    virtual std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> GetMutablePartitions(size_t parts) override;
+
     virtual TElement& operator[](const TKey &key) override;
 
+    BTreeUpdateResult Upsert(const TKey &key, const TElement &element);
+
+    BTreeUpdateResult Erase(const TKey &key);
+
+    // Неизменяемый снимок текущего состояния за O(1). Снимок разделяет узлы с
+    // деревом; последующие изменения дерева копируют только путь от корня до
+    // изменяемого узла. Снимок можно читать из другого потока, но сам вызов
+    // Snapshot() должен выполняться в потоке, который изменяет дерево.
+    UnqPtr<const BTree<TKey, TElement, Order, Counted>> Snapshot();
+
+    // Минимальная степень t: узел хранит от t - 1 до 2t - 1 ключей.
+    int GetOrder() const;
+
+    // Обход всех узлов за O(n).
+    BTreeMetrics GetMetrics() const;
+
+    void ResetOperationCounters();
+
+    // Обход по возрастанию ключей без виртуальных вызовов итератора:
+    // func(key, value) для каждой пары.
+    template<typename TFunc>
+    void ForEach(TFunc func) const;
+
+    // Заменяет содержимое деревом, построенным снизу вверх за O(n).
+    // Последовательность должна быть строго возрастающей по key; элементы
+    // имеют поля key и value (например, KeyValue<TKey, TElement>).
+    template<typename TIterator>
+    void BuildFromSorted(TIterator begin, TIterator end);
+
+    // Порядковая статистика (только при Counted = true), O(log n) каждая.
+    // Число ключей, строго меньших key.
+    size_t Rank(const TKey &key) const requires Counted;
+
+    // k-й по возрастанию ключ, начиная с нуля.
+    TKey Select(size_t k) const requires Counted;
+
+    // Число ключей в отрезке [low, high].
+    size_t CountInRange(const TKey &low, const TKey &high) const requires Counted;
+
 private:
-    struct Node {
+    using KeyTraits = BTreeKeyTraits<TKey>;
+    using StoredKey = typename KeyTraits::Stored;
+
+    struct Node : BTreeNodeStorage<StoredKey, TElement, ShrdPtr<Node>, Order>, BTreeSubtreeSize<Counted> {
         bool isLeaf;
         int numKeys;
-        UnqPtr<TKey[]> keys;
-        UnqPtr<TElement[]> values;
-        UnqPtr<ShrdPtr<Node>[]> children;
+        size_t epoch;
+
+        Node(bool leaf, int order, size_t epoch);
 
-        Node(bool leaf, int order);
+        Node(const Node &other, int order, size_t epoch);
     };
 
     ShrdPtr<Node> root;
     int order;
     size_t count;
+    // Узлы с чужой эпохой могут принадлежать снимку и перед записью копируются.
+    size_t epoch;
+
+    // Высота дерева с минимальной степенью 2 не превышает log2(count).
+    static constexpr int MAX_HEIGHT = 64;
+
+    // Палец (finger): путь последней вставки от корня и границы диапазона
+    // ключей каждого узла на нём (nullptr - без границы). Следующая вставка
+    // начинается с самого глубокого неполного узла, диапазон которого содержит
+    // ключ, поэтому возрастающий поток ключей не спускается от корня.
+    // Путь сбрасывается при удалении и при создании снимка.
+    Node *fingerPath[MAX_HEIGHT];
+    const StoredKey *fingerLow[MAX_HEIGHT];
+    const StoredKey *fingerHigh[MAX_HEIGHT];
+    int fingerDepth;
+
+    size_t splitCount;
+    size_t mergeCount;
+
+    BTree(int order, const ShrdPtr<Node> &sharedRoot, size_t count);
+
+    bool FingerCovers(int level, const StoredKey &key) const;
+
+    int Degree() const {
+        if constexpr (Order > 0)
+            return Order;
+        else
+            return order;
+    }
+
+    static size_t NewEpoch();
+
+    Node *MakeWritable(ShrdPtr<Node> &link);
+
+    // Отрезок симметричного обхода: всё поддерево по ссылке link или, если
+    // link пуст, один ключ node->keys[index].
+    struct TraversalRange {
+        ShrdPtr<Node> *link;
+        Node *node;
+        int index;
+    };
 
-    void SplitChild(ShrdPtr<Node> parent, int index);
+    std::vector<std::vector<TraversalRange>> SplitTraversal(size_t parts, bool writable);
 
-    void InsertNonFull(ShrdPtr<Node> &node, const TKey &key, const TElement &value);
+    int FindIndex(const Node *node, const StoredKey &key) const;
 
-    TElement& FindOrInsert(ShrdPtr<Node> &node, const TKey &key);
+    const Node *FindNode(const StoredKey &key, int &index) const;
 
-    TElement Search(ShrdPtr<Node> x, const TKey &key) const;
+    TElement& FindOrInsert(const StoredKey &key, const TElement &initial, bool &inserted);
 
-    bool Contains(ShrdPtr<Node> x, const TKey &key) const;
+    void SplitChild(Node *parent, int index);
 
-    void RemoveFromNode(ShrdPtr<Node> x, const TKey &key);
+    void RemoveFromLeaf(Node *x, int idx);
 
-    void RemoveFromLeaf(ShrdPtr<Node> x, int idx);
+    void Fill(Node *x, int idx);
 
-    void RemoveFromNonLeaf(ShrdPtr<Node> x, int idx);
+    void BorrowFromPrev(Node *x, int idx);
 
-    TKey GetPredecessor(ShrdPtr<Node> x, int idx);
+    void BorrowFromNext(Node *x, int idx);
 
-    TKey GetSuccessor(ShrdPtr<Node> x, int idx);
+    void Merge(Node *x, int idx);
 
-    void Fill(ShrdPtr<Node> x, int idx);
+    static size_t SubtreeSize(const Node *node);
 
-    void BorrowFromPrev(ShrdPtr<Node> x, int idx);
+    template<typename TFunc>
+    static void ForEachInNode(const Node *node, TFunc &func);
 
-    void BorrowFromNext(ShrdPtr<Node> x, int idx);
+    // Наибольшее число ключей в поддереве высоты height: (2t)^(height+1) - 1.
+    size_t MaxKeys(int height) const;
 
-    void Merge(ShrdPtr<Node> x, int idx);
+    template<typename TIterator>
+    ShrdPtr<Node> BuildSubtree(TIterator &first, size_t n, int height, bool isRoot);
+
+    // Сравнения FindIndex и проверки равенства, если поиск в узле
+    // останавливается на позиции index.
+    static size_t SearchComparisons(const Node *node, int index);
+
+    void CollectMetrics(const Node *node, size_t depth, size_t pathComparisons, BTreeMetrics &metrics,
+                        size_t &totalComparisons) const;
+
+    size_t CountLess(const StoredKey &key, bool inclusive) const;
 
     class BTreeIterator : public IDictionaryIterator<TKey, TElement> {
     public:
@@ -83,6 +314,10 @@ private:
 
         virtual bool MoveNext() override;
 
+        // Спуск к key от ближайшего предка на стеке, чьё поддерево его
+        // содержит: O(log n) вместо перебора промежуточных ключей.
+        virtual bool SkipTo(const TKey &key) override;
+
         virtual void Reset() override;
 
         virtual TKey GetCurrentKey() const override;
@@ -103,6 +338,52 @@ private:
         void PushLeftmost(ShrdPtr<Node> node);
     };
 
+    // Обходит отрезки ranges по порядку. Без writable узлы не копируются и
+    // итератор годится только для чтения; без canRemove удаление запрещено.
+    class BTreeMutableIterator : public IMutableDictionaryIterator<TKey, TElement> {
+    public:
+        BTreeMutableIterator(BTree *tree, std::vector<TraversalRange> ranges, bool writable, bool canRemove);
+
+        virtual ~BTreeMutableIterator();
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+        virtual TElement &GetCurrentValueRef() override;
+
+        virtual void RemoveCurrent() override;
+
+    private:
+        struct StackNode {
+            Node *node;
+            int index;
+        };
+
+        BTree *tree;
+        std::vector<TraversalRange> ranges;
+        size_t nextRange;
+        bool writable;
+        bool canRemove;
+        StackNode stack[MAX_HEIGHT];
+        int depth;
+        Node *currentNode;
+        int currentIndex;
+        std::vector<StoredKey> pendingRemovals;
+
+        Node *Enter(ShrdPtr<Node> &link);
+
+        void PushLeftmost(ShrdPtr<Node> &link);
+
+        void CheckCurrent() const;
+
+        void ApplyRemovals();
+    };
+
     friend class BTreeTest;
 
 public:
@@ -117,7 +398,7 @@ public:
 
         for (int i = 0; i < currentNode->numKeys; ++i) {
             if (i > 0) std::cout << ", ";
-            std::cout << currentNode->keys[i];
+            std::cout << KeyTraits::Decode(currentNode->keys[i]);
         }
         std::cout << "]\n";
 
@@ -129,124 +410,257 @@ public:
     }
 };
 
-template<typename TKey, typename TElement>
-TElement& BTree<TKey, TElement>::operator[](const TKey &key) {
-    if (!root) {
-        root = ShrdPtr<Node>(new Node(true, order));
-    }
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::Node::Node(bool leaf, int order, size_t epoch)
+        : BTreeNodeStorage<StoredKey, TElement, ShrdPtr<Node>, Order>(order), isLeaf(leaf), numKeys(0), epoch(epoch) {
+}
 
-    ShrdPtr<Node> node = root;
-    while (node) {
-        int index = 0;
-        while (index < node->numKeys && key > node->keys[index])
-            ++index;
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::Node::Node(const Node &other, int order, size_t epoch)
+        : Node(other.isLeaf, order, epoch) {
+    numKeys = other.numKeys;
+    if constexpr (Counted)
+        this->subtreeSize = other.subtreeSize;
+    for (int i = 0; i < numKeys; ++i) {
+        this->keys[i] = other.keys[i];
+        this->values[i] = other.values[i];
+    }
+    if (!isLeaf) {
+        for (int i = 0; i <= numKeys; ++i)
+            this->children[i] = other.children[i];
+    }
+}
 
-        if (index < node->numKeys && key == node->keys[index]) {
-            return node->values[index];
-        }
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::BTree(int order)
+        : root(), order(Order > 0 ? Order : order), count(0), epoch(NewEpoch()), fingerDepth(0),
+          splitCount(0), mergeCount(0) {
+    root = ShrdPtr<Node>(new Node(true, Degree(), epoch));
+}
 
-        if (node->isLeaf) {
-            if (node->numKeys >= 2 * order - 1) {
-                throw std::runtime_error("BTree node is full, cannot insert.");
-            }
-            // Вставляем новый ключ в листовой узел
-            for (int j = node->numKeys; j > index; --j) {
-                node->keys[j] = node->keys[j - 1];
-                node->values[j] = node->values[j - 1];
-            }
-            node->keys[index] = key;
-            node->values[index] = TElement(); // Создание нового значения по умолчанию
-            node->numKeys++;
-            return node->values[index];
-        }
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::BTree(int order, const ShrdPtr<Node> &sharedRoot, size_t count)
+        : root(sharedRoot), order(order), count(count), epoch(NewEpoch()), fingerDepth(0),
+          splitCount(0), mergeCount(0) {
+}
 
-        node = node->children[index];
-    }
+template<typename TKey, typename TElement, int Order, bool Counted>
+bool BTree<TKey, TElement, Order, Counted>::FingerCovers(int level, const StoredKey &key) const {
+    return (!fingerLow[level] || key > *fingerLow[level]) && (!fingerHigh[level] || *fingerHigh[level] > key);
+}
 
-    throw std::runtime_error("Unexpected error in BTree operator[].");
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::NewEpoch() {
+    static std::atomic<size_t> nextEpoch(1);
+    return nextEpoch.fetch_add(1, std::memory_order_relaxed);
 }
 
-template<typename TKey, typename TElement>
-BTree<TKey, TElement>::Node::Node(bool leaf, int order)
-        : isLeaf(leaf), numKeys(0), keys(new TKey[2 * order - 1]), values(new TElement[2 * order - 1]),
-          children(new ShrdPtr<Node>[2 * order]) {
+template<typename TKey, typename TElement, int Order, bool Counted>
+typename BTree<TKey, TElement, Order, Counted>::Node *BTree<TKey, TElement, Order, Counted>::MakeWritable(ShrdPtr<Node> &link) {
+    if (link && link->epoch != epoch)
+        link = ShrdPtr<Node>(new Node(*link, Degree(), epoch));
+    return link.get();
 }
 
-template<typename TKey, typename TElement>
-BTree<TKey, TElement>::BTree(int order)
-        : root(new Node(true, order)), order(order), count(0) {
+template<typename TKey, typename TElement, int Order, bool Counted>
+UnqPtr<const BTree<TKey, TElement, Order, Counted>> BTree<TKey, TElement, Order, Counted>::Snapshot() {
+    UnqPtr<const BTree<TKey, TElement, Order, Counted>> snapshot(new BTree<TKey, TElement, Order, Counted>(Degree(), root, count));
+    epoch = NewEpoch();
+    fingerDepth = 0;
+    return snapshot;
 }
 
-template<typename TKey, typename TElement>
-BTree<TKey, TElement>::~BTree() {}
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::~BTree() {}
 
-template<typename TKey, typename TElement>
-size_t BTree<TKey, TElement>::GetCount() const {
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::GetCount() const {
     return count;
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::Add(const TKey &key, const TElement &element) {
-    if (ContainsKey(key)) {
-        (*this)[key] = element;
-        return;
+template<typename TKey, typename TElement, int Order, bool Counted>
+int BTree<TKey, TElement, Order, Counted>::FindIndex(const Node *node, const StoredKey &key) const {
+    int index = 0;
+    if constexpr (std::is_integral_v<StoredKey>) {
+        // Без ветвлений: число ключей меньше искомого; цикл векторизуется.
+        for (int i = 0; i < node->numKeys; ++i)
+            index += node->keys[i] < key;
+    } else {
+        while (index < node->numKeys && key > node->keys[index])
+            ++index;
     }
+    return index;
+}
 
-    if (root->numKeys == 2 * order - 1) {
-        ShrdPtr<Node> newRoot(new Node(false, order));
-        newRoot->children[0] = root;
-        SplitChild(newRoot, 0);
-        root = newRoot;
+template<typename TKey, typename TElement, int Order, bool Counted>
+const typename BTree<TKey, TElement, Order, Counted>::Node *
+BTree<TKey, TElement, Order, Counted>::FindNode(const StoredKey &key, int &index) const {
+    const Node *node = root.get();
+    // Поиск рядом с последней вставкой начинается прямо с её листа.
+    if (fingerDepth > 1 && FingerCovers(fingerDepth - 1, key))
+        node = fingerPath[fingerDepth - 1];
+    while (node) {
+        index = FindIndex(node, key);
+        if (index < node->numKeys && key == node->keys[index])
+            return node;
+        if (node->isLeaf)
+            return nullptr;
+        node = node->children[index].get();
     }
-    InsertNonFull(root, key, element);
-    ++count;
+    return nullptr;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+TElement BTree<TKey, TElement, Order, Counted>::Get(const TKey &key) const {
+    int index = 0;
+    const Node *node = FindNode(KeyTraits::Encode(key), index);
+    if (!node)
+        throw std::runtime_error("Key not found.");
+    return node->values[index];
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::InsertNonFull(ShrdPtr<Node> &node, const TKey &key, const TElement &value) {
-    int i = node->numKeys - 1;
+template<typename TKey, typename TElement, int Order, bool Counted>
+bool BTree<TKey, TElement, Order, Counted>::ContainsKey(const TKey &key) const {
+    int index = 0;
+    return FindNode(KeyTraits::Encode(key), index) != nullptr;
+}
 
-    if (node->isLeaf) {
-        while (i >= 0 && key < node->keys[i]) {
-            node->keys[i + 1] = node->keys[i];
-            node->values[i + 1] = node->values[i];
-            --i;
-        }
-        node->keys[i + 1] = key;
-        node->values[i + 1] = value;
-        ++node->numKeys;
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::Add(const TKey &key, const TElement &element) {
+    Upsert(key, element);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTreeUpdateResult BTree<TKey, TElement, Order, Counted>::Upsert(const TKey &key, const TElement &element) {
+    bool inserted = false;
+    TElement &slot = FindOrInsert(KeyTraits::Encode(key), element, inserted);
+    if (inserted)
+        return BTreeUpdateResult::Inserted;
+    slot = element;
+    return BTreeUpdateResult::Updated;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+TElement& BTree<TKey, TElement, Order, Counted>::operator[](const TKey &key) {
+    bool inserted = false;
+    return FindOrInsert(KeyTraits::Encode(key), TElement(), inserted);
+}
+
+// Один спуск к листу: полные узлы расщепляются заранее, поэтому вставка в
+// лист никогда не требует подъёма обратно. Спуск начинается с пальца, если
+// ключ попадает в диапазон одного из его неполных узлов, иначе с корня.
+template<typename TKey, typename TElement, int Order, bool Counted>
+TElement& BTree<TKey, TElement, Order, Counted>::FindOrInsert(const StoredKey &key, const TElement &initial, bool &inserted) {
+    // Диапазоны на пути вложены: сначала проверяется самый глубокий узел
+    // (вставка по возрастанию), иначе уровни перебираются сверху до первого,
+    // не содержащего ключ.
+    int depth = fingerDepth - 1;
+    if (depth > 0 && !FingerCovers(depth, key)) {
+        int covered = 0;
+        while (covered + 1 < depth && FingerCovers(covered + 1, key))
+            ++covered;
+        depth = covered;
+    }
+    while (depth > 0 && fingerPath[depth]->numKeys == 2 * Degree() - 1)
+        --depth;
+
+    Node *node;
+    if (depth > 0) {
+        node = fingerPath[depth];
     } else {
-        while (i >= 0 && key < node->keys[i])
-            --i;
-        ++i;
-        if (node->children[i]->numKeys == 2 * order - 1) {
-            SplitChild(node, i);
-            if (key > node->keys[i])
-                ++i;
+        depth = 0;
+        node = MakeWritable(root);
+        if (node->numKeys == 2 * Degree() - 1) {
+            ShrdPtr<Node> newRoot(new Node(false, Degree(), epoch));
+            if constexpr (Counted)
+                newRoot->subtreeSize = node->subtreeSize;
+            newRoot->children[0] = root;
+            root = newRoot;
+            SplitChild(root.get(), 0);
+            node = root.get();
+        }
+        fingerPath[0] = node;
+        fingerLow[0] = nullptr;
+        fingerHigh[0] = nullptr;
+    }
+
+    // Ключ может оказаться уже в дереве, поэтому размеры поддеревьев на пути
+    // увеличиваются только после вставки в лист.
+    while (true) {
+        fingerDepth = depth + 1;
+        int index = FindIndex(node, key);
+        if (index < node->numKeys && key == node->keys[index]) {
+            inserted = false;
+            return node->values[index];
+        }
+
+        if (node->isLeaf) {
+            for (int i = node->numKeys; i > index; --i) {
+                node->keys[i] = node->keys[i - 1];
+                node->values[i] = node->values[i - 1];
+            }
+            node->keys[index] = key;
+            node->values[index] = initial;
+            ++node->numKeys;
+            ++count;
+            if constexpr (Counted) {
+                for (int i = 0; i <= depth; ++i)
+                    ++fingerPath[i]->subtreeSize;
+            }
+            inserted = true;
+            return node->values[index];
         }
-        InsertNonFull(node->children[i], key, value);
+
+        Node *child = MakeWritable(node->children[index]);
+        if (child->numKeys == 2 * Degree() - 1) {
+            SplitChild(node, index);
+            if (key == node->keys[index]) {
+                inserted = false;
+                return node->values[index];
+            }
+            if (key > node->keys[index])
+                ++index;
+            child = node->children[index].get();
+        }
+        fingerPath[depth + 1] = child;
+        fingerLow[depth + 1] = index > 0 ? &node->keys[index - 1] : fingerLow[depth];
+        fingerHigh[depth + 1] = index < node->numKeys ? &node->keys[index] : fingerHigh[depth];
+        ++depth;
+        node = child;
     }
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::SplitChild(ShrdPtr<Node> parentNode, int childIndex) {
-    ShrdPtr<Node> oldChild = parentNode->children[childIndex];
-    ShrdPtr<Node> newChild(new Node(oldChild->isLeaf, order));
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::SplitChild(Node *parentNode, int childIndex) {
+    Node *oldChild = MakeWritable(parentNode->children[childIndex]);
+    ShrdPtr<Node> newChild(new Node(oldChild->isLeaf, Degree(), epoch));
+    ++splitCount;
 
-    newChild->numKeys = order - 1;
+    newChild->numKeys = Degree() - 1;
 
-    for (int i = 0; i < order - 1; ++i) {
-        newChild->keys[i] = oldChild->keys[i + order];
-        newChild->values[i] = oldChild->values[i + order];
+    for (int i = 0; i < Degree() - 1; ++i) {
+        newChild->keys[i] = oldChild->keys[i + Degree()];
+        newChild->values[i] = oldChild->values[i + Degree()];
     }
 
     if (!oldChild->isLeaf) {
-        for (int i = 0; i < order; ++i) {
-            newChild->children[i] = oldChild->children[i + order];
+        for (int i = 0; i < Degree(); ++i) {
+            newChild->children[i] = oldChild->children[i + Degree()];
+            oldChild->children[i + Degree()] = ShrdPtr<Node>();
         }
     }
 
-    oldChild->numKeys = order - 1;
+    oldChild->numKeys = Degree() - 1;
+
+    if constexpr (Counted) {
+        size_t moved = newChild->numKeys;
+        if (!newChild->isLeaf) {
+            for (int i = 0; i <= newChild->numKeys; ++i)
+                moved += newChild->children[i]->subtreeSize;
+        }
+        newChild->subtreeSize = moved;
+        oldChild->subtreeSize -= moved + 1;
+    }
 
     for (int i = parentNode->numKeys; i >= childIndex + 1; --i) {
         parentNode->children[i + 1] = parentNode->children[i];
@@ -258,94 +672,94 @@ void BTree<TKey, TElement>::SplitChild(ShrdPtr<Node> parentNode, int childIndex)
         parentNode->values[i + 1] = parentNode->values[i];
     }
 
-    parentNode->keys[childIndex] = oldChild->keys[order - 1];
-    parentNode->values[childIndex] = oldChild->values[order - 1];
+    parentNode->keys[childIndex] = oldChild->keys[Degree() - 1];
+    parentNode->values[childIndex] = oldChild->values[Degree() - 1];
     ++parentNode->numKeys;
 }
 
-template<typename TKey, typename TElement>
-TElement BTree<TKey, TElement>::Get(const TKey &key) const {
-    ShrdPtr<Node> node = root;
-    while (node) {
-        int i = 0;
-        while (i < node->numKeys && key > node->keys[i])
-            ++i;
-
-        if (i < node->numKeys && key == node->keys[i])
-            return node->values[i];
-
-        if (node->isLeaf)
-            throw std::runtime_error("Key not found.");
-
-        node = node->children[i];
-    }
-    throw std::runtime_error("Key not found.");
-}
-
-template<typename TKey, typename TElement>
-TElement BTree<TKey, TElement>::Search(ShrdPtr<Node> node, const TKey &key) const {
-    int index = 0;
-    while (index < node->numKeys && key > node->keys[index])
-        ++index;
-
-    if (index < node->numKeys && key == node->keys[index])
-        return node->values[index];
-
-    if (node->isLeaf)
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::Remove(const TKey &key) {
+    if (Erase(key) == BTreeUpdateResult::Absent)
         throw std::runtime_error("Key not found.");
-    else
-        return Search(node->children[index], key);
 }
 
-template<typename TKey, typename TElement>
-bool BTree<TKey, TElement>::ContainsKey(const TKey &key) const {
-    try {
-        Get(key);
-        return true;
-    } catch (...) {
-        return false;
-    }
-}
+// Нисходящее удаление за один проход: перед спуском в ребёнка в нём должно
+// быть не меньше Degree() ключей, поэтому удаление из листа не требует
+// возврата наверх. Ключ из внутреннего узла заменяется предшественником или
+// преемником, после чего спуск продолжается уже за ним.
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTreeUpdateResult BTree<TKey, TElement, Order, Counted>::Erase(const TKey &key) {
+    Node *node = MakeWritable(root);
+    StoredKey target = KeyTraits::Encode(key);
+    bool found = false;
+    fingerDepth = 0;
+    Node *path[MAX_HEIGHT];
+    int depth = 0;
+
+    while (true) {
+        if constexpr (Counted)
+            path[depth++] = node;
+        int index = FindIndex(node, target);
+        bool inNode = index < node->numKeys && target == node->keys[index];
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::Remove(const TKey &key) {
-    if (!ContainsKey(key))
-        throw std::runtime_error("Key not found.");
+        if (node->isLeaf) {
+            if (inNode) {
+                RemoveFromLeaf(node, index);
+                found = true;
+            }
+            break;
+        }
 
-    RemoveFromNode(root, key);
-    --count;
+        if (inNode) {
+            found = true;
+            const Node *left = node->children[index].get();
+            const Node *right = node->children[index + 1].get();
+            if (left->numKeys >= Degree()) {
+                while (!left->isLeaf)
+                    left = left->children[left->numKeys].get();
+                node->keys[index] = left->keys[left->numKeys - 1];
+                node->values[index] = left->values[left->numKeys - 1];
+                target = node->keys[index];
+                node = MakeWritable(node->children[index]);
+            } else if (right->numKeys >= Degree()) {
+                while (!right->isLeaf)
+                    right = right->children[0].get();
+                node->keys[index] = right->keys[0];
+                node->values[index] = right->values[0];
+                target = node->keys[index];
+                node = MakeWritable(node->children[index + 1]);
+            } else {
+                Merge(node, index);
+                node = MakeWritable(node->children[index]);
+            }
+            continue;
+        }
 
-    if (root->numKeys == 0) {
-        if (root->isLeaf) {
-            root.reset(new Node(true, order));
-        } else {
-            root = root->children[0];
+        if (node->children[index]->numKeys < Degree()) {
+            bool last = index == node->numKeys;
+            Fill(node, index);
+            if (last && index > node->numKeys)
+                --index;
         }
+        node = MakeWritable(node->children[index]);
     }
-}
-
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::RemoveFromNode(ShrdPtr<Node> node, const TKey &key) {
-    int index = 0;
-    while (index < node->numKeys && node->keys[index] < key)
-        ++index;
 
-    if (index < node->numKeys && node->keys[index] == key) {
-        if (node->isLeaf)
-            RemoveFromLeaf(node, index);
-        else
-            RemoveFromNonLeaf(node, index);
-    } else if (!node->isLeaf) {
-        Fill(node, index);
-        if (index < node->numKeys)
-            RemoveFromNode(node->children[index], key);
-        else
-            RemoveFromNode(node->children[index - 1], key);
+    if constexpr (Counted) {
+        for (int i = 0; found && i < depth; ++i)
+            --path[i]->subtreeSize;
     }
+
+    if (root->numKeys == 0 && !root->isLeaf)
+        root = root->children[0];
+
+    if (!found)
+        return BTreeUpdateResult::Absent;
+    --count;
+    return BTreeUpdateResult::Removed;
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::RemoveFromLeaf(ShrdPtr<Node> node, int idx) {
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::RemoveFromLeaf(Node *node, int idx) {
     for (int i = idx; i < node->numKeys - 1; ++i) {
         node->keys[i] = node->keys[i + 1];
         node->values[i] = node->values[i + 1];
@@ -353,44 +767,11 @@ void BTree<TKey, TElement>::RemoveFromLeaf(ShrdPtr<Node> node, int idx) {
     --node->numKeys;
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::RemoveFromNonLeaf(ShrdPtr<Node> node, int idx) {
-    TKey key = node->keys[idx];
-    if (node->children[idx]->numKeys >= order) {
-        TKey predecessor = GetPredecessor(node, idx);
-        node->keys[idx] = predecessor;
-        RemoveFromNode(node->children[idx], predecessor);
-    } else if (node->children[idx + 1]->numKeys >= order) {
-        TKey successor = GetSuccessor(node, idx);
-        node->keys[idx] = successor;
-        RemoveFromNode(node->children[idx + 1], successor);
-    } else {
-        Merge(node, idx);
-        RemoveFromNode(node->children[idx], key);
-    }
-}
-
-template<typename TKey, typename TElement>
-TKey BTree<TKey, TElement>::GetPredecessor(ShrdPtr<Node> node, int idx) {
-    ShrdPtr<Node> current = node->children[idx];
-    while (!current->isLeaf)
-        current = current->children[current->numKeys];
-    return current->keys[current->numKeys - 1];
-}
-
-template<typename TKey, typename TElement>
-TKey BTree<TKey, TElement>::GetSuccessor(ShrdPtr<Node> node, int idx) {
-    ShrdPtr<Node> current = node->children[idx + 1];
-    while (!current->isLeaf)
-        current = current->children[0];
-    return current->keys[0];
-}
-
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::Fill(ShrdPtr<Node> node, int idx) {
-    if (idx > 0 && node->children[idx - 1]->numKeys >= order)
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::Fill(Node *node, int idx) {
+    if (idx > 0 && node->children[idx - 1]->numKeys >= Degree())
         BorrowFromPrev(node, idx);
-    else if (idx < node->numKeys && node->children[idx + 1]->numKeys >= order)
+    else if (idx < node->numKeys && node->children[idx + 1]->numKeys >= Degree())
         BorrowFromNext(node, idx);
     else {
         if (idx < node->numKeys)
@@ -400,10 +781,10 @@ void BTree<TKey, TElement>::Fill(ShrdPtr<Node> node, int idx) {
     }
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::BorrowFromPrev(ShrdPtr<Node> node, int idx) {
-    ShrdPtr<Node> child = node->children[idx];
-    ShrdPtr<Node> sibling = node->children[idx - 1];
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BorrowFromPrev(Node *node, int idx) {
+    Node *child = MakeWritable(node->children[idx]);
+    Node *sibling = MakeWritable(node->children[idx - 1]);
 
     for (int i = child->numKeys - 1; i >= 0; --i) {
         child->keys[i + 1] = child->keys[i];
@@ -418,8 +799,16 @@ void BTree<TKey, TElement>::BorrowFromPrev(ShrdPtr<Node> node, int idx) {
     child->keys[0] = node->keys[idx - 1];
     child->values[0] = node->values[idx - 1];
 
-    if (!child->isLeaf)
+    if (!child->isLeaf) {
         child->children[0] = sibling->children[sibling->numKeys];
+        sibling->children[sibling->numKeys] = ShrdPtr<Node>();
+    }
+
+    if constexpr (Counted) {
+        size_t moved = 1 + SubtreeSize(child->isLeaf ? nullptr : child->children[0].get());
+        child->subtreeSize += moved;
+        sibling->subtreeSize -= moved;
+    }
 
     node->keys[idx - 1] = sibling->keys[sibling->numKeys - 1];
     node->values[idx - 1] = sibling->values[sibling->numKeys - 1];
@@ -428,10 +817,10 @@ void BTree<TKey, TElement>::BorrowFromPrev(ShrdPtr<Node> node, int idx) {
     --sibling->numKeys;
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::BorrowFromNext(ShrdPtr<Node> node, int idx) {
-    ShrdPtr<Node> child = node->children[idx];
-    ShrdPtr<Node> sibling = node->children[idx + 1];
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BorrowFromNext(Node *node, int idx) {
+    Node *child = MakeWritable(node->children[idx]);
+    Node *sibling = MakeWritable(node->children[idx + 1]);
 
     child->keys[child->numKeys] = node->keys[idx];
     child->values[child->numKeys] = node->values[idx];
@@ -439,6 +828,12 @@ void BTree<TKey, TElement>::BorrowFromNext(ShrdPtr<Node> node, int idx) {
     if (!child->isLeaf)
         child->children[child->numKeys + 1] = sibling->children[0];
 
+    if constexpr (Counted) {
+        size_t moved = 1 + SubtreeSize(child->isLeaf ? nullptr : child->children[child->numKeys + 1].get());
+        child->subtreeSize += moved;
+        sibling->subtreeSize -= moved;
+    }
+
     node->keys[idx] = sibling->keys[0];
     node->values[idx] = sibling->values[0];
 
@@ -450,28 +845,30 @@ void BTree<TKey, TElement>::BorrowFromNext(ShrdPtr<Node> node, int idx) {
     if (!sibling->isLeaf) {
         for (int i = 1; i <= sibling->numKeys; ++i)
             sibling->children[i - 1] = sibling->children[i];
+        sibling->children[sibling->numKeys] = ShrdPtr<Node>();
     }
 
     ++child->numKeys;
     --sibling->numKeys;
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::Merge(ShrdPtr<Node> node, int idx) {
-    ShrdPtr<Node> child = node->children[idx];
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::Merge(Node *node, int idx) {
+    Node *child = MakeWritable(node->children[idx]);
     ShrdPtr<Node> sibling = node->children[idx + 1];
+    ++mergeCount;
 
-    child->keys[order - 1] = node->keys[idx];
-    child->values[order - 1] = node->values[idx];
+    child->keys[Degree() - 1] = node->keys[idx];
+    child->values[Degree() - 1] = node->values[idx];
 
     for (int i = 0; i < sibling->numKeys; ++i) {
-        child->keys[i + order] = sibling->keys[i];
-        child->values[i + order] = sibling->values[i];
+        child->keys[i + Degree()] = sibling->keys[i];
+        child->values[i + Degree()] = sibling->values[i];
     }
 
     if (!child->isLeaf) {
         for (int i = 0; i <= sibling->numKeys; ++i)
-            child->children[i + order] = sibling->children[i];
+            child->children[i + Degree()] = sibling->children[i];
     }
 
     for (int i = idx + 1; i < node->numKeys; ++i) {
@@ -481,18 +878,239 @@ void BTree<TKey, TElement>::Merge(ShrdPtr<Node> node, int idx) {
 
     for (int i = idx + 2; i <= node->numKeys; ++i)
         node->children[i - 1] = node->children[i];
+    node->children[node->numKeys] = ShrdPtr<Node>();
 
+    child->numKeys += sibling->numKeys + 1;
     --node->numKeys;
-    --sibling->numKeys;
+    if constexpr (Counted)
+        child->subtreeSize += sibling->subtreeSize + 1;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::SubtreeSize(const Node *node) {
+    return node ? node->subtreeSize : 0;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::CountLess(const StoredKey &key, bool inclusive) const {
+    size_t result = 0;
+    const Node *node = root.get();
+    while (node) {
+        int index = FindIndex(node, key);
+        bool equal = index < node->numKeys && key == node->keys[index];
+        for (int i = 0; i < index; ++i)
+            result += 1 + (node->isLeaf ? 0 : node->children[i]->subtreeSize);
+        if (node->isLeaf)
+            return result + (equal && inclusive ? 1 : 0);
+        if (equal)
+            return result + node->children[index]->subtreeSize + (inclusive ? 1 : 0);
+        node = node->children[index].get();
+    }
+    return result;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+int BTree<TKey, TElement, Order, Counted>::GetOrder() const {
+    return Degree();
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTreeMetrics BTree<TKey, TElement, Order, Counted>::GetMetrics() const {
+    BTreeMetrics metrics;
+    metrics.order = Degree();
+    metrics.splits = splitCount;
+    metrics.merges = mergeCount;
+    size_t totalComparisons = 0;
+    CollectMetrics(root.get(), 0, 0, metrics, totalComparisons);
+
+    metrics.height = static_cast<int>(metrics.nodesPerLevel.size());
+    size_t slots = metrics.nodeCount * static_cast<size_t>(2 * Degree() - 1);
+    size_t bytes = metrics.keyBytes + metrics.valueBytes + metrics.childBytes + metrics.overheadBytes;
+    if (slots > 0)
+        metrics.fillFactor = static_cast<double>(metrics.entryCount) / slots;
+    if (metrics.entryCount > 0) {
+        metrics.bytesPerEntry = static_cast<double>(bytes) / metrics.entryCount;
+        metrics.comparisonsPerLookup = static_cast<double>(totalComparisons) / metrics.entryCount;
+    }
+    return metrics;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::ResetOperationCounters() {
+    splitCount = 0;
+    mergeCount = 0;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::SearchComparisons(const Node *node, int index) {
+    size_t equality = index < node->numKeys ? 1 : 0;
+    if constexpr (std::is_integral_v<StoredKey>)
+        return node->numKeys + equality;
+    else
+        return (index < node->numKeys ? index + 1 : node->numKeys) + equality;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::CollectMetrics(const Node *node, size_t depth, size_t pathComparisons,
+                                                           BTreeMetrics &metrics, size_t &totalComparisons) const {
+    if (metrics.nodesPerLevel.size() <= depth)
+        metrics.nodesPerLevel.push_back(0);
+    ++metrics.nodesPerLevel[depth];
+    ++metrics.nodeCount;
+    metrics.entryCount += node->numKeys;
+
+    size_t capacity = 2 * static_cast<size_t>(Degree()) - 1;
+    if constexpr (Order > 0) {
+        metrics.keyBytes += sizeof(node->keys);
+        metrics.valueBytes += sizeof(node->values);
+        metrics.childBytes += sizeof(node->children);
+        metrics.overheadBytes += sizeof(Node) - sizeof(node->keys) - sizeof(node->values) - sizeof(node->children);
+    } else {
+        metrics.keyBytes += capacity * sizeof(StoredKey);
+        metrics.valueBytes += capacity * sizeof(TElement);
+        metrics.childBytes += (capacity + 1) * sizeof(ShrdPtr<Node>);
+        metrics.overheadBytes += sizeof(Node);
+    }
+    metrics.overheadBytes += sizeof(std::atomic<size_t>);
+
+    for (int i = 0; i < node->numKeys; ++i)
+        totalComparisons += pathComparisons + SearchComparisons(node, i);
+    if (!node->isLeaf) {
+        for (int i = 0; i <= node->numKeys; ++i)
+            CollectMetrics(node->children[i].get(), depth + 1, pathComparisons + SearchComparisons(node, i),
+                           metrics, totalComparisons);
+    }
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+template<typename TFunc>
+void BTree<TKey, TElement, Order, Counted>::ForEach(TFunc func) const {
+    ForEachInNode(root.get(), func);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+template<typename TFunc>
+void BTree<TKey, TElement, Order, Counted>::ForEachInNode(const Node *node, TFunc &func) {
+    for (int i = 0; i < node->numKeys; ++i) {
+        if (!node->isLeaf)
+            ForEachInNode(node->children[i].get(), func);
+        func(KeyTraits::Decode(node->keys[i]), node->values[i]);
+    }
+    if (!node->isLeaf)
+        ForEachInNode(node->children[node->numKeys].get(), func);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::MaxKeys(int height) const {
+    const size_t limit = static_cast<size_t>(-1);
+    size_t fanout = 2 * static_cast<size_t>(Degree());
+    size_t capacity = 1;
+    for (int level = 0; level <= height; ++level) {
+        if (capacity > limit / fanout)
+            return limit;
+        capacity *= fanout;
+    }
+    return capacity - 1;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+template<typename TIterator>
+void BTree<TKey, TElement, Order, Counted>::BuildFromSorted(TIterator begin, TIterator end) {
+    size_t n = static_cast<size_t>(end - begin);
+    fingerDepth = 0;
+    count = n;
+    if (n == 0) {
+        root = ShrdPtr<Node>(new Node(true, Degree(), epoch));
+        return;
+    }
+    int height = 0;
+    while (MaxKeys(height) < n)
+        ++height;
+    root = BuildSubtree(begin, n, height, true);
+}
+
+// Детей столько, чтобы каждый вместил свою долю, но не меньше t (у корня - 2);
+// ключи делятся между детьми поровну, поэтому все узлы заполнены не меньше
+// чем наполовину.
+template<typename TKey, typename TElement, int Order, bool Counted>
+template<typename TIterator>
+ShrdPtr<typename BTree<TKey, TElement, Order, Counted>::Node>
+BTree<TKey, TElement, Order, Counted>::BuildSubtree(TIterator &first, size_t n, int height, bool isRoot) {
+    ShrdPtr<Node> node(new Node(height == 0, Degree(), epoch));
+    if constexpr (Counted)
+        node->subtreeSize = n;
+
+    if (height == 0) {
+        for (size_t i = 0; i < n; ++i, ++first) {
+            node->keys[i] = KeyTraits::Encode(first->key);
+            node->values[i] = first->value;
+        }
+        node->numKeys = static_cast<int>(n);
+        return node;
+    }
+
+    size_t childMax = MaxKeys(height - 1);
+    size_t children = (n + 1 + childMax) / (childMax + 1);
+    size_t minChildren = isRoot ? 2 : static_cast<size_t>(Degree());
+    if (children < minChildren)
+        children = minChildren;
+
+    size_t childKeys = n - (children - 1);
+    for (size_t i = 0; i < children; ++i) {
+        size_t take = childKeys / children + (i < childKeys % children ? 1 : 0);
+        node->children[i] = BuildSubtree(first, take, height - 1, false);
+        if (i + 1 < children) {
+            node->keys[i] = KeyTraits::Encode(first->key);
+            node->values[i] = first->value;
+            ++first;
+        }
+    }
+    node->numKeys = static_cast<int>(children - 1);
+    return node;
 }
-template<typename TKey, typename TElement>
-BTree<TKey, TElement>::BTreeIterator::BTreeIterator(const BTree *tree)
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::Rank(const TKey &key) const requires Counted {
+    return CountLess(KeyTraits::Encode(key), false);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+TKey BTree<TKey, TElement, Order, Counted>::Select(size_t k) const requires Counted {
+    if (k >= count)
+        throw std::out_of_range("Index out of range");
+    const Node *node = root.get();
+    while (!node->isLeaf) {
+        int i = 0;
+        while (true) {
+            size_t left = node->children[i]->subtreeSize;
+            if (k < left) {
+                node = node->children[i].get();
+                break;
+            }
+            if (k == left)
+                return KeyTraits::Decode(node->keys[i]);
+            k -= left + 1;
+            ++i;
+        }
+    }
+    return KeyTraits::Decode(node->keys[k]);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+size_t BTree<TKey, TElement, Order, Counted>::CountInRange(const TKey &low, const TKey &high) const requires Counted {
+    if (high < low)
+        return 0;
+    return CountLess(KeyTraits::Encode(high), true) - CountLess(KeyTraits::Encode(low), false);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::BTreeIterator::BTreeIterator(const BTree *tree)
         : tree(tree), hasCurrent(false) {
     Reset();
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::BTreeIterator::Reset() {
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BTreeIterator::Reset() {
     stack = DynamicArraySmart<StackNode>();
     hasCurrent = false;
     if (tree->root) {
@@ -500,8 +1118,8 @@ void BTree<TKey, TElement>::BTreeIterator::Reset() {
     }
 }
 
-template<typename TKey, typename TElement>
-void BTree<TKey, TElement>::BTreeIterator::PushLeftmost(ShrdPtr<Node> node) {
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BTreeIterator::PushLeftmost(ShrdPtr<Node> node) {
     while (node && node->numKeys > 0) {
         StackNode sn = {node, 0};
         stack.Append(sn);
@@ -512,8 +1130,8 @@ void BTree<TKey, TElement>::BTreeIterator::PushLeftmost(ShrdPtr<Node> node) {
     }
 }
 
-template<typename TKey, typename TElement>
-bool BTree<TKey, TElement>::BTreeIterator::MoveNext() {
+template<typename TKey, typename TElement, int Order, bool Counted>
+bool BTree<TKey, TElement, Order, Counted>::BTreeIterator::MoveNext() {
     while (stack.GetLength() > 0) {
         StackNode &top = stack[stack.GetLength() - 1];
 
@@ -523,7 +1141,7 @@ bool BTree<TKey, TElement>::BTreeIterator::MoveNext() {
                 continue;
             }
 
-            currentKey = top.node->keys[top.index];
+            currentKey = KeyTraits::Decode(top.node->keys[top.index]);
             currentValue = top.node->values[top.index];
             hasCurrent = true;
 
@@ -549,48 +1167,274 @@ bool BTree<TKey, TElement>::BTreeIterator::MoveNext() {
     return false;
 }
 
+template<typename TKey, typename TElement, int Order, bool Counted>
+bool BTree<TKey, TElement, Order, Counted>::BTreeIterator::SkipTo(const TKey &key) {
+    if (stack.GetLength() == 0)
+        return false;
+    if (hasCurrent && !(currentKey < key))
+        return MoveNext();
+
+    // Все пройденные ключи меньше key. Близкую цель ищем простым проходом по
+    // текущему листу. Иначе поднимаемся, пока разделитель в родителе (верхняя
+    // граница поддерева) меньше key, и спускаемся к key уже оттуда.
+    StoredKey target = KeyTraits::Encode(key);
+    StackNode &leaf = stack[stack.GetLength() - 1];
+    if (leaf.node->isLeaf) {
+        int index = leaf.index;
+        while (index < leaf.node->numKeys && leaf.node->keys[index] < target)
+            ++index;
+        if (index < leaf.node->numKeys) {
+            leaf.index = index;
+            return MoveNext();
+        }
+    }
+
+    int depth = stack.GetLength();
+    while (depth > 1) {
+        const StackNode &parent = stack[depth - 2];
+        if (parent.index < parent.node->numKeys && !(parent.node->keys[parent.index] < target))
+            break;
+        --depth;
+    }
+    while (stack.GetLength() > depth)
+        stack.RemoveAt(stack.GetLength() - 1);
+
+    StackNode &top = stack[depth - 1];
+    top.index = tree->FindIndex(top.node.get(), target);
+    if (top.node->isLeaf || (top.index < top.node->numKeys && top.node->keys[top.index] == target))
+        return MoveNext();
+    ShrdPtr<Node> node = top.node->children[top.index];
+    while (node && node->numKeys > 0) {
+        int index = tree->FindIndex(node.get(), target);
+        StackNode sn = {node, index};
+        stack.Append(sn);
+        if (node->isLeaf || (index < node->numKeys && node->keys[index] == target))
+            break;
+        node = node->children[index];
+    }
+    return MoveNext();
+}
 
-template<typename TKey, typename TElement>
-TKey BTree<TKey, TElement>::BTreeIterator::GetCurrentKey() const {
+template<typename TKey, typename TElement, int Order, bool Counted>
+TKey BTree<TKey, TElement, Order, Counted>::BTreeIterator::GetCurrentKey() const {
     if (!hasCurrent)
         throw std::out_of_range("Iterator out of range");
     return currentKey;
 }
 
-template<typename TKey, typename TElement>
-TElement BTree<TKey, TElement>::BTreeIterator::GetCurrentValue() const {
+template<typename TKey, typename TElement, int Order, bool Counted>
+TElement BTree<TKey, TElement, Order, Counted>::BTreeIterator::GetCurrentValue() const {
     if (!hasCurrent)
         throw std::out_of_range("Iterator out of range");
     return currentValue;
 }
 
 
-template<typename TKey, typename TElement>
-UnqPtr<IDictionaryIterator<TKey, TElement>> BTree<TKey, TElement>::GetIterator() const {
-    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new BTreeIterator(this));
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::BTreeMutableIterator(
+        BTree *tree, std::vector<TraversalRange> ranges, bool writable, bool canRemove)
+        : tree(tree), ranges(std::move(ranges)), nextRange(0), writable(writable), canRemove(canRemove), depth(0),
+          currentNode(nullptr), currentIndex(0) {
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::~BTreeMutableIterator() {
+    ApplyRemovals();
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::Reset() {
+    ApplyRemovals();
+    nextRange = 0;
+    depth = 0;
+    currentNode = nullptr;
 }
 
-template<typename TKey, typename TElement>
-TElement& BTree<TKey, TElement>::FindOrInsert(ShrdPtr<Node> &node, const TKey &key) {
-    int i = 0;
-    while (i < node->numKeys && key > node->keys[i])
-        ++i;
+// Каждый узел перед посещением делается своим для текущей эпохи, поэтому
+// запись через GetCurrentValueRef() не видна снимкам.
+template<typename TKey, typename TElement, int Order, bool Counted>
+typename BTree<TKey, TElement, Order, Counted>::Node *BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::Enter(ShrdPtr<Node> &link) {
+    return writable ? tree->MakeWritable(link) : link.get();
+}
 
-    if (i < node->numKeys && key == node->keys[i]) {
-        return node->values[i];
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::PushLeftmost(ShrdPtr<Node> &link) {
+    Node *node = Enter(link);
+    while (node && node->numKeys > 0) {
+        stack[depth++] = StackNode{node, 0};
+        if (node->isLeaf)
+            break;
+        node = Enter(node->children[0]);
     }
+}
 
-    if (node->isLeaf) {
-        if (node->numKeys == 2 * order - 1) {
-            throw std::runtime_error("BTree node is full, cannot insert.");
+template<typename TKey, typename TElement, int Order, bool Counted>
+bool BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::MoveNext() {
+    while (true) {
+        while (depth > 0) {
+            StackNode &top = stack[depth - 1];
+            if (top.index >= top.node->numKeys) {
+                --depth;
+                continue;
+            }
+            currentNode = top.node;
+            currentIndex = top.index++;
+            if (!currentNode->isLeaf)
+                PushLeftmost(currentNode->children[currentIndex + 1]);
+            return true;
         }
-        node->keys[node->numKeys] = key;
-        node->values[node->numKeys] = TElement();
-        ++node->numKeys;
-        return node->values[node->numKeys - 1];
+        if (nextRange == ranges.size())
+            break;
+        TraversalRange &range = ranges[nextRange++];
+        if (!range.link) {
+            currentNode = range.node;
+            currentIndex = range.index;
+            return true;
+        }
+        PushLeftmost(*range.link);
+    }
+    currentNode = nullptr;
+    ApplyRemovals();
+    return false;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::CheckCurrent() const {
+    if (!currentNode)
+        throw std::out_of_range("Iterator out of range");
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+TKey BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::GetCurrentKey() const {
+    CheckCurrent();
+    return KeyTraits::Decode(currentNode->keys[currentIndex]);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+TElement BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::GetCurrentValue() const {
+    CheckCurrent();
+    return currentNode->values[currentIndex];
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+TElement &BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::GetCurrentValueRef() {
+    CheckCurrent();
+    if (!writable)
+        throw std::runtime_error("Iterator is read-only.");
+    return currentNode->values[currentIndex];
+}
+
+// Удаление с перебалансировкой сломало бы стек обхода, поэтому ключ только
+// запоминается.
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::RemoveCurrent() {
+    if (!canRemove)
+        throw std::runtime_error("Cannot remove elements through a partition.");
+    CheckCurrent();
+    pendingRemovals.push_back(currentNode->keys[currentIndex]);
+    currentNode = nullptr;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+void BTree<TKey, TElement, Order, Counted>::BTreeMutableIterator::ApplyRemovals() {
+    if (pendingRemovals.empty())
+        return;
+    depth = 0;
+    currentNode = nullptr;
+    if (pendingRemovals.size() == tree->count) {
+        tree->root = ShrdPtr<Node>(new Node(true, tree->Degree(), tree->epoch));
+        tree->count = 0;
+        tree->fingerDepth = 0;
+    } else {
+        for (const StoredKey &key : pendingRemovals)
+            tree->Erase(KeyTraits::Decode(key));
     }
+    pendingRemovals.clear();
+}
 
-    return FindOrInsert(node->children[i], key);
+template<typename TKey, typename TElement, int Order, bool Counted>
+UnqPtr<IMutableDictionaryIterator<TKey, TElement>> BTree<TKey, TElement, Order, Counted>::GetMutableIterator() {
+    std::vector<TraversalRange> ranges{TraversalRange{&root, nullptr, 0}};
+    return UnqPtr<IMutableDictionaryIterator<TKey, TElement>>(new BTreeMutableIterator(this, std::move(ranges), true, true));
+}
+
+// Раскрытые узлы при writable сразу делаются своими для текущей эпохи: после
+// этого каждая часть копирует только узлы собственных поддеревьев, и части
+// можно обходить параллельно.
+template<typename TKey, typename TElement, int Order, bool Counted>
+std::vector<std::vector<typename BTree<TKey, TElement, Order, Counted>::TraversalRange>>
+BTree<TKey, TElement, Order, Counted>::SplitTraversal(size_t parts, bool writable) {
+    parts = std::max<size_t>(1, parts);
+    std::vector<TraversalRange> ranges{TraversalRange{&root, nullptr, 0}};
+    size_t subtrees = 1;
+    while (subtrees < parts) {
+        std::vector<TraversalRange> expanded;
+        bool grew = false;
+        subtrees = 0;
+        for (const TraversalRange &range : ranges) {
+            if (!range.link || !*range.link || (*range.link)->isLeaf) {
+                expanded.push_back(range);
+                subtrees += range.link ? 1 : 0;
+                continue;
+            }
+            Node *node = writable ? MakeWritable(*range.link) : range.link->get();
+            for (int i = 0; i < node->numKeys; ++i) {
+                expanded.push_back(TraversalRange{&node->children[i], nullptr, 0});
+                expanded.push_back(TraversalRange{nullptr, node, i});
+            }
+            expanded.push_back(TraversalRange{&node->children[node->numKeys], nullptr, 0});
+            subtrees += node->numKeys + 1;
+            grew = true;
+        }
+        ranges.swap(expanded);
+        if (!grew)
+            break;
+    }
+
+    // Поддеревья одного уровня примерно равны, поэтому части делятся по их числу.
+    std::vector<std::vector<TraversalRange>> groups(1);
+    size_t taken = 0;
+    for (const TraversalRange &range : ranges) {
+        if (range.link) {
+            if (groups.size() < parts && !groups.back().empty() && taken >= subtrees * groups.size() / parts)
+                groups.emplace_back();
+            ++taken;
+        }
+        groups.back().push_back(range);
+    }
+    return groups;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>>
+BTree<TKey, TElement, Order, Counted>::GetPartitions(size_t parts) const {
+    BTree *self = const_cast<BTree *>(this);
+    std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> partitions;
+    for (std::vector<TraversalRange> &group : self->SplitTraversal(parts, false))
+        partitions.push_back(UnqPtr<IDictionaryIterator<TKey, TElement>>(
+                new BTreeMutableIterator(self, std::move(group), false, false)));
+    return partitions;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>>
+BTree<TKey, TElement, Order, Counted>::GetMutablePartitions(size_t parts) {
+    std::vector<std::vector<TraversalRange>> groups = SplitTraversal(parts, true);
+    std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> partitions;
+    for (std::vector<TraversalRange> &group : groups)
+        partitions.push_back(UnqPtr<IMutableDictionaryIterator<TKey, TElement>>(
+                new BTreeMutableIterator(this, std::move(group), true, groups.size() == 1)));
+    return partitions;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+bool BTree<TKey, TElement, Order, Counted>::IsOrdered() const {
+    return true;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+UnqPtr<IDictionaryIterator<TKey, TElement>> BTree<TKey, TElement, Order, Counted>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new BTreeIterator(this));
 }
 
 #endif // BTREE_H
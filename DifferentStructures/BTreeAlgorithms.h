@@ -0,0 +1,190 @@
+#ifndef BTREEALGORITHMS_H
+#define BTREEALGORITHMS_H
+
+#include "BTree.h"
+#include "KeyValue.h"
+#include "UnqPtr.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Теоретико-множественные операции над BTree за O(m + n): оба дерева
+// обходятся по возрастанию, отсортированные последовательности сливаются,
+// и результат строится снизу вверх через BuildFromSorted. Порядок результата
+// совпадает с порядком первого аргумента.
+
+enum class BTreeSetOperation {
+    Union,
+    Intersection,
+    Difference
+};
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+std::vector<KeyValue<TKey, TElement>> BTreeToSortedVector(const BTree<TKey, TElement, Order, Counted> &tree) {
+    std::vector<KeyValue<TKey, TElement>> entries;
+    entries.reserve(tree.GetCount());
+    tree.ForEach([&entries](const TKey &key, const TElement &value) {
+        entries.push_back(KeyValue<TKey, TElement>(key, value));
+    });
+    return entries;
+}
+
+// Слияние отсортированных диапазонов [a, aEnd) и [b, bEnd) в out.
+// Для общих ключей значение равно combiner(значение из a, значение из b).
+template<typename TKey, typename TElement, typename TCombiner>
+void CombineSortedRanges(BTreeSetOperation operation,
+                         const KeyValue<TKey, TElement> *a, const KeyValue<TKey, TElement> *aEnd,
+                         const KeyValue<TKey, TElement> *b, const KeyValue<TKey, TElement> *bEnd,
+                         TCombiner &combiner, std::vector<KeyValue<TKey, TElement>> &out) {
+    while (a != aEnd && b != bEnd) {
+        if (a->key < b->key) {
+            if (operation != BTreeSetOperation::Intersection)
+                out.push_back(*a);
+            ++a;
+        } else if (b->key < a->key) {
+            if (operation == BTreeSetOperation::Union)
+                out.push_back(*b);
+            ++b;
+        } else {
+            if (operation != BTreeSetOperation::Difference)
+                out.push_back(KeyValue<TKey, TElement>(a->key, combiner(a->value, b->value)));
+            ++a;
+            ++b;
+        }
+    }
+    if (operation != BTreeSetOperation::Intersection)
+        out.insert(out.end(), a, aEnd);
+    if (operation == BTreeSetOperation::Union)
+        out.insert(out.end(), b, bEnd);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted, typename TCombiner>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> CombineBTrees(BTreeSetOperation operation,
+                                                            const BTree<TKey, TElement, Order, Counted> &a,
+                                                            const BTree<TKey, TElement, Order, Counted> &b,
+                                                            TCombiner combiner) {
+    std::vector<KeyValue<TKey, TElement>> left = BTreeToSortedVector(a);
+    std::vector<KeyValue<TKey, TElement>> right = BTreeToSortedVector(b);
+    std::vector<KeyValue<TKey, TElement>> merged;
+    merged.reserve(operation == BTreeSetOperation::Union ? left.size() + right.size() : left.size());
+    CombineSortedRanges(operation, left.data(), left.data() + left.size(),
+                        right.data(), right.data() + right.size(), combiner, merged);
+
+    UnqPtr<BTree<TKey, TElement, Order, Counted>> result(new BTree<TKey, TElement, Order, Counted>(a.GetOrder()));
+    result->BuildFromSorted(merged.begin(), merged.end());
+    return result;
+}
+
+// Объединение: ключи обоих деревьев, для общих - combiner(a, b).
+template<typename TKey, typename TElement, int Order, bool Counted, typename TCombiner>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> Merge(const BTree<TKey, TElement, Order, Counted> &a,
+                                                    const BTree<TKey, TElement, Order, Counted> &b,
+                                                    TCombiner combiner) {
+    return CombineBTrees(BTreeSetOperation::Union, a, b, combiner);
+}
+
+// Пересечение: только общие ключи со значением combiner(a, b).
+template<typename TKey, typename TElement, int Order, bool Counted, typename TCombiner>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> Intersect(const BTree<TKey, TElement, Order, Counted> &a,
+                                                        const BTree<TKey, TElement, Order, Counted> &b,
+                                                        TCombiner combiner) {
+    return CombineBTrees(BTreeSetOperation::Intersection, a, b, combiner);
+}
+
+// Разность: ключи a, которых нет в b, со значениями из a.
+template<typename TKey, typename TElement, int Order, bool Counted>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> Difference(const BTree<TKey, TElement, Order, Counted> &a,
+                                                         const BTree<TKey, TElement, Order, Counted> &b) {
+    return CombineBTrees(BTreeSetOperation::Difference, a, b,
+                         [](const TElement &value, const TElement &) { return value; });
+}
+
+// Параллельный вариант: оба дерева обходятся одновременно, диапазон ключей
+// делится на threads частей по квантилям большего дерева, части сливаются
+// независимо и склеиваются по порядку. threads = 0 - по числу ядер.
+template<typename TKey, typename TElement, int Order, bool Counted, typename TCombiner>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> ParallelCombineBTrees(BTreeSetOperation operation,
+                                                                    const BTree<TKey, TElement, Order, Counted> &a,
+                                                                    const BTree<TKey, TElement, Order, Counted> &b,
+                                                                    TCombiner combiner, unsigned threads = 0) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<KeyValue<TKey, TElement>> left;
+    std::vector<KeyValue<TKey, TElement>> right;
+    std::thread collector([&]() { right = BTreeToSortedVector(b); });
+    left = BTreeToSortedVector(a);
+    collector.join();
+
+    const KeyValue<TKey, TElement> *l = left.data();
+    const KeyValue<TKey, TElement> *r = right.data();
+    bool splitLeft = left.size() >= right.size();
+    size_t larger = splitLeft ? left.size() : right.size();
+    if (threads > larger / 1024 + 1)
+        threads = static_cast<unsigned>(larger / 1024 + 1);
+
+    // Границы частей: позиции в обеих последовательностях для одного ключа.
+    std::vector<size_t> leftBounds(threads + 1), rightBounds(threads + 1);
+    leftBounds[0] = rightBounds[0] = 0;
+    leftBounds[threads] = left.size();
+    rightBounds[threads] = right.size();
+    auto byKey = [](const KeyValue<TKey, TElement> &entry, const TKey &key) { return entry.key < key; };
+    for (unsigned i = 1; i < threads; ++i) {
+        size_t position = larger * i / threads;
+        if (splitLeft) {
+            leftBounds[i] = position;
+            rightBounds[i] = std::lower_bound(r, r + right.size(), l[position].key, byKey) - r;
+        } else {
+            rightBounds[i] = position;
+            leftBounds[i] = std::lower_bound(l, l + left.size(), r[position].key, byKey) - l;
+        }
+    }
+
+    std::vector<std::vector<KeyValue<TKey, TElement>>> parts(threads);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i]() {
+            TCombiner localCombiner = combiner;
+            CombineSortedRanges(operation, l + leftBounds[i], l + leftBounds[i + 1],
+                                r + rightBounds[i], r + rightBounds[i + 1], localCombiner, parts[i]);
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    std::vector<KeyValue<TKey, TElement>> merged;
+    size_t total = 0;
+    for (const auto &part : parts)
+        total += part.size();
+    merged.reserve(total);
+    for (const auto &part : parts)
+        merged.insert(merged.end(), part.begin(), part.end());
+
+    UnqPtr<BTree<TKey, TElement, Order, Counted>> result(new BTree<TKey, TElement, Order, Counted>(a.GetOrder()));
+    result->BuildFromSorted(merged.begin(), merged.end());
+    return result;
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted, typename TCombiner>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> ParallelMerge(const BTree<TKey, TElement, Order, Counted> &a,
+                                                            const BTree<TKey, TElement, Order, Counted> &b,
+                                                            TCombiner combiner, unsigned threads = 0) {
+    return ParallelCombineBTrees(BTreeSetOperation::Union, a, b, combiner, threads);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted, typename TCombiner>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> ParallelIntersect(const BTree<TKey, TElement, Order, Counted> &a,
+                                                                const BTree<TKey, TElement, Order, Counted> &b,
+                                                                TCombiner combiner, unsigned threads = 0) {
+    return ParallelCombineBTrees(BTreeSetOperation::Intersection, a, b, combiner, threads);
+}
+
+template<typename TKey, typename TElement, int Order, bool Counted>
+UnqPtr<BTree<TKey, TElement, Order, Counted>> ParallelDifference(const BTree<TKey, TElement, Order, Counted> &a,
+                                                                 const BTree<TKey, TElement, Order, Counted> &b,
+                                                                 unsigned threads = 0) {
+    return ParallelCombineBTrees(BTreeSetOperation::Difference, a, b,
+                                 [](const TElement &value, const TElement &) { return value; }, threads);
+}
+
+#endif // BTREEALGORITHMS_H
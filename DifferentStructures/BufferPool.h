@@ -0,0 +1,255 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include "HashTable.h"
+#include "UnqPtr.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#define BUFFERPOOL_ALL_PINNED "Buffer pool: all pages are pinned"
+#define BUFFERPOOL_IO_ERROR "Buffer pool: file I/O failed"
+
+// Ограниченный кэш страниц файла фиксированного размера с вытеснением CLOCK.
+// Закреплённые (pinned) страницы не вытесняются; грязные страницы
+// записываются в файл при вытеснении и в FlushAll().
+class BufferPool {
+public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    using PageId = uint32_t;
+
+    class PinnedPage {
+    public:
+        PinnedPage() : pool(nullptr), pageId(0), data(nullptr) {}
+
+        PinnedPage(BufferPool *pool, PageId pageId, char *data) : pool(pool), pageId(pageId), data(data) {}
+
+        PinnedPage(PinnedPage &&other) noexcept : pool(other.pool), pageId(other.pageId), data(other.data) {
+            other.pool = nullptr;
+            other.data = nullptr;
+        }
+
+        PinnedPage &operator=(PinnedPage &&other) noexcept {
+            if (this != &other) {
+                Release();
+                pool = other.pool;
+                pageId = other.pageId;
+                data = other.data;
+                other.pool = nullptr;
+                other.data = nullptr;
+            }
+            return *this;
+        }
+
+        PinnedPage(const PinnedPage &) = delete;
+        PinnedPage &operator=(const PinnedPage &) = delete;
+
+        ~PinnedPage() {
+            Release();
+        }
+
+        PageId GetId() const {
+            return pageId;
+        }
+
+        char *GetData() const {
+            return data;
+        }
+
+        void MarkDirty() {
+            if (pool)
+                pool->MarkDirty(pageId);
+        }
+
+        void Release() {
+            if (pool)
+                pool->UnpinPage(pageId);
+            pool = nullptr;
+            data = nullptr;
+        }
+
+    private:
+        BufferPool *pool;
+        PageId pageId;
+        char *data;
+    };
+
+    BufferPool(const std::string &path, size_t capacity)
+            : frames(new Frame[capacity < 4 ? 4 : capacity]),
+              memory(new std::max_align_t[(capacity < 4 ? 4 : capacity) * FRAME_WORDS]),
+              capacity(capacity < 4 ? 4 : capacity), clockHand(0), pageCount(0), hits(0), misses(0) {
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file.is_open()) {
+            file.clear();
+            file.open(path, std::ios::out | std::ios::binary);
+            file.close();
+            file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        }
+        if (!file.is_open())
+            throw std::runtime_error("Buffer pool: cannot open file " + path);
+
+        file.seekg(0, std::ios::end);
+        pageCount = static_cast<PageId>(static_cast<size_t>(file.tellg()) / PAGE_SIZE);
+    }
+
+    // Ошибки записи при закрытии теряются: чтобы их увидеть, нужно явно вызвать FlushAll().
+    ~BufferPool() {
+        try {
+            FlushAll();
+        } catch (...) {
+        }
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    PinnedPage FetchPage(PageId pageId) {
+        if (pageId >= pageCount)
+            throw std::out_of_range("Buffer pool: page id out of range");
+
+        if (pageTable.ContainsKey(pageId)) {
+            size_t frameIndex = pageTable.Get(pageId);
+            Frame &frame = frames[frameIndex];
+            ++frame.pinCount;
+            frame.referenced = true;
+            ++hits;
+            return PinnedPage(this, pageId, FrameData(frameIndex));
+        }
+
+        ++misses;
+        size_t frameIndex = FindVictim();
+        ReadPage(pageId, FrameData(frameIndex));
+        Install(frameIndex, pageId, false);
+        return PinnedPage(this, pageId, FrameData(frameIndex));
+    }
+
+    PinnedPage AllocatePage() {
+        size_t frameIndex = FindVictim();
+        PageId pageId = pageCount++;
+        std::memset(FrameData(frameIndex), 0, PAGE_SIZE);
+        Install(frameIndex, pageId, true);
+        return PinnedPage(this, pageId, FrameData(frameIndex));
+    }
+
+    void FlushAll() {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (frames[i].used && frames[i].dirty) {
+                WritePage(frames[i].pageId, FrameData(i));
+                frames[i].dirty = false;
+            }
+        }
+        file.flush();
+        if (!file)
+            throw std::runtime_error(BUFFERPOOL_IO_ERROR);
+    }
+
+    PageId GetPageCount() const {
+        return pageCount;
+    }
+
+    size_t GetCapacity() const {
+        return capacity;
+    }
+
+    size_t GetHits() const {
+        return hits;
+    }
+
+    size_t GetMisses() const {
+        return misses;
+    }
+
+private:
+    static constexpr size_t FRAME_WORDS = (PAGE_SIZE + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+
+    struct Frame {
+        PageId pageId = 0;
+        int pinCount = 0;
+        bool used = false;
+        bool dirty = false;
+        bool referenced = false;
+    };
+
+    std::fstream file;
+    UnqPtr<Frame[]> frames;
+    UnqPtr<std::max_align_t[]> memory;
+    HashTable<PageId, size_t> pageTable;
+    size_t capacity;
+    size_t clockHand;
+    PageId pageCount;
+    size_t hits;
+    size_t misses;
+
+    char *FrameData(size_t frameIndex) const {
+        return reinterpret_cast<char *>(memory.get() + frameIndex * FRAME_WORDS);
+    }
+
+    void Install(size_t frameIndex, PageId pageId, bool dirty) {
+        Frame &frame = frames[frameIndex];
+        frame.pageId = pageId;
+        frame.pinCount = 1;
+        frame.used = true;
+        frame.dirty = dirty;
+        frame.referenced = true;
+        pageTable.Add(pageId, frameIndex);
+    }
+
+    size_t FindVictim() {
+        for (size_t step = 0; step < 2 * capacity + 1; ++step) {
+            size_t frameIndex = clockHand;
+            clockHand = (clockHand + 1) % capacity;
+            Frame &frame = frames[frameIndex];
+
+            if (!frame.used)
+                return frameIndex;
+            if (frame.pinCount > 0)
+                continue;
+            if (frame.referenced) {
+                frame.referenced = false;
+                continue;
+            }
+
+            if (frame.dirty)
+                WritePage(frame.pageId, FrameData(frameIndex));
+            pageTable.Remove(frame.pageId);
+            frame.used = false;
+            frame.dirty = false;
+            return frameIndex;
+        }
+        throw std::runtime_error(BUFFERPOOL_ALL_PINNED);
+    }
+
+    void MarkDirty(PageId pageId) {
+        frames[pageTable.Get(pageId)].dirty = true;
+    }
+
+    void UnpinPage(PageId pageId) {
+        Frame &frame = frames[pageTable.Get(pageId)];
+        if (frame.pinCount > 0)
+            --frame.pinCount;
+    }
+
+    void ReadPage(PageId pageId, char *data) {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(pageId) * PAGE_SIZE);
+        file.read(data, PAGE_SIZE);
+        // Страница ниже pageCount обязана лежать в файле целиком: короткое чтение — это ошибка, а не нули.
+        if (!file || file.gcount() != static_cast<std::streamsize>(PAGE_SIZE)) {
+            file.clear();
+            throw std::runtime_error(BUFFERPOOL_IO_ERROR);
+        }
+    }
+
+    void WritePage(PageId pageId, const char *data) {
+        file.clear();
+        file.seekp(static_cast<std::streamoff>(pageId) * PAGE_SIZE);
+        file.write(data, PAGE_SIZE);
+        if (!file)
+            throw std::runtime_error(BUFFERPOOL_IO_ERROR);
+    }
+};
+
+#endif // BUFFERPOOL_H
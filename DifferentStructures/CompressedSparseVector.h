@@ -0,0 +1,391 @@
+#ifndef COMPRESSEDSPARSEVECTOR_H
+#define COMPRESSEDSPARSEVECTOR_H
+
+#include "IDictionary.h"
+#include "KeyValue.h"
+#include "SimdKernels.h"
+#include "UnqPtr.h"
+#include <algorithm>
+#include <concepts>
+#include <stdexcept>
+#include <vector>
+
+// Разреженный вектор в сжатом формате: ненулевые элементы лежат в двух
+// непрерывных массивах indices[] и values[], отсортированных по индексу
+// (для int и double - 12 байт на элемент). Поиск - галопом от позиции
+// последнего обращения, поэтому последовательный обход почти бесплатен.
+// Запись в конец и перезапись существующего элемента идут прямо в массивы,
+// остальные записи копятся в буфере и вливаются одним слиянием при первом
+// чтении. Из-за этого даже константные методы могут менять внутреннее
+// состояние, и объект нельзя читать из нескольких потоков одновременно.
+// TIndex = int - компактный режим (4 байта на индекс); int64_t - для
+// векторов длиной больше 2^31.
+template<typename TElement, typename TIndex = int>
+class CompressedSparseVector {
+public:
+    explicit CompressedSparseVector(TIndex length);
+
+    CompressedSparseVector(TIndex length, const IDictionary<TIndex, TElement> &source);
+
+    TIndex GetLength() const;
+
+    // Число хранимых ненулевых элементов (с учётом буфера).
+    size_t GetNonZeroCount() const;
+
+    // Верхняя оценка числа ненулевых элементов без слияния буфера.
+    size_t GetStoredCount() const;
+
+    TElement GetElement(TIndex index) const;
+
+    void SetElement(TIndex index, const TElement &value);
+
+    void RemoveElement(TIndex index);
+
+    // Обработчики - любые вызываемые объекты; вызов встраивается в цикл по массивам.
+    template<typename TFunc> requires std::invocable<TFunc &, TIndex, const TElement &>
+    void ForEach(TFunc func) const;
+
+    template<typename TFunc> requires std::invocable<TFunc &, TElement>
+    void Map(TFunc func);
+
+    void MultiplyByScalar(TElement scalar);
+
+    template<typename TFunc> requires std::invocable<TFunc &, TElement, TElement>
+    TElement Reduce(TFunc func, TElement initial) const;
+
+    UnqPtr<IDictionaryIterator<TIndex, TElement>> GetIterator() const;
+
+    // Обмен с плотным буфером из GetLength() элементов (SimdKernels.h).
+    // ScatterTo записывает ненулевые элементы, не трогая остальные позиции буфера.
+    void ScatterTo(TElement *dense) const;
+
+    // Заменяет содержимое значениями dense[pattern[i]]; pattern - возрастающие
+    // индексы, нулевые значения не сохраняются.
+    void GatherFrom(const TElement *dense, const std::vector<TIndex> &pattern);
+
+    // dense[i] += alpha * x[i] для ненулевых x[i].
+    void AccumulateInto(TElement *dense, TElement alpha) const;
+
+    // Вливает буфер записей в основные массивы.
+    void Compact() const;
+
+    // Непрерывные массивы для вычислительных ядер; действительны до следующей записи.
+    const TIndex *Indices() const;
+
+    const TElement *Values() const;
+
+private:
+    TIndex length;
+    mutable std::vector<TIndex> indices;
+    mutable std::vector<TElement> values;
+    // Отложенные записи в порядке поступления; нулевое значение - удаление.
+    mutable std::vector<KeyValue<TIndex, TElement>> staged;
+    mutable size_t cursor;
+
+    void CheckIndex(TIndex index) const;
+
+    // Позиция первого индекса >= index, галопом от cursor.
+    size_t LowerBound(TIndex index) const;
+
+    class CompressedSparseVectorIterator : public IDictionaryIterator<TIndex, TElement> {
+    public:
+        CompressedSparseVectorIterator(const CompressedSparseVector *vector);
+
+        virtual ~CompressedSparseVectorIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TIndex GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const CompressedSparseVector *vector;
+        long long position;
+    };
+};
+
+template<typename TElement, typename TIndex>
+CompressedSparseVector<TElement, TIndex>::CompressedSparseVector(TIndex length)
+        : length(length), cursor(0) {
+}
+
+template<typename TElement, typename TIndex>
+CompressedSparseVector<TElement, TIndex>::CompressedSparseVector(TIndex length, const IDictionary<TIndex, TElement> &source)
+        : length(length), cursor(0) {
+    indices.reserve(source.GetCount());
+    values.reserve(source.GetCount());
+    auto iterator = source.GetIterator();
+    while (iterator->MoveNext()) {
+        CheckIndex(iterator->GetCurrentKey());
+        if (iterator->GetCurrentValue() != TElement())
+            staged.push_back(KeyValue<TIndex, TElement>(iterator->GetCurrentKey(), iterator->GetCurrentValue()));
+    }
+    Compact();
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::CheckIndex(TIndex index) const {
+    if (index < 0 || index >= length) {
+        throw std::out_of_range("Index is out of bounds.");
+    }
+}
+
+template<typename TElement, typename TIndex>
+TIndex CompressedSparseVector<TElement, TIndex>::GetLength() const {
+    return length;
+}
+
+template<typename TElement, typename TIndex>
+size_t CompressedSparseVector<TElement, TIndex>::GetNonZeroCount() const {
+    Compact();
+    return indices.size();
+}
+
+template<typename TElement, typename TIndex>
+size_t CompressedSparseVector<TElement, TIndex>::GetStoredCount() const {
+    return indices.size() + staged.size();
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::Compact() const {
+    if (staged.empty())
+        return;
+
+    // Устойчивая сортировка сохраняет порядок записей в один индекс: побеждает последняя.
+    std::stable_sort(staged.begin(), staged.end(),
+                     [](const KeyValue<TIndex, TElement> &a, const KeyValue<TIndex, TElement> &b) { return a.key < b.key; });
+
+    std::vector<TIndex> mergedIndices;
+    std::vector<TElement> mergedValues;
+    mergedIndices.reserve(indices.size() + staged.size());
+    mergedValues.reserve(indices.size() + staged.size());
+
+    size_t i = 0;
+    size_t s = 0;
+    while (i < indices.size() || s < staged.size()) {
+        if (s == staged.size() || (i < indices.size() && indices[i] < staged[s].key)) {
+            mergedIndices.push_back(indices[i]);
+            mergedValues.push_back(values[i]);
+            ++i;
+            continue;
+        }
+        TIndex index = staged[s].key;
+        while (s + 1 < staged.size() && staged[s + 1].key == index)
+            ++s;
+        if (i < indices.size() && indices[i] == index)
+            ++i;
+        if (staged[s].value != TElement()) {
+            mergedIndices.push_back(index);
+            mergedValues.push_back(staged[s].value);
+        }
+        ++s;
+    }
+
+    indices.swap(mergedIndices);
+    values.swap(mergedValues);
+    staged.clear();
+    cursor = 0;
+}
+
+template<typename TElement, typename TIndex>
+size_t CompressedSparseVector<TElement, TIndex>::LowerBound(TIndex index) const {
+    size_t size = indices.size();
+    size_t low;
+    size_t high;
+    if (cursor < size && indices[cursor] < index) {
+        // Галоп вправо: шаг удваивается, пока не перешагнём index.
+        size_t step = 1;
+        low = cursor + 1;
+        high = low;
+        while (high < size && indices[high] < index) {
+            low = high + 1;
+            high += step;
+            step *= 2;
+        }
+        high = std::min(high, size);
+    } else {
+        size_t step = 1;
+        high = std::min(cursor, size);
+        low = high;
+        while (low > 0 && indices[low - 1] >= index) {
+            high = low - 1;
+            low = high > step ? high - step : 0;
+            step *= 2;
+        }
+    }
+    size_t position = std::lower_bound(indices.begin() + low, indices.begin() + high, index) - indices.begin();
+    cursor = position;
+    return position;
+}
+
+template<typename TElement, typename TIndex>
+TElement CompressedSparseVector<TElement, TIndex>::GetElement(TIndex index) const {
+    CheckIndex(index);
+    Compact();
+    size_t position = LowerBound(index);
+    if (position < indices.size() && indices[position] == index)
+        return values[position];
+    return TElement();
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::SetElement(TIndex index, const TElement &value) {
+    CheckIndex(index);
+    if (staged.empty()) {
+        if (value != TElement() && (indices.empty() || indices.back() < index)) {
+            indices.push_back(index);
+            values.push_back(value);
+            return;
+        }
+        size_t position = LowerBound(index);
+        bool present = position < indices.size() && indices[position] == index;
+        if (present && value != TElement()) {
+            values[position] = value;
+            return;
+        }
+        if (!present && value == TElement())
+            return;
+    }
+    staged.push_back(KeyValue<TIndex, TElement>(index, value));
+    // Буфер не должен расти больше самих данных.
+    if (staged.size() > std::max<size_t>(1024, indices.size()))
+        Compact();
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::RemoveElement(TIndex index) {
+    SetElement(index, TElement());
+}
+
+template<typename TElement, typename TIndex>
+template<typename TFunc> requires std::invocable<TFunc &, TIndex, const TElement &>
+void CompressedSparseVector<TElement, TIndex>::ForEach(TFunc func) const {
+    Compact();
+    for (size_t i = 0; i < indices.size(); ++i)
+        func(indices[i], values[i]);
+}
+
+template<typename TElement, typename TIndex>
+template<typename TFunc> requires std::invocable<TFunc &, TElement>
+void CompressedSparseVector<TElement, TIndex>::Map(TFunc func) {
+    Compact();
+    size_t kept = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        TElement mapped = func(values[i]);
+        if (mapped != TElement()) {
+            indices[kept] = indices[i];
+            values[kept] = mapped;
+            ++kept;
+        }
+    }
+    indices.resize(kept);
+    values.resize(kept);
+    cursor = 0;
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::MultiplyByScalar(TElement scalar) {
+    Map([scalar](TElement x) { return x * scalar; });
+}
+
+template<typename TElement, typename TIndex>
+template<typename TFunc> requires std::invocable<TFunc &, TElement, TElement>
+TElement CompressedSparseVector<TElement, TIndex>::Reduce(TFunc func, TElement initial) const {
+    Compact();
+    TElement result = initial;
+    for (size_t i = 0; i < values.size(); ++i)
+        result = func(result, values[i]);
+    return result;
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::ScatterTo(TElement *dense) const {
+    Compact();
+    ScatterDense(indices.data(), values.data(), indices.size(), dense);
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::GatherFrom(const TElement *dense, const std::vector<TIndex> &pattern) {
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        CheckIndex(pattern[i]);
+        if (i > 0 && pattern[i] <= pattern[i - 1])
+            throw std::invalid_argument("Pattern indices must be strictly increasing.");
+    }
+    staged.clear();
+    indices = pattern;
+    values.resize(pattern.size());
+    GatherDense(dense, indices.data(), indices.size(), values.data());
+
+    size_t kept = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (values[i] != TElement()) {
+            indices[kept] = indices[i];
+            values[kept] = values[i];
+            ++kept;
+        }
+    }
+    indices.resize(kept);
+    values.resize(kept);
+    cursor = 0;
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::AccumulateInto(TElement *dense, TElement alpha) const {
+    Compact();
+    AccumulateDense(alpha, indices.data(), values.data(), indices.size(), dense);
+}
+
+template<typename TElement, typename TIndex>
+const TIndex *CompressedSparseVector<TElement, TIndex>::Indices() const {
+    Compact();
+    return indices.data();
+}
+
+template<typename TElement, typename TIndex>
+const TElement *CompressedSparseVector<TElement, TIndex>::Values() const {
+    Compact();
+    return values.data();
+}
+
+template<typename TElement, typename TIndex>
+CompressedSparseVector<TElement, TIndex>::CompressedSparseVectorIterator::CompressedSparseVectorIterator(
+        const CompressedSparseVector *vector)
+        : vector(vector), position(-1) {
+    vector->Compact();
+}
+
+template<typename TElement, typename TIndex>
+bool CompressedSparseVector<TElement, TIndex>::CompressedSparseVectorIterator::MoveNext() {
+    if (position < static_cast<long long>(vector->indices.size()))
+        ++position;
+    return position < static_cast<long long>(vector->indices.size());
+}
+
+template<typename TElement, typename TIndex>
+void CompressedSparseVector<TElement, TIndex>::CompressedSparseVectorIterator::Reset() {
+    position = -1;
+}
+
+template<typename TElement, typename TIndex>
+TIndex CompressedSparseVector<TElement, TIndex>::CompressedSparseVectorIterator::GetCurrentKey() const {
+    if (position < 0 || position >= static_cast<long long>(vector->indices.size()))
+        throw std::out_of_range("Iterator out of range");
+    return vector->indices[position];
+}
+
+template<typename TElement, typename TIndex>
+TElement CompressedSparseVector<TElement, TIndex>::CompressedSparseVectorIterator::GetCurrentValue() const {
+    if (position < 0 || position >= static_cast<long long>(vector->values.size()))
+        throw std::out_of_range("Iterator out of range");
+    return vector->values[position];
+}
+
+template<typename TElement, typename TIndex>
+UnqPtr<IDictionaryIterator<TIndex, TElement>> CompressedSparseVector<TElement, TIndex>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TIndex, TElement>>(new CompressedSparseVectorIterator(this));
+}
+
+#endif // COMPRESSEDSPARSEVECTOR_H
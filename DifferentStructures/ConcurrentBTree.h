@@ -0,0 +1,633 @@
+#ifndef CONCURRENTBTREE_H
+#define CONCURRENTBTREE_H
+
+#include "IDictionary.h"
+#include "UnqPtr.h"
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+// Потокобезопасное B+-дерево с оптимистичной блокировкой (optimistic lock coupling).
+// Каждый узел хранит счётчик версий: читатели спускаются без блокировок и
+// сверяют версии после чтения, писатели блокируют только изменяемые узлы.
+// Узлы никогда не объединяются и не освобождаются до разрушения дерева, поэтому
+// читатель, увидевший устаревший указатель, не обращается к освобождённой памяти.
+// Поля узла, которые читатели видят во время записи (numKeys, ключи, значения,
+// дети, next), читаются и пишутся через atomic_ref, как значения в ConcurrentSkipList.
+template<typename TKey, typename TElement>
+class ConcurrentBTree : public IDictionary<TKey, TElement> {
+    static_assert(std::is_trivially_copyable<TKey>::value,
+                  "ConcurrentBTree requires trivially copyable keys");
+    static_assert(std::is_trivially_copyable<TElement>::value,
+                  "ConcurrentBTree requires trivially copyable values");
+
+public:
+    ConcurrentBTree(int order = 16);
+
+    virtual ~ConcurrentBTree();
+
+    ConcurrentBTree(const ConcurrentBTree &) = delete;
+    ConcurrentBTree &operator=(const ConcurrentBTree &) = delete;
+
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const TKey &key) const override;
+
+    virtual bool ContainsKey(const TKey &key) const override;
+
+    virtual void Add(const TKey &key, const TElement &element) override;
+
+    virtual void Remove(const TKey &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
+
+    virtual bool IsOrdered() const override;
+
+    // Ссылка остаётся корректной, только пока другие потоки не изменяют дерево.
+    virtual TElement &operator[](const TKey &key) override;
+
+    bool TryGet(const TKey &key, TElement &value) const;
+
+    bool Upsert(const TKey &key, const TElement &element);
+
+    bool Erase(const TKey &key);
+
+private:
+    static constexpr uint64_t LOCKED_BIT = 2;
+
+    struct Node {
+        std::atomic<uint64_t> version;
+        bool isLeaf;
+        int numKeys;
+        UnqPtr<TKey[]> keys;
+        UnqPtr<TElement[]> values;
+        UnqPtr<Node *[]> children;
+        Node *next;
+
+        Node(bool leaf, int order);
+
+        uint64_t ReadLockOrRestart(bool &restart) const;
+
+        void CheckOrRestart(uint64_t readVersion, bool &restart) const;
+
+        void UpgradeToWriteLockOrRestart(uint64_t &readVersion, bool &restart);
+
+        void WriteUnlock();
+    };
+
+    std::atomic<Node *> root;
+    Node *firstLeaf;
+    int order;
+    std::atomic<size_t> count;
+
+    int MaxKeys() const;
+
+    template<typename T>
+    static T LoadField(const T &field, std::memory_order order = std::memory_order_relaxed);
+
+    template<typename T>
+    static void StoreField(T &field, const T &value, std::memory_order order = std::memory_order_relaxed);
+
+    int LowerBound(const Node *node, const TKey &key) const;
+
+    int ChildIndex(const Node *node, const TKey &key) const;
+
+    TElement *InsertImpl(const TKey &key, const TElement &element, bool overwrite, bool &inserted);
+
+    Node *SplitLeaf(Node *leaf, TKey &separator);
+
+    Node *SplitInner(Node *inner, TKey &separator);
+
+    void InsertIntoInner(Node *inner, const TKey &separator, Node *child);
+
+    void MakeRoot(const TKey &separator, Node *left, Node *right);
+
+    void FreeNode(Node *node);
+
+    class ConcurrentBTreeIterator : public IDictionaryIterator<TKey, TElement> {
+    public:
+        ConcurrentBTreeIterator(const ConcurrentBTree *tree);
+
+        virtual ~ConcurrentBTreeIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const ConcurrentBTree *tree;
+        Node *nextLeaf;
+        UnqPtr<TKey[]> keys;
+        UnqPtr<TElement[]> values;
+        int bufferCount;
+        int position;
+
+        void LoadLeaf(Node *leaf);
+    };
+};
+
+template<typename TKey, typename TElement>
+ConcurrentBTree<TKey, TElement>::Node::Node(bool leaf, int order)
+        : version(0), isLeaf(leaf), numKeys(0), keys(new TKey[2 * order - 1]),
+          values(leaf ? new TElement[2 * order - 1] : nullptr),
+          children(leaf ? nullptr : new Node *[2 * order]()), next(nullptr) {
+}
+
+template<typename TKey, typename TElement>
+uint64_t ConcurrentBTree<TKey, TElement>::Node::ReadLockOrRestart(bool &restart) const {
+    uint64_t current = version.load(std::memory_order_acquire);
+    if (current & LOCKED_BIT) {
+        std::this_thread::yield();
+        restart = true;
+    }
+    return current;
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::Node::CheckOrRestart(uint64_t readVersion, bool &restart) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (version.load(std::memory_order_relaxed) != readVersion)
+        restart = true;
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::Node::UpgradeToWriteLockOrRestart(uint64_t &readVersion, bool &restart) {
+    if (version.compare_exchange_strong(readVersion, readVersion + LOCKED_BIT, std::memory_order_acquire)) {
+        readVersion += LOCKED_BIT;
+    } else {
+        std::this_thread::yield();
+        restart = true;
+    }
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::Node::WriteUnlock() {
+    version.fetch_add(LOCKED_BIT, std::memory_order_release);
+}
+
+template<typename TKey, typename TElement>
+ConcurrentBTree<TKey, TElement>::ConcurrentBTree(int order)
+        : root(nullptr), firstLeaf(nullptr), order(order < 2 ? 2 : order), count(0) {
+    firstLeaf = new Node(true, this->order);
+    root.store(firstLeaf, std::memory_order_release);
+}
+
+template<typename TKey, typename TElement>
+ConcurrentBTree<TKey, TElement>::~ConcurrentBTree() {
+    FreeNode(root.load(std::memory_order_acquire));
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::FreeNode(Node *node) {
+    if (!node)
+        return;
+    if (!node->isLeaf) {
+        for (int i = 0; i <= node->numKeys; ++i)
+            FreeNode(node->children[i]);
+    }
+    delete node;
+}
+
+template<typename TKey, typename TElement>
+int ConcurrentBTree<TKey, TElement>::MaxKeys() const {
+    return 2 * order - 1;
+}
+
+// Указатели на детей и next публикуются с release и читаются с acquire:
+// читатель, получивший новый узел, видит его заполненным.
+template<typename TKey, typename TElement>
+template<typename T>
+T ConcurrentBTree<TKey, TElement>::LoadField(const T &field, std::memory_order order) {
+    return std::atomic_ref<T>(const_cast<T &>(field)).load(order);
+}
+
+template<typename TKey, typename TElement>
+template<typename T>
+void ConcurrentBTree<TKey, TElement>::StoreField(T &field, const T &value, std::memory_order order) {
+    std::atomic_ref<T>(field).store(value, order);
+}
+
+// Читатель может увидеть numKeys во время записи, поэтому границу поиска
+// ограничиваем ёмкостью узла; результат всё равно проверяется по версии.
+template<typename TKey, typename TElement>
+int ConcurrentBTree<TKey, TElement>::LowerBound(const Node *node, const TKey &key) const {
+    int numKeys = LoadField(node->numKeys);
+    if (numKeys > MaxKeys())
+        numKeys = MaxKeys();
+    int index = 0;
+    while (index < numKeys && LoadField(node->keys[index]) < key)
+        ++index;
+    return index;
+}
+
+template<typename TKey, typename TElement>
+int ConcurrentBTree<TKey, TElement>::ChildIndex(const Node *node, const TKey &key) const {
+    int numKeys = LoadField(node->numKeys);
+    if (numKeys > MaxKeys())
+        numKeys = MaxKeys();
+    int index = 0;
+    while (index < numKeys && !(key < LoadField(node->keys[index])))
+        ++index;
+    return index;
+}
+
+template<typename TKey, typename TElement>
+size_t ConcurrentBTree<TKey, TElement>::GetCount() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentBTree<TKey, TElement>::TryGet(const TKey &key, TElement &value) const {
+    while (true) {
+        bool restart = false;
+        Node *node = root.load(std::memory_order_acquire);
+        uint64_t nodeVersion = node->ReadLockOrRestart(restart);
+        if (restart || node != root.load(std::memory_order_acquire))
+            continue;
+
+        Node *parent = nullptr;
+        uint64_t parentVersion = 0;
+        while (!node->isLeaf) {
+            if (parent) {
+                parent->CheckOrRestart(parentVersion, restart);
+                if (restart)
+                    break;
+            }
+            parent = node;
+            parentVersion = nodeVersion;
+            node = LoadField(parent->children[ChildIndex(parent, key)], std::memory_order_acquire);
+            parent->CheckOrRestart(parentVersion, restart);
+            if (restart || !node) {
+                restart = true;
+                break;
+            }
+            nodeVersion = node->ReadLockOrRestart(restart);
+            if (restart)
+                break;
+        }
+        if (restart)
+            continue;
+
+        int index = LowerBound(node, key);
+        bool found = index < LoadField(node->numKeys) && LoadField(node->keys[index]) == key;
+        TElement candidate = found ? LoadField(node->values[index]) : TElement();
+
+        node->CheckOrRestart(nodeVersion, restart);
+        if (!restart && parent)
+            parent->CheckOrRestart(parentVersion, restart);
+        if (restart)
+            continue;
+
+        if (found)
+            value = candidate;
+        return found;
+    }
+}
+
+template<typename TKey, typename TElement>
+TElement ConcurrentBTree<TKey, TElement>::Get(const TKey &key) const {
+    TElement value;
+    if (!TryGet(key, value))
+        throw std::runtime_error("Key not found.");
+    return value;
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentBTree<TKey, TElement>::ContainsKey(const TKey &key) const {
+    TElement value;
+    return TryGet(key, value);
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::Add(const TKey &key, const TElement &element) {
+    Upsert(key, element);
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentBTree<TKey, TElement>::Upsert(const TKey &key, const TElement &element) {
+    bool inserted = false;
+    InsertImpl(key, element, true, inserted);
+    return inserted;
+}
+
+template<typename TKey, typename TElement>
+TElement &ConcurrentBTree<TKey, TElement>::operator[](const TKey &key) {
+    bool inserted = false;
+    return *InsertImpl(key, TElement(), false, inserted);
+}
+
+// Спуск с упреждающим расщеплением: полный узел блокируется вместе с родителем,
+// расщепляется, после чего спуск начинается заново от корня.
+template<typename TKey, typename TElement>
+TElement *ConcurrentBTree<TKey, TElement>::InsertImpl(const TKey &key, const TElement &element,
+                                                     bool overwrite, bool &inserted) {
+    while (true) {
+        bool restart = false;
+        Node *node = root.load(std::memory_order_acquire);
+        uint64_t nodeVersion = node->ReadLockOrRestart(restart);
+        if (restart || node != root.load(std::memory_order_acquire))
+            continue;
+
+        Node *parent = nullptr;
+        uint64_t parentVersion = 0;
+        bool split = false;
+
+        while (true) {
+            if (LoadField(node->numKeys) >= MaxKeys()) {
+                if (parent) {
+                    parent->UpgradeToWriteLockOrRestart(parentVersion, restart);
+                    if (restart)
+                        break;
+                }
+                node->UpgradeToWriteLockOrRestart(nodeVersion, restart);
+                if (restart) {
+                    if (parent)
+                        parent->WriteUnlock();
+                    break;
+                }
+                if (!parent && node != root.load(std::memory_order_acquire)) {
+                    node->WriteUnlock();
+                    restart = true;
+                    break;
+                }
+
+                TKey separator;
+                Node *sibling = node->isLeaf ? SplitLeaf(node, separator) : SplitInner(node, separator);
+                if (parent)
+                    InsertIntoInner(parent, separator, sibling);
+                else
+                    MakeRoot(separator, node, sibling);
+
+                node->WriteUnlock();
+                if (parent)
+                    parent->WriteUnlock();
+                split = true;
+                break;
+            }
+
+            if (node->isLeaf)
+                break;
+
+            if (parent) {
+                parent->CheckOrRestart(parentVersion, restart);
+                if (restart)
+                    break;
+            }
+            parent = node;
+            parentVersion = nodeVersion;
+            node = LoadField(parent->children[ChildIndex(parent, key)], std::memory_order_acquire);
+            parent->CheckOrRestart(parentVersion, restart);
+            if (restart || !node) {
+                restart = true;
+                break;
+            }
+            nodeVersion = node->ReadLockOrRestart(restart);
+            if (restart)
+                break;
+        }
+        if (restart || split)
+            continue;
+
+        node->UpgradeToWriteLockOrRestart(nodeVersion, restart);
+        if (restart)
+            continue;
+        if (parent) {
+            parent->CheckOrRestart(parentVersion, restart);
+            if (restart) {
+                node->WriteUnlock();
+                continue;
+            }
+        }
+
+        int index = LowerBound(node, key);
+        if (index < node->numKeys && node->keys[index] == key) {
+            if (overwrite)
+                StoreField(node->values[index], element);
+            inserted = false;
+        } else {
+            for (int i = node->numKeys; i > index; --i) {
+                StoreField(node->keys[i], node->keys[i - 1]);
+                StoreField(node->values[i], node->values[i - 1]);
+            }
+            StoreField(node->keys[index], key);
+            StoreField(node->values[index], element);
+            StoreField(node->numKeys, node->numKeys + 1);
+            count.fetch_add(1, std::memory_order_relaxed);
+            inserted = true;
+        }
+        TElement *slot = &node->values[index];
+        node->WriteUnlock();
+        return slot;
+    }
+}
+
+template<typename TKey, typename TElement>
+typename ConcurrentBTree<TKey, TElement>::Node *
+ConcurrentBTree<TKey, TElement>::SplitLeaf(Node *leaf, TKey &separator) {
+    Node *sibling = new Node(true, order);
+    int middle = leaf->numKeys / 2;
+    for (int i = middle; i < leaf->numKeys; ++i) {
+        sibling->keys[i - middle] = leaf->keys[i];
+        sibling->values[i - middle] = leaf->values[i];
+    }
+    sibling->numKeys = leaf->numKeys - middle;
+    sibling->next = leaf->next;
+    separator = sibling->keys[0];
+
+    StoreField(leaf->next, sibling, std::memory_order_release);
+    StoreField(leaf->numKeys, middle);
+    return sibling;
+}
+
+template<typename TKey, typename TElement>
+typename ConcurrentBTree<TKey, TElement>::Node *
+ConcurrentBTree<TKey, TElement>::SplitInner(Node *inner, TKey &separator) {
+    Node *sibling = new Node(false, order);
+    int middle = inner->numKeys / 2;
+    separator = inner->keys[middle];
+    for (int i = middle + 1; i < inner->numKeys; ++i)
+        sibling->keys[i - middle - 1] = inner->keys[i];
+    for (int i = middle + 1; i <= inner->numKeys; ++i)
+        sibling->children[i - middle - 1] = inner->children[i];
+    sibling->numKeys = inner->numKeys - middle - 1;
+
+    StoreField(inner->numKeys, middle);
+    return sibling;
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::InsertIntoInner(Node *inner, const TKey &separator, Node *child) {
+    int index = ChildIndex(inner, separator);
+    for (int i = inner->numKeys; i > index; --i) {
+        StoreField(inner->keys[i], inner->keys[i - 1]);
+        StoreField(inner->children[i + 1], inner->children[i], std::memory_order_release);
+    }
+    StoreField(inner->keys[index], separator);
+    StoreField(inner->children[index + 1], child, std::memory_order_release);
+    StoreField(inner->numKeys, inner->numKeys + 1);
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::MakeRoot(const TKey &separator, Node *left, Node *right) {
+    Node *newRoot = new Node(false, order);
+    newRoot->keys[0] = separator;
+    newRoot->children[0] = left;
+    newRoot->children[1] = right;
+    newRoot->numKeys = 1;
+    root.store(newRoot, std::memory_order_release);
+}
+
+// Удаление без слияния узлов: лист может остаться недозаполненным,
+// зато блокируется только он сам.
+template<typename TKey, typename TElement>
+bool ConcurrentBTree<TKey, TElement>::Erase(const TKey &key) {
+    while (true) {
+        bool restart = false;
+        Node *node = root.load(std::memory_order_acquire);
+        uint64_t nodeVersion = node->ReadLockOrRestart(restart);
+        if (restart || node != root.load(std::memory_order_acquire))
+            continue;
+
+        Node *parent = nullptr;
+        uint64_t parentVersion = 0;
+        while (!node->isLeaf) {
+            if (parent) {
+                parent->CheckOrRestart(parentVersion, restart);
+                if (restart)
+                    break;
+            }
+            parent = node;
+            parentVersion = nodeVersion;
+            node = LoadField(parent->children[ChildIndex(parent, key)], std::memory_order_acquire);
+            parent->CheckOrRestart(parentVersion, restart);
+            if (restart || !node) {
+                restart = true;
+                break;
+            }
+            nodeVersion = node->ReadLockOrRestart(restart);
+            if (restart)
+                break;
+        }
+        if (restart)
+            continue;
+
+        node->UpgradeToWriteLockOrRestart(nodeVersion, restart);
+        if (restart)
+            continue;
+        if (parent) {
+            parent->CheckOrRestart(parentVersion, restart);
+            if (restart) {
+                node->WriteUnlock();
+                continue;
+            }
+        }
+
+        int index = LowerBound(node, key);
+        bool found = index < node->numKeys && node->keys[index] == key;
+        if (found) {
+            for (int i = index; i < node->numKeys - 1; ++i) {
+                StoreField(node->keys[i], node->keys[i + 1]);
+                StoreField(node->values[i], node->values[i + 1]);
+            }
+            StoreField(node->numKeys, node->numKeys - 1);
+            count.fetch_sub(1, std::memory_order_relaxed);
+        }
+        node->WriteUnlock();
+        return found;
+    }
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::Remove(const TKey &key) {
+    if (!Erase(key))
+        throw std::runtime_error("Key not found.");
+}
+
+template<typename TKey, typename TElement>
+ConcurrentBTree<TKey, TElement>::ConcurrentBTreeIterator::ConcurrentBTreeIterator(const ConcurrentBTree *tree)
+        : tree(tree), nextLeaf(nullptr), keys(new TKey[tree->MaxKeys()]),
+          values(new TElement[tree->MaxKeys()]), bufferCount(0), position(-1) {
+    Reset();
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::ConcurrentBTreeIterator::Reset() {
+    nextLeaf = tree->firstLeaf;
+    bufferCount = 0;
+    position = -1;
+}
+
+// Копирует содержимое листа целиком и проверяет версию; итератор не блокирует
+// писателей и видит каждый лист в согласованном состоянии.
+template<typename TKey, typename TElement>
+void ConcurrentBTree<TKey, TElement>::ConcurrentBTreeIterator::LoadLeaf(Node *leaf) {
+    while (true) {
+        bool restart = false;
+        uint64_t leafVersion = leaf->ReadLockOrRestart(restart);
+        if (restart)
+            continue;
+
+        int numKeys = LoadField(leaf->numKeys);
+        if (numKeys > tree->MaxKeys())
+            numKeys = tree->MaxKeys();
+        for (int i = 0; i < numKeys; ++i) {
+            keys[i] = LoadField(leaf->keys[i]);
+            values[i] = LoadField(leaf->values[i]);
+        }
+        Node *following = LoadField(leaf->next, std::memory_order_acquire);
+
+        leaf->CheckOrRestart(leafVersion, restart);
+        if (restart)
+            continue;
+
+        bufferCount = numKeys;
+        nextLeaf = following;
+        return;
+    }
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentBTree<TKey, TElement>::ConcurrentBTreeIterator::MoveNext() {
+    ++position;
+    while (position >= bufferCount) {
+        if (!nextLeaf) {
+            position = bufferCount;
+            return false;
+        }
+        LoadLeaf(nextLeaf);
+        position = 0;
+    }
+    return true;
+}
+
+template<typename TKey, typename TElement>
+TKey ConcurrentBTree<TKey, TElement>::ConcurrentBTreeIterator::GetCurrentKey() const {
+    if (position < 0 || position >= bufferCount)
+        throw std::out_of_range("Iterator out of range");
+    return keys[position];
+}
+
+template<typename TKey, typename TElement>
+TElement ConcurrentBTree<TKey, TElement>::ConcurrentBTreeIterator::GetCurrentValue() const {
+    if (position < 0 || position >= bufferCount)
+        throw std::out_of_range("Iterator out of range");
+    return values[position];
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentBTree<TKey, TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IDictionaryIterator<TKey, TElement>> ConcurrentBTree<TKey, TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new ConcurrentBTreeIterator(this));
+}
+
+#endif // CONCURRENTBTREE_H
@@ -0,0 +1,434 @@
+#ifndef CONCURRENTSKIPLIST_H
+#define CONCURRENTSKIPLIST_H
+
+#include "IDictionary.h"
+#include "UnqPtr.h"
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+// Неблокирующий список с пропусками (Fraser; Herlihy, Shavit). Вставка
+// связывает узел CAS-ом снизу вверх, удаление сначала помечает ссылки узла
+// (младший бит указателя), затем поиск физически выкидывает помеченные узлы.
+// Уровень 0 всегда содержит все живые ключи по возрастанию, поэтому обход
+// не блокирует писателей. Узлы не освобождаются до разрушения списка, так
+// что поток, державший устаревший указатель, не обращается к чужой памяти.
+template<typename TKey, typename TElement>
+class ConcurrentSkipList : public IDictionary<TKey, TElement> {
+    static_assert(std::is_trivially_copyable<TKey>::value,
+                  "ConcurrentSkipList requires trivially copyable keys");
+    static_assert(std::is_trivially_copyable<TElement>::value,
+                  "ConcurrentSkipList requires trivially copyable values");
+
+public:
+    ConcurrentSkipList();
+
+    virtual ~ConcurrentSkipList();
+
+    ConcurrentSkipList(const ConcurrentSkipList &) = delete;
+    ConcurrentSkipList &operator=(const ConcurrentSkipList &) = delete;
+
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const TKey &key) const override;
+
+    virtual bool ContainsKey(const TKey &key) const override;
+
+    virtual void Add(const TKey &key, const TElement &element) override;
+
+    virtual void Remove(const TKey &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
+
+    virtual bool IsOrdered() const override;
+
+    // Ссылка остаётся корректной до разрушения списка, но запись через неё
+    // не атомарна относительно других потоков.
+    virtual TElement &operator[](const TKey &key) override;
+
+    bool TryGet(const TKey &key, TElement &value) const;
+
+    bool Upsert(const TKey &key, const TElement &element);
+
+    bool Erase(const TKey &key);
+
+    // Обход ключей из отрезка [low, high] по возрастанию; видит ключи,
+    // живые в момент прохода по ним.
+    template<typename TFunc>
+    void ForEachInRange(const TKey &low, const TKey &high, TFunc func) const;
+
+private:
+    static constexpr int MAX_LEVEL = 24;
+    static constexpr uintptr_t MARK_BIT = 1;
+
+    struct Node {
+        TKey key;
+        alignas(std::atomic_ref<TElement>::required_alignment) TElement value;
+        int height;
+        UnqPtr<std::atomic<uintptr_t>[]> next;
+        // Список всех выделенных узлов для освобождения в деструкторе.
+        Node *allocated;
+
+        Node(const TKey &key, const TElement &value, int height);
+    };
+
+    Node *head;
+    std::atomic<Node *> allocatedNodes;
+    std::atomic<size_t> count;
+
+    static Node *Pointer(uintptr_t link) {
+        return reinterpret_cast<Node *>(link & ~MARK_BIT);
+    }
+
+    static bool IsMarked(uintptr_t link) {
+        return (link & MARK_BIT) != 0;
+    }
+
+    static uintptr_t Link(Node *node) {
+        return reinterpret_cast<uintptr_t>(node);
+    }
+
+    static int RandomLevel();
+
+    static TElement LoadValue(const Node *node);
+
+    static void StoreValue(Node *node, const TElement &value);
+
+    Node *AllocateNode(const TKey &key, const TElement &value, int height);
+
+    // Заполняет preds/succs на всех уровнях, по пути выкидывая помеченные узлы.
+    bool Find(const TKey &key, Node **preds, Node **succs);
+
+    // Первый живой узел с ключом не меньше key, без изменения списка.
+    const Node *LowerBound(const TKey &key) const;
+
+    Node *InsertImpl(const TKey &key, const TElement &element, bool overwrite, bool &inserted);
+
+    class ConcurrentSkipListIterator : public IDictionaryIterator<TKey, TElement> {
+    public:
+        ConcurrentSkipListIterator(const ConcurrentSkipList *list);
+
+        virtual ~ConcurrentSkipListIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const ConcurrentSkipList *list;
+        const Node *current;
+        TKey currentKey;
+        TElement currentValue;
+        bool started;
+    };
+};
+
+template<typename TKey, typename TElement>
+ConcurrentSkipList<TKey, TElement>::Node::Node(const TKey &key, const TElement &value, int height)
+        : key(key), value(value), height(height), next(new std::atomic<uintptr_t>[height]), allocated(nullptr) {
+    for (int level = 0; level < height; ++level)
+        next[level].store(0, std::memory_order_relaxed);
+}
+
+template<typename TKey, typename TElement>
+ConcurrentSkipList<TKey, TElement>::ConcurrentSkipList()
+        : head(new Node(TKey(), TElement(), MAX_LEVEL)), allocatedNodes(nullptr), count(0) {
+}
+
+template<typename TKey, typename TElement>
+ConcurrentSkipList<TKey, TElement>::~ConcurrentSkipList() {
+    Node *node = allocatedNodes.load(std::memory_order_acquire);
+    while (node) {
+        Node *following = node->allocated;
+        delete node;
+        node = following;
+    }
+    delete head;
+}
+
+template<typename TKey, typename TElement>
+int ConcurrentSkipList<TKey, TElement>::RandomLevel() {
+    thread_local uint32_t state = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state)) | 1u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return 1 + std::countr_zero(state | (1u << (MAX_LEVEL - 1)));
+}
+
+template<typename TKey, typename TElement>
+TElement ConcurrentSkipList<TKey, TElement>::LoadValue(const Node *node) {
+    return std::atomic_ref<TElement>(const_cast<TElement &>(node->value)).load(std::memory_order_acquire);
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentSkipList<TKey, TElement>::StoreValue(Node *node, const TElement &value) {
+    std::atomic_ref<TElement>(node->value).store(value, std::memory_order_release);
+}
+
+template<typename TKey, typename TElement>
+typename ConcurrentSkipList<TKey, TElement>::Node *
+ConcurrentSkipList<TKey, TElement>::AllocateNode(const TKey &key, const TElement &value, int height) {
+    Node *node = new Node(key, value, height);
+    Node *top = allocatedNodes.load(std::memory_order_relaxed);
+    do {
+        node->allocated = top;
+    } while (!allocatedNodes.compare_exchange_weak(top, node, std::memory_order_release, std::memory_order_relaxed));
+    return node;
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentSkipList<TKey, TElement>::Find(const TKey &key, Node **preds, Node **succs) {
+    retry:
+    Node *pred = head;
+    Node *current = nullptr;
+    for (int level = MAX_LEVEL - 1; level >= 0; --level) {
+        current = Pointer(pred->next[level].load(std::memory_order_acquire));
+        while (current) {
+            uintptr_t successor = current->next[level].load(std::memory_order_acquire);
+            if (IsMarked(successor)) {
+                uintptr_t expected = Link(current);
+                if (!pred->next[level].compare_exchange_strong(expected, successor & ~MARK_BIT,
+                                                               std::memory_order_acq_rel))
+                    goto retry;
+                current = Pointer(successor);
+                continue;
+            }
+            if (!(current->key < key))
+                break;
+            pred = current;
+            current = Pointer(successor);
+        }
+        preds[level] = pred;
+        succs[level] = current;
+    }
+    return current && current->key == key;
+}
+
+template<typename TKey, typename TElement>
+const typename ConcurrentSkipList<TKey, TElement>::Node *
+ConcurrentSkipList<TKey, TElement>::LowerBound(const TKey &key) const {
+    const Node *pred = head;
+    const Node *current = nullptr;
+    for (int level = MAX_LEVEL - 1; level >= 0; --level) {
+        current = Pointer(pred->next[level].load(std::memory_order_acquire));
+        while (current) {
+            uintptr_t successor = current->next[level].load(std::memory_order_acquire);
+            if (IsMarked(successor)) {
+                current = Pointer(successor);
+                continue;
+            }
+            if (!(current->key < key))
+                break;
+            pred = current;
+            current = Pointer(successor);
+        }
+    }
+    return current;
+}
+
+template<typename TKey, typename TElement>
+size_t ConcurrentSkipList<TKey, TElement>::GetCount() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentSkipList<TKey, TElement>::TryGet(const TKey &key, TElement &value) const {
+    const Node *node = LowerBound(key);
+    if (!node || !(node->key == key))
+        return false;
+    value = LoadValue(node);
+    return true;
+}
+
+template<typename TKey, typename TElement>
+TElement ConcurrentSkipList<TKey, TElement>::Get(const TKey &key) const {
+    TElement value;
+    if (!TryGet(key, value))
+        throw std::runtime_error("Key not found.");
+    return value;
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentSkipList<TKey, TElement>::ContainsKey(const TKey &key) const {
+    const Node *node = LowerBound(key);
+    return node && node->key == key;
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentSkipList<TKey, TElement>::Add(const TKey &key, const TElement &element) {
+    Upsert(key, element);
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentSkipList<TKey, TElement>::Upsert(const TKey &key, const TElement &element) {
+    bool inserted = false;
+    InsertImpl(key, element, true, inserted);
+    return inserted;
+}
+
+template<typename TKey, typename TElement>
+TElement &ConcurrentSkipList<TKey, TElement>::operator[](const TKey &key) {
+    bool inserted = false;
+    return InsertImpl(key, TElement(), false, inserted)->value;
+}
+
+template<typename TKey, typename TElement>
+typename ConcurrentSkipList<TKey, TElement>::Node *
+ConcurrentSkipList<TKey, TElement>::InsertImpl(const TKey &key, const TElement &element, bool overwrite,
+                                               bool &inserted) {
+    Node *preds[MAX_LEVEL];
+    Node *succs[MAX_LEVEL];
+    Node *node = nullptr;
+    int height = RandomLevel();
+
+    while (true) {
+        if (Find(key, preds, succs)) {
+            // Узел, выделенный на прошлой попытке, остаётся в allocatedNodes.
+            if (overwrite)
+                StoreValue(succs[0], element);
+            inserted = false;
+            return succs[0];
+        }
+
+        if (!node)
+            node = AllocateNode(key, element, height);
+        for (int level = 0; level < height; ++level)
+            node->next[level].store(Link(succs[level]), std::memory_order_relaxed);
+
+        // Точка линеаризации вставки - CAS на уровне 0.
+        uintptr_t expected = Link(succs[0]);
+        if (preds[0]->next[0].compare_exchange_strong(expected, Link(node), std::memory_order_acq_rel))
+            break;
+    }
+    count.fetch_add(1, std::memory_order_relaxed);
+    inserted = true;
+
+    for (int level = 1; level < height; ++level) {
+        while (true) {
+            uintptr_t link = node->next[level].load(std::memory_order_acquire);
+            if (IsMarked(link))
+                return node;
+            if (Pointer(link) != succs[level] &&
+                !node->next[level].compare_exchange_strong(link, Link(succs[level]), std::memory_order_acq_rel))
+                return node;
+
+            uintptr_t expected = Link(succs[level]);
+            if (preds[level]->next[level].compare_exchange_strong(expected, Link(node), std::memory_order_acq_rel))
+                break;
+            // Соседи сменились: ищем их заново; если узел уже удалён, дальше не связываем.
+            Find(key, preds, succs);
+            if (succs[0] != node)
+                return node;
+        }
+    }
+    return node;
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentSkipList<TKey, TElement>::Erase(const TKey &key) {
+    Node *preds[MAX_LEVEL];
+    Node *succs[MAX_LEVEL];
+    if (!Find(key, preds, succs))
+        return false;
+
+    Node *node = succs[0];
+    for (int level = node->height - 1; level > 0; --level) {
+        uintptr_t link = node->next[level].load(std::memory_order_acquire);
+        while (!IsMarked(link) &&
+               !node->next[level].compare_exchange_weak(link, link | MARK_BIT, std::memory_order_acq_rel)) {
+        }
+    }
+
+    // Точка линеаризации удаления - пометка ссылки уровня 0; выигрывает один поток.
+    uintptr_t link = node->next[0].load(std::memory_order_acquire);
+    while (true) {
+        if (IsMarked(link))
+            return false;
+        if (node->next[0].compare_exchange_weak(link, link | MARK_BIT, std::memory_order_acq_rel))
+            break;
+    }
+    count.fetch_sub(1, std::memory_order_relaxed);
+    Find(key, preds, succs);
+    return true;
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentSkipList<TKey, TElement>::Remove(const TKey &key) {
+    if (!Erase(key))
+        throw std::runtime_error("Key not found.");
+}
+
+template<typename TKey, typename TElement>
+template<typename TFunc>
+void ConcurrentSkipList<TKey, TElement>::ForEachInRange(const TKey &low, const TKey &high, TFunc func) const {
+    const Node *node = LowerBound(low);
+    while (node && !(high < node->key)) {
+        uintptr_t link = node->next[0].load(std::memory_order_acquire);
+        if (!IsMarked(link))
+            func(node->key, LoadValue(node));
+        node = Pointer(link);
+    }
+}
+
+template<typename TKey, typename TElement>
+ConcurrentSkipList<TKey, TElement>::ConcurrentSkipListIterator::ConcurrentSkipListIterator(
+        const ConcurrentSkipList *list)
+        : list(list), current(nullptr), currentKey(), currentValue(), started(false) {
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentSkipList<TKey, TElement>::ConcurrentSkipListIterator::MoveNext() {
+    const Node *node = started ? current : list->head;
+    if (!node)
+        return false;
+    started = true;
+
+    do {
+        node = Pointer(node->next[0].load(std::memory_order_acquire));
+    } while (node && IsMarked(node->next[0].load(std::memory_order_acquire)));
+
+    current = node;
+    if (!current)
+        return false;
+    currentKey = current->key;
+    currentValue = LoadValue(current);
+    return true;
+}
+
+template<typename TKey, typename TElement>
+void ConcurrentSkipList<TKey, TElement>::ConcurrentSkipListIterator::Reset() {
+    current = nullptr;
+    started = false;
+}
+
+template<typename TKey, typename TElement>
+TKey ConcurrentSkipList<TKey, TElement>::ConcurrentSkipListIterator::GetCurrentKey() const {
+    if (!current)
+        throw std::out_of_range("Iterator out of range");
+    return currentKey;
+}
+
+template<typename TKey, typename TElement>
+TElement ConcurrentSkipList<TKey, TElement>::ConcurrentSkipListIterator::GetCurrentValue() const {
+    if (!current)
+        throw std::out_of_range("Iterator out of range");
+    return currentValue;
+}
+
+template<typename TKey, typename TElement>
+bool ConcurrentSkipList<TKey, TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IDictionaryIterator<TKey, TElement>> ConcurrentSkipList<TKey, TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new ConcurrentSkipListIterator(this));
+}
+
+#endif // CONCURRENTSKIPLIST_H
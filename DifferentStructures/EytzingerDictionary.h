@@ -0,0 +1,240 @@
+#ifndef EYTZINGERDICTIONARY_H
+#define EYTZINGERDICTIONARY_H
+
+#include "IDictionary.h"
+#include "UnqPtr.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Неизменяемый упорядоченный словарь в раскладке Эйтцингера: отсортированные
+// ключи лежат в одном массиве в порядке обхода в ширину неявного двоичного
+// дерева (потомки узла k - 2k и 2k + 1, нумерация с единицы). Верхние уровни
+// дерева занимают несколько соседних строк кэша, спуск не содержит ветвлений,
+// а узлы на несколько уровней ниже (четыре для int) запрашиваются заранее.
+template<typename TKey, typename TElement>
+class EytzingerDictionary : public IDictionary<TKey, TElement> {
+public:
+    explicit EytzingerDictionary(const IDictionary<TKey, TElement> &source);
+
+    virtual ~EytzingerDictionary() {}
+
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const TKey &key) const override;
+
+    virtual bool ContainsKey(const TKey &key) const override;
+
+    virtual void Add(const TKey &key, const TElement &element) override;
+
+    virtual void Remove(const TKey &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
+
+    virtual bool IsOrdered() const override;
+
+    virtual TElement &operator[](const TKey &key) override;
+
+    // Итератор, первый MoveNext() которого встаёт на наименьший ключ >= key.
+    UnqPtr<IDictionaryIterator<TKey, TElement>> LowerBound(const TKey &key) const;
+
+private:
+    // Сколько ключей помещается в строку кэша: потомки узла k на log2(шага)
+    // уровней ниже лежат подряд начиная с k * шаг.
+    static constexpr size_t PREFETCH_STRIDE = sizeof(TKey) >= 64 ? 1 : std::bit_floor(64 / sizeof(TKey));
+
+    size_t count;
+    // Элемент с индексом 0 не используется.
+    std::vector<TKey> keys;
+    std::vector<TElement> values;
+
+    // Индекс наименьшего ключа >= key или 0.
+    size_t LowerBoundIndex(const TKey &key) const;
+
+    size_t Find(const TKey &key) const;
+
+    size_t First() const;
+
+    size_t Next(size_t k) const;
+
+    class EytzingerIterator : public IDictionaryIterator<TKey, TElement> {
+    public:
+        EytzingerIterator(const EytzingerDictionary *dictionary, size_t start);
+
+        virtual ~EytzingerIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const EytzingerDictionary *dictionary;
+        size_t start;
+        size_t current;
+        bool started;
+    };
+};
+
+template<typename TKey, typename TElement>
+EytzingerDictionary<TKey, TElement>::EytzingerDictionary(const IDictionary<TKey, TElement> &source)
+        : count(0) {
+    std::vector<std::pair<TKey, TElement>> entries;
+    entries.reserve(source.GetCount());
+    auto iterator = source.GetIterator();
+    while (iterator->MoveNext())
+        entries.emplace_back(iterator->GetCurrentKey(), iterator->GetCurrentValue());
+    auto byKey = [](const auto &a, const auto &b) { return a.first < b.first; };
+    if (!std::is_sorted(entries.begin(), entries.end(), byKey))
+        std::sort(entries.begin(), entries.end(), byKey);
+
+    count = entries.size();
+    keys.resize(count + 1);
+    values.resize(count + 1);
+    // Симметричный обход неявного дерева раздаёт узлам ключи по возрастанию.
+    size_t next = 0;
+    for (size_t k = First(); k != 0; k = Next(k)) {
+        keys[k] = entries[next].first;
+        values[k] = entries[next].second;
+        ++next;
+    }
+}
+
+template<typename TKey, typename TElement>
+size_t EytzingerDictionary<TKey, TElement>::First() const {
+    if (count == 0)
+        return 0;
+    size_t k = 1;
+    while (2 * k <= count)
+        k *= 2;
+    return k;
+}
+
+// Следующий узел симметричного обхода: самый левый в правом поддереве, иначе
+// подъём, пока k - правый потомок (снятие хвостовых единиц и ещё одного бита).
+template<typename TKey, typename TElement>
+size_t EytzingerDictionary<TKey, TElement>::Next(size_t k) const {
+    if (2 * k + 1 <= count) {
+        k = 2 * k + 1;
+        while (2 * k <= count)
+            k *= 2;
+        return k;
+    }
+    return k >> (std::countr_one(k) + 1);
+}
+
+template<typename TKey, typename TElement>
+size_t EytzingerDictionary<TKey, TElement>::LowerBoundIndex(const TKey &key) const {
+    const TKey *base = keys.data();
+    size_t k = 1;
+    while (k <= count) {
+#if defined(__GNUC__)
+        __builtin_prefetch(base + std::min(k * PREFETCH_STRIDE, count));
+#endif
+        k = 2 * k + (base[k] < key);
+    }
+    // Путь спуска записан в битах k: последний поворот налево указывает на ответ.
+    return k >> (std::countr_one(k) + 1);
+}
+
+template<typename TKey, typename TElement>
+size_t EytzingerDictionary<TKey, TElement>::Find(const TKey &key) const {
+    size_t k = LowerBoundIndex(key);
+    return k != 0 && !(key < keys[k]) ? k : 0;
+}
+
+template<typename TKey, typename TElement>
+size_t EytzingerDictionary<TKey, TElement>::GetCount() const {
+    return count;
+}
+
+template<typename TKey, typename TElement>
+TElement EytzingerDictionary<TKey, TElement>::Get(const TKey &key) const {
+    size_t k = Find(key);
+    if (k == 0)
+        throw std::runtime_error("Key not found.");
+    return values[k];
+}
+
+template<typename TKey, typename TElement>
+bool EytzingerDictionary<TKey, TElement>::ContainsKey(const TKey &key) const {
+    return Find(key) != 0;
+}
+
+template<typename TKey, typename TElement>
+void EytzingerDictionary<TKey, TElement>::Add(const TKey &, const TElement &) {
+    throw std::runtime_error("EytzingerDictionary is read-only.");
+}
+
+template<typename TKey, typename TElement>
+void EytzingerDictionary<TKey, TElement>::Remove(const TKey &) {
+    throw std::runtime_error("EytzingerDictionary is read-only.");
+}
+
+// Разрешён только доступ к существующему ключу: вставить новый нельзя.
+template<typename TKey, typename TElement>
+TElement &EytzingerDictionary<TKey, TElement>::operator[](const TKey &key) {
+    size_t k = Find(key);
+    if (k == 0)
+        throw std::runtime_error("EytzingerDictionary is read-only.");
+    return values[k];
+}
+
+template<typename TKey, typename TElement>
+bool EytzingerDictionary<TKey, TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IDictionaryIterator<TKey, TElement>> EytzingerDictionary<TKey, TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new EytzingerIterator(this, First()));
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IDictionaryIterator<TKey, TElement>> EytzingerDictionary<TKey, TElement>::LowerBound(const TKey &key) const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new EytzingerIterator(this, LowerBoundIndex(key)));
+}
+
+template<typename TKey, typename TElement>
+EytzingerDictionary<TKey, TElement>::EytzingerIterator::EytzingerIterator(const EytzingerDictionary *dictionary,
+                                                                          size_t start)
+        : dictionary(dictionary), start(start), current(0), started(false) {
+}
+
+template<typename TKey, typename TElement>
+bool EytzingerDictionary<TKey, TElement>::EytzingerIterator::MoveNext() {
+    if (!started) {
+        started = true;
+        current = start;
+    } else if (current != 0) {
+        current = dictionary->Next(current);
+    }
+    return current != 0;
+}
+
+template<typename TKey, typename TElement>
+void EytzingerDictionary<TKey, TElement>::EytzingerIterator::Reset() {
+    current = 0;
+    started = false;
+}
+
+template<typename TKey, typename TElement>
+TKey EytzingerDictionary<TKey, TElement>::EytzingerIterator::GetCurrentKey() const {
+    if (current == 0)
+        throw std::out_of_range("Iterator out of range");
+    return dictionary->keys[current];
+}
+
+template<typename TKey, typename TElement>
+TElement EytzingerDictionary<TKey, TElement>::EytzingerIterator::GetCurrentValue() const {
+    if (current == 0)
+        throw std::out_of_range("Iterator out of range");
+    return dictionary->values[current];
+}
+
+#endif // EYTZINGERDICTIONARY_H
@@ -7,9 +7,11 @@
 #include "ShrdPtr.h"
 #include "UnqPtr.h"
 #include "IndexPair.h"
+#include <algorithm>
 #include <functional>
 #include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 template<typename TKey, typename TElement>
 class HashTable : public IDictionary<TKey, TElement> {
@@ -32,6 +34,13 @@ public:
 
     virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
 
+    virtual UnqPtr<IMutableDictionaryIterator<TKey, TElement>> GetMutableIterator() override;
+
+    // Части - непрерывные диапазоны корзин.
+    virtual std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> GetPartitions(size_t parts) const override;
+
+    virtual std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> GetMutablePartitions(size_t parts) override;
+
 private:
     struct KeyValuePair {
         TKey key;
@@ -67,6 +76,39 @@ private:
         size_t bucketIndex;
         int listIndex;
     };
+
+    // Обход корзин [firstBucket, endBucket) с правом записи; удаление текущего
+    // элемента сдвигает цепочку, и следующий MoveNext() остаётся на той же
+    // позиции. Удаление запрещено для частей, обходимых параллельно.
+    class HashTableMutableIterator : public IMutableDictionaryIterator<TKey, TElement> {
+    public:
+        HashTableMutableIterator(HashTable *hashTable, size_t firstBucket, size_t endBucket, bool canRemove);
+
+        virtual ~HashTableMutableIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+        virtual TElement &GetCurrentValueRef() override;
+
+        virtual void RemoveCurrent() override;
+
+    private:
+        HashTable *hashTable;
+        size_t firstBucket;
+        size_t endBucket;
+        bool canRemove;
+        size_t bucketIndex;
+        int listIndex;
+        bool removed;
+
+        KeyValuePair &Current() const;
+    };
 };
 
 template<typename TKey, typename TElement>
@@ -90,7 +132,7 @@ size_t HashTable<TKey, TElement>::GetCount() const {
 
 template<typename TKey, typename TElement>
 size_t HashTable<TKey, TElement>::HashFunction(const TKey &key) const {
-    if constexpr (std::is_same<TKey, IndexPair>::value) {
+    if constexpr (IsIndexPair<TKey>::value) {
         return IndexPairHash()(key);
     } else {
         return std::hash<TKey>()(key);
@@ -270,4 +312,104 @@ UnqPtr<IDictionaryIterator<TKey, TElement>> HashTable<TKey, TElement>::GetIterat
     return UnqPtr<IDictionaryIterator<TKey, TElement>>(new HashTableIterator(this));
 }
 
+template<typename TKey, typename TElement>
+HashTable<TKey, TElement>::HashTableMutableIterator::HashTableMutableIterator(HashTable *hashTable, size_t firstBucket,
+                                                                                size_t endBucket, bool canRemove)
+        : hashTable(hashTable), firstBucket(firstBucket), endBucket(endBucket), canRemove(canRemove),
+          bucketIndex(firstBucket), listIndex(-1), removed(false) {
+}
+
+template<typename TKey, typename TElement>
+bool HashTable<TKey, TElement>::HashTableMutableIterator::MoveNext() {
+    if (!removed) {
+        ++listIndex;
+    }
+    removed = false;
+
+    while (bucketIndex < endBucket) {
+        LinkedListSmart<KeyValuePair> &chain = hashTable->table->Get(static_cast<int>(bucketIndex));
+        if (listIndex < chain.GetLength()) {
+            return true;
+        }
+        ++bucketIndex;
+        listIndex = 0;
+    }
+
+    return false;
+}
+
+template<typename TKey, typename TElement>
+void HashTable<TKey, TElement>::HashTableMutableIterator::Reset() {
+    bucketIndex = firstBucket;
+    listIndex = -1;
+    removed = false;
+}
+
+template<typename TKey, typename TElement>
+typename HashTable<TKey, TElement>::KeyValuePair &HashTable<TKey, TElement>::HashTableMutableIterator::Current() const {
+    if (removed || bucketIndex >= endBucket || listIndex < 0 ||
+        listIndex >= hashTable->table->Get(static_cast<int>(bucketIndex)).GetLength()) {
+        throw std::out_of_range("Iterator out of range");
+    }
+
+    return hashTable->table->Get(static_cast<int>(bucketIndex)).Get(listIndex);
+}
+
+template<typename TKey, typename TElement>
+TKey HashTable<TKey, TElement>::HashTableMutableIterator::GetCurrentKey() const {
+    return Current().key;
+}
+
+template<typename TKey, typename TElement>
+TElement HashTable<TKey, TElement>::HashTableMutableIterator::GetCurrentValue() const {
+    return Current().value;
+}
+
+template<typename TKey, typename TElement>
+TElement &HashTable<TKey, TElement>::HashTableMutableIterator::GetCurrentValueRef() {
+    return Current().value;
+}
+
+template<typename TKey, typename TElement>
+void HashTable<TKey, TElement>::HashTableMutableIterator::RemoveCurrent() {
+    if (!canRemove) {
+        throw std::runtime_error("Cannot remove elements through a partition.");
+    }
+    Current();
+    hashTable->table->Get(static_cast<int>(bucketIndex)).RemoveAt(listIndex);
+    --hashTable->count;
+    removed = true;
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IMutableDictionaryIterator<TKey, TElement>> HashTable<TKey, TElement>::GetMutableIterator() {
+    return UnqPtr<IMutableDictionaryIterator<TKey, TElement>>(
+            new HashTableMutableIterator(this, 0, capacity, true));
+}
+
+// Только чтение: константность снимается, потому что итератор общий с
+// изменяющими частями, а ссылки на значения наружу не выдаются.
+template<typename TKey, typename TElement>
+std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> HashTable<TKey, TElement>::GetPartitions(size_t parts) const {
+    std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> partitions;
+    parts = std::max<size_t>(1, std::min(parts, capacity));
+    HashTable *self = const_cast<HashTable *>(this);
+    for (size_t i = 0; i < parts; ++i) {
+        partitions.push_back(UnqPtr<IDictionaryIterator<TKey, TElement>>(
+                new HashTableMutableIterator(self, capacity * i / parts, capacity * (i + 1) / parts, false)));
+    }
+    return partitions;
+}
+
+template<typename TKey, typename TElement>
+std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> HashTable<TKey, TElement>::GetMutablePartitions(size_t parts) {
+    std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> partitions;
+    parts = std::max<size_t>(1, std::min(parts, capacity));
+    for (size_t i = 0; i < parts; ++i) {
+        partitions.push_back(UnqPtr<IMutableDictionaryIterator<TKey, TElement>>(
+                new HashTableMutableIterator(this, capacity * i / parts, capacity * (i + 1) / parts, parts == 1)));
+    }
+    return partitions;
+}
+
 #endif // HASHTABLE_H
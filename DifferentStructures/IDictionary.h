@@ -2,9 +2,14 @@
 #define IDICTIONARY_H
 
 #include <cstddef>
+#include <stdexcept>
+#include <vector>
 #include "IDictionaryIterator.h"
 #include "UnqPtr.h"
 
+template <typename TKey, typename TElement>
+class KeySnapshotIterator;
+
 template <typename TKey, typename TElement>
 class IDictionary
 {
@@ -20,6 +25,100 @@ public:
     virtual TElement& operator[](const TKey& key) = 0;
 
     virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const = 0;
+
+    // true, если GetIterator() перечисляет ключи по возрастанию.
+    virtual bool IsOrdered() const { return false; }
+
+    // Обход с изменением значений и удалением. Реализация по умолчанию
+    // запоминает ключи заранее и обращается к словарю через operator[] и
+    // Remove; словари с собственным обходом переопределяют её.
+    virtual UnqPtr<IMutableDictionaryIterator<TKey, TElement>> GetMutableIterator();
+
+    // Делит словарь не более чем на parts непересекающихся частей, которые
+    // можно обходить из разных потоков одновременно, пока словарь не
+    // меняется. По умолчанию часть одна - весь словарь.
+    virtual std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> GetPartitions(size_t parts) const;
+
+    // То же с доступом к значениям по ссылке. Удалять элементы можно, только
+    // если часть одна.
+    virtual std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> GetMutablePartitions(size_t parts);
 };
 
+template <typename TKey, typename TElement>
+class KeySnapshotIterator : public IMutableDictionaryIterator<TKey, TElement>
+{
+public:
+    explicit KeySnapshotIterator(IDictionary<TKey, TElement>* dictionary)
+            : dictionary(dictionary), position(-1), removed(false) {
+        keys.reserve(dictionary->GetCount());
+        auto iterator = dictionary->GetIterator();
+        while (iterator->MoveNext()) {
+            keys.push_back(iterator->GetCurrentKey());
+        }
+    }
+
+    virtual bool MoveNext() override {
+        removed = false;
+        if (position < static_cast<long long>(keys.size()))
+            ++position;
+        return position < static_cast<long long>(keys.size());
+    }
+
+    virtual void Reset() override {
+        position = -1;
+        removed = false;
+    }
+
+    virtual TKey GetCurrentKey() const override {
+        CheckCurrent();
+        return keys[position];
+    }
+
+    virtual TElement GetCurrentValue() const override {
+        CheckCurrent();
+        return dictionary->Get(keys[position]);
+    }
+
+    virtual TElement& GetCurrentValueRef() override {
+        CheckCurrent();
+        return (*dictionary)[keys[position]];
+    }
+
+    virtual void RemoveCurrent() override {
+        CheckCurrent();
+        dictionary->Remove(keys[position]);
+        removed = true;
+    }
+
+private:
+    IDictionary<TKey, TElement>* dictionary;
+    std::vector<TKey> keys;
+    long long position;
+    bool removed;
+
+    void CheckCurrent() const {
+        if (removed || position < 0 || position >= static_cast<long long>(keys.size()))
+            throw std::out_of_range("Iterator out of range");
+    }
+};
+
+template <typename TKey, typename TElement>
+UnqPtr<IMutableDictionaryIterator<TKey, TElement>> IDictionary<TKey, TElement>::GetMutableIterator() {
+    return UnqPtr<IMutableDictionaryIterator<TKey, TElement>>(new KeySnapshotIterator<TKey, TElement>(this));
+}
+
+template <typename TKey, typename TElement>
+std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> IDictionary<TKey, TElement>::GetPartitions(size_t) const {
+    std::vector<UnqPtr<IDictionaryIterator<TKey, TElement>>> partitions;
+    partitions.push_back(GetIterator());
+    return partitions;
+}
+
+template <typename TKey, typename TElement>
+std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> IDictionary<TKey, TElement>::GetMutablePartitions(size_t) {
+    std::vector<UnqPtr<IMutableDictionaryIterator<TKey, TElement>>> partitions;
+    partitions.push_back(GetMutableIterator());
+    return partitions;
+}
+
 #endif // IDICTIONARY_H
@@ -9,6 +9,16 @@ public:
 
     virtual bool MoveNext() = 0;
 
+    // То же, что MoveNext(), но пропускает ключи меньше key. Упорядоченные
+    // словари переопределяют его, чтобы перескакивать через ключи сразу.
+    virtual bool SkipTo(const TKey& key) {
+        while (MoveNext()) {
+            if (!(GetCurrentKey() < key))
+                return true;
+        }
+        return false;
+    }
+
     virtual void Reset() = 0;
 
     virtual TKey GetCurrentKey() const = 0;
@@ -16,4 +26,17 @@ public:
     virtual TElement GetCurrentValue() const = 0;
 };
 
+// Итератор, через который можно менять значения и удалять элементы во время
+// обхода. Ссылка из GetCurrentValueRef() действительна до следующего вызова
+// MoveNext() или RemoveCurrent(); после RemoveCurrent() обход продолжается
+// со следующего элемента.
+template <typename TKey, typename TElement>
+class IMutableDictionaryIterator : public IDictionaryIterator<TKey, TElement>
+{
+public:
+    virtual TElement& GetCurrentValueRef() = 0;
+
+    virtual void RemoveCurrent() = 0;
+};
+
 #endif // IDICTIONARYITERATOR_H
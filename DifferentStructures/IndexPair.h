@@ -1,40 +1,72 @@
 #ifndef INDEXPAIR_H
 #define INDEXPAIR_H
+#include <cstdint>
 #include <iostream>
+#include <type_traits>
 
-struct IndexPair {
-    int row;
-    int column;
+// Ключ элемента матрицы. TIndex = int (IndexPair) - компактный режим для
+// матриц до 2^31 строк и столбцов: пара упаковывается в один uint64_t.
+// TIndex = int64_t (IndexPair64) - для больших пространств признаков.
+template<typename TIndex>
+struct BasicIndexPair {
+    TIndex row;
+    TIndex column;
 
-    IndexPair() : row(0), column(0) {};
+    BasicIndexPair() : row(0), column(0) {};
 
-    IndexPair(int r, int c) : row(r), column(c) {}
+    BasicIndexPair(TIndex r, TIndex c) : row(r), column(c) {}
 
-    bool operator==(const IndexPair& other) const {
+    bool operator==(const BasicIndexPair& other) const {
         return row == other.row && column == other.column;
     }
 
-    bool operator<(const IndexPair& other) const {
+    bool operator<(const BasicIndexPair& other) const {
         if (row != other.row)
             return row < other.row;
         return column < other.column;
     }
 
-    bool operator>(const IndexPair& other) const {
+    bool operator>(const BasicIndexPair& other) const {
         if (row != other.row)
             return row > other.row;
         return column > other.column;
     }
 
+    // Упаковка в uint64_t с сохранением порядка: строка в старших 32 битах,
+    // столбец в младших. Инверсия знакового бита делает беззнаковое сравнение
+    // упакованных значений эквивалентным operator< и для отрицательных индексов.
+    uint64_t Pack() const requires (sizeof(TIndex) == sizeof(uint32_t)) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(row) ^ SIGN_BIT) << 32) |
+               (static_cast<uint32_t>(column) ^ SIGN_BIT);
+    }
+
+    static BasicIndexPair Unpack(uint64_t packed) requires (sizeof(TIndex) == sizeof(uint32_t)) {
+        return BasicIndexPair(static_cast<TIndex>(static_cast<uint32_t>(packed >> 32) ^ SIGN_BIT),
+                              static_cast<TIndex>(static_cast<uint32_t>(packed) ^ SIGN_BIT));
+    }
+
+private:
+    static constexpr uint32_t SIGN_BIT = 0x80000000u;
 };
 
-inline std::ostream& operator<<(std::ostream& os, const IndexPair& ip) {
+using IndexPair = BasicIndexPair<int>;
+using IndexPair64 = BasicIndexPair<int64_t>;
+
+template<typename T>
+struct IsIndexPair : std::false_type {};
+
+template<typename TIndex>
+struct IsIndexPair<BasicIndexPair<TIndex>> : std::true_type {};
+
+template<typename TIndex>
+inline std::ostream& operator<<(std::ostream& os, const BasicIndexPair<TIndex>& ip) {
     os << "(" << ip.row << ", " << ip.column << ")";
     return os;
 }
 
 struct IndexPairHash {
-    std::size_t operator()(const IndexPair& k) const {
+    template<typename TIndex>
+    std::size_t operator()(const BasicIndexPair<TIndex>& k) const {
         std::size_t row_hash = static_cast<std::size_t>(k.row) * 73856093;
         std::size_t col_hash = static_cast<std::size_t>(k.column) * 19349663;
 
@@ -0,0 +1,282 @@
+#ifndef LEARNEDINDEX_H
+#define LEARNEDINDEX_H
+
+#include "IDictionary.h"
+#include "UnqPtr.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Неизменяемый обученный индекс над отсортированными целыми ключами.
+// Позиция ключа в массиве аппроксимируется кусочно-линейной функцией с
+// ошибкой не больше epsilon (жадный "сужающийся конус", как в PGM-index),
+// сегмент находится по радикс-таблице над старшими битами ключа (как в
+// RadixSpline), а поиск завершается двоичным поиском в окне 2 * epsilon + 1.
+// Индекс строится один раз из любого IDictionary; изменение не поддерживается.
+template<typename TElement>
+class LearnedIndex : public IDictionary<int, TElement> {
+public:
+    explicit LearnedIndex(const IDictionary<int, TElement> &source, int epsilon = 32);
+
+    virtual ~LearnedIndex() {}
+
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const int &key) const override;
+
+    virtual bool ContainsKey(const int &key) const override;
+
+    virtual void Add(const int &key, const TElement &element) override;
+
+    virtual void Remove(const int &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<int, TElement>> GetIterator() const override;
+
+    virtual bool IsOrdered() const override;
+
+    virtual TElement &operator[](const int &key) override;
+
+    // Число линейных сегментов модели.
+    size_t GetSegmentCount() const;
+
+    // Память модели (сегменты и радикс-таблица) без самих ключей и значений.
+    size_t GetIndexBytes() const;
+
+private:
+    struct Segment {
+        int firstKey;
+        int firstPosition;
+        double slope;
+    };
+
+    static constexpr int MAX_RADIX_BITS = 18;
+
+    int epsilon;
+    std::vector<int> keys;
+    std::vector<TElement> values;
+    std::vector<Segment> segments;
+    // radixTable[b] - первый сегмент, чей первый ключ попадает в корзину >= b.
+    std::vector<uint32_t> radixTable;
+    int shift;
+
+    void BuildSegments();
+
+    void BuildRadixTable();
+
+    size_t FindSegment(int key) const;
+
+    // Позиция key в keys или -1.
+    long long Find(int key) const;
+
+    class LearnedIndexIterator : public IDictionaryIterator<int, TElement> {
+    public:
+        LearnedIndexIterator(const LearnedIndex *index);
+
+        virtual ~LearnedIndexIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual int GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const LearnedIndex *index;
+        long long position;
+    };
+};
+
+template<typename TElement>
+LearnedIndex<TElement>::LearnedIndex(const IDictionary<int, TElement> &source, int epsilon)
+        : epsilon(std::max(1, epsilon)), shift(0) {
+    std::vector<std::pair<int, TElement>> entries;
+    entries.reserve(source.GetCount());
+    auto iterator = source.GetIterator();
+    while (iterator->MoveNext())
+        entries.emplace_back(iterator->GetCurrentKey(), iterator->GetCurrentValue());
+    if (!std::is_sorted(entries.begin(), entries.end(),
+                        [](const auto &a, const auto &b) { return a.first < b.first; }))
+        std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    keys.reserve(entries.size());
+    values.reserve(entries.size());
+    for (auto &entry : entries) {
+        keys.push_back(entry.first);
+        values.push_back(entry.second);
+    }
+
+    BuildSegments();
+    BuildRadixTable();
+}
+
+// Сегмент продолжается, пока существует наклон, при котором все его точки
+// предсказываются с ошибкой не больше epsilon: допустимые наклоны образуют
+// конус, который сужается с каждой новой точкой.
+template<typename TElement>
+void LearnedIndex<TElement>::BuildSegments() {
+    size_t start = 0;
+    while (start < keys.size()) {
+        double low = 0;
+        double high = 1e300;
+        size_t end = start + 1;
+        for (; end < keys.size(); ++end) {
+            double dx = static_cast<double>(static_cast<long long>(keys[end]) - keys[start]);
+            double dy = static_cast<double>(end - start);
+            double newLow = std::max(low, (dy - epsilon) / dx);
+            double newHigh = std::min(high, (dy + epsilon) / dx);
+            if (newLow > newHigh)
+                break;
+            low = newLow;
+            high = newHigh;
+        }
+        double slope = end - start > 1 ? (low + high) / 2 : 0;
+        segments.push_back(Segment{keys[start], static_cast<int>(start), slope});
+        start = end;
+    }
+}
+
+template<typename TElement>
+void LearnedIndex<TElement>::BuildRadixTable() {
+    if (segments.empty())
+        return;
+    uint64_t range = static_cast<uint64_t>(static_cast<long long>(keys.back()) - keys.front());
+    int radixBits = std::min(MAX_RADIX_BITS, static_cast<int>(std::bit_width(segments.size())) + 1);
+    shift = std::max(0, static_cast<int>(std::bit_width(range)) - radixBits);
+
+    size_t buckets = static_cast<size_t>(range >> shift) + 1;
+    radixTable.assign(buckets + 1, static_cast<uint32_t>(segments.size()));
+    size_t bucket = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        uint64_t segmentBucket = static_cast<uint64_t>(static_cast<long long>(segments[i].firstKey) - keys.front()) >> shift;
+        while (bucket <= segmentBucket)
+            radixTable[bucket++] = static_cast<uint32_t>(i);
+    }
+}
+
+// Последний сегмент с firstKey <= key; вызывается только для key в [min, max].
+template<typename TElement>
+size_t LearnedIndex<TElement>::FindSegment(int key) const {
+    size_t bucket = static_cast<uint64_t>(static_cast<long long>(key) - keys.front()) >> shift;
+    size_t first = radixTable[bucket];
+    size_t last = radixTable[bucket + 1];
+    // Сегмент из предыдущей корзины покрывает начало текущей.
+    if (first > 0 && (first == segments.size() || segments[first].firstKey > key))
+        return first - 1;
+    auto it = std::upper_bound(segments.begin() + first, segments.begin() + last, key,
+                               [](int value, const Segment &segment) { return value < segment.firstKey; });
+    return static_cast<size_t>(it - segments.begin()) - 1;
+}
+
+template<typename TElement>
+long long LearnedIndex<TElement>::Find(int key) const {
+    if (keys.empty() || key < keys.front() || key > keys.back())
+        return -1;
+    size_t s = FindSegment(key);
+    const Segment &segment = segments[s];
+    long long segmentEnd = s + 1 < segments.size() ? segments[s + 1].firstPosition : static_cast<long long>(keys.size());
+
+    long long predicted = segment.firstPosition +
+                          static_cast<long long>(segment.slope * (static_cast<long long>(key) - segment.firstKey));
+    long long low = std::max<long long>(segment.firstPosition, predicted - epsilon);
+    long long high = std::min<long long>(segmentEnd, predicted + epsilon + 2);
+    if (low >= high)
+        return -1;
+    auto it = std::lower_bound(keys.begin() + low, keys.begin() + high, key);
+    if (it == keys.begin() + high || *it != key)
+        return -1;
+    return it - keys.begin();
+}
+
+template<typename TElement>
+size_t LearnedIndex<TElement>::GetCount() const {
+    return keys.size();
+}
+
+template<typename TElement>
+TElement LearnedIndex<TElement>::Get(const int &key) const {
+    long long position = Find(key);
+    if (position < 0)
+        throw std::runtime_error("Key not found.");
+    return values[position];
+}
+
+template<typename TElement>
+bool LearnedIndex<TElement>::ContainsKey(const int &key) const {
+    return Find(key) >= 0;
+}
+
+template<typename TElement>
+void LearnedIndex<TElement>::Add(const int &, const TElement &) {
+    throw std::runtime_error("LearnedIndex is read-only.");
+}
+
+template<typename TElement>
+void LearnedIndex<TElement>::Remove(const int &) {
+    throw std::runtime_error("LearnedIndex is read-only.");
+}
+
+// Разрешён только доступ к существующему ключу: вставить новый нельзя.
+template<typename TElement>
+TElement &LearnedIndex<TElement>::operator[](const int &key) {
+    long long position = Find(key);
+    if (position < 0)
+        throw std::runtime_error("LearnedIndex is read-only.");
+    return values[position];
+}
+
+template<typename TElement>
+size_t LearnedIndex<TElement>::GetSegmentCount() const {
+    return segments.size();
+}
+
+template<typename TElement>
+size_t LearnedIndex<TElement>::GetIndexBytes() const {
+    return segments.size() * sizeof(Segment) + radixTable.size() * sizeof(uint32_t);
+}
+
+template<typename TElement>
+LearnedIndex<TElement>::LearnedIndexIterator::LearnedIndexIterator(const LearnedIndex *index)
+        : index(index), position(-1) {
+}
+
+template<typename TElement>
+bool LearnedIndex<TElement>::LearnedIndexIterator::MoveNext() {
+    if (position < static_cast<long long>(index->keys.size()))
+        ++position;
+    return position < static_cast<long long>(index->keys.size());
+}
+
+template<typename TElement>
+void LearnedIndex<TElement>::LearnedIndexIterator::Reset() {
+    position = -1;
+}
+
+template<typename TElement>
+int LearnedIndex<TElement>::LearnedIndexIterator::GetCurrentKey() const {
+    if (position < 0 || position >= static_cast<long long>(index->keys.size()))
+        throw std::out_of_range("Iterator out of range");
+    return index->keys[position];
+}
+
+template<typename TElement>
+TElement LearnedIndex<TElement>::LearnedIndexIterator::GetCurrentValue() const {
+    if (position < 0 || position >= static_cast<long long>(index->keys.size()))
+        throw std::out_of_range("Iterator out of range");
+    return index->values[position];
+}
+
+template<typename TElement>
+bool LearnedIndex<TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TElement>
+UnqPtr<IDictionaryIterator<int, TElement>> LearnedIndex<TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<int, TElement>>(new LearnedIndexIterator(this));
+}
+
+#endif // LEARNEDINDEX_H
@@ -0,0 +1,504 @@
+#ifndef PAGEDBTREE_H
+#define PAGEDBTREE_H
+
+#include "IDictionary.h"
+#include "BufferPool.h"
+#include "UnqPtr.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// B+-дерево, узлы которого хранятся в страницах файла и читаются через
+// BufferPool. Страница повторяет поля Node из BTree (isLeaf, numKeys, keys,
+// values, children), только вместо указателей на детей хранятся номера страниц,
+// а значения лежат лишь в листьях; листья связаны в список для диапазонных
+// запросов. Страница 0 хранит метаданные дерева. Удаление не объединяет узлы.
+template<typename TKey, typename TElement>
+class PagedBTree : public IDictionary<TKey, TElement> {
+    static_assert(std::is_trivially_copyable<TKey>::value, "PagedBTree requires trivially copyable keys");
+    static_assert(std::is_trivially_copyable<TElement>::value, "PagedBTree requires trivially copyable values");
+
+public:
+    using PageId = BufferPool::PageId;
+
+    PagedBTree(const std::string &path, size_t poolPages = 64);
+
+    virtual ~PagedBTree();
+
+    PagedBTree(const PagedBTree &) = delete;
+    PagedBTree &operator=(const PagedBTree &) = delete;
+
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const TKey &key) const override;
+
+    virtual bool ContainsKey(const TKey &key) const override;
+
+    virtual void Add(const TKey &key, const TElement &element) override;
+
+    virtual void Remove(const TKey &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<TKey, TElement>> GetIterator() const override;
+
+    virtual bool IsOrdered() const override;
+
+    // Ссылка указывает в кадр буферного пула и действительна до следующей
+    // операции с деревом.
+    virtual TElement &operator[](const TKey &key) override;
+
+    bool TryGet(const TKey &key, TElement &value) const;
+
+    // Вызывает func(key, value) для всех ключей из [low, high) по цепочке листьев.
+    template<typename Func>
+    void ForEachInRange(const TKey &low, const TKey &high, Func func) const;
+
+    // Сбрасывает метаданные и грязные страницы на диск; при ошибке ввода-вывода бросает runtime_error.
+    // Деструктор тоже вызывает Flush(), но ошибки при закрытии молча отбрасывает.
+    void Flush();
+
+    const BufferPool &GetBufferPool() const {
+        return pool;
+    }
+
+private:
+    static constexpr uint64_t MAGIC = 0x3142455254504742ULL;
+    static constexpr PageId NO_PAGE = 0;
+
+    struct MetaPage {
+        uint64_t magic;
+        uint64_t count;
+        uint32_t root;
+        uint32_t firstLeaf;
+        uint32_t keySize;
+        uint32_t valueSize;
+    };
+
+    struct PageHeader {
+        uint32_t isLeaf;
+        uint32_t numKeys;
+        uint32_t next;
+        uint32_t reserved;
+    };
+
+    static constexpr size_t AlignUp(size_t offset, size_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    static constexpr size_t KEYS_OFFSET = AlignUp(sizeof(PageHeader), alignof(TKey));
+
+    static constexpr int LEAF_CAPACITY = static_cast<int>(
+            (BufferPool::PAGE_SIZE - KEYS_OFFSET - alignof(TElement)) / (sizeof(TKey) + sizeof(TElement)));
+
+    static constexpr int INNER_CAPACITY = static_cast<int>(
+            (BufferPool::PAGE_SIZE - KEYS_OFFSET - alignof(PageId) - sizeof(PageId)) /
+            (sizeof(TKey) + sizeof(PageId)));
+
+    static_assert(LEAF_CAPACITY >= 3 && INNER_CAPACITY >= 3, "PagedBTree entries do not fit into a page");
+
+    static constexpr size_t VALUES_OFFSET = AlignUp(KEYS_OFFSET + LEAF_CAPACITY * sizeof(TKey), alignof(TElement));
+    static constexpr size_t CHILDREN_OFFSET = AlignUp(KEYS_OFFSET + INNER_CAPACITY * sizeof(TKey), alignof(PageId));
+
+    struct PageView {
+        char *data;
+
+        PageHeader *Header() const {
+            return reinterpret_cast<PageHeader *>(data);
+        }
+
+        TKey *Keys() const {
+            return reinterpret_cast<TKey *>(data + KEYS_OFFSET);
+        }
+
+        TElement *Values() const {
+            return reinterpret_cast<TElement *>(data + VALUES_OFFSET);
+        }
+
+        PageId *Children() const {
+            return reinterpret_cast<PageId *>(data + CHILDREN_OFFSET);
+        }
+    };
+
+    mutable BufferPool pool;
+    PageId root;
+    PageId firstLeaf;
+    size_t count;
+
+    static int LowerBound(const PageView &page, const TKey &key);
+
+    static int ChildIndex(const PageView &page, const TKey &key);
+
+    bool IsFull(const PageView &page) const;
+
+    BufferPool::PinnedPage FindLeaf(const TKey &key) const;
+
+    TElement *InsertImpl(const TKey &key, const TElement &element, bool overwrite, bool &inserted);
+
+    void SplitChild(BufferPool::PinnedPage &parent, int childIndex, BufferPool::PinnedPage &child);
+
+    void WriteMeta();
+
+    class PagedBTreeIterator : public IDictionaryIterator<TKey, TElement> {
+    public:
+        PagedBTreeIterator(const PagedBTree *tree);
+
+        virtual ~PagedBTreeIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual void Reset() override;
+
+        virtual TKey GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const PagedBTree *tree;
+        PageId nextLeaf;
+        UnqPtr<TKey[]> keys;
+        UnqPtr<TElement[]> values;
+        int bufferCount;
+        int position;
+    };
+};
+
+template<typename TKey, typename TElement>
+PagedBTree<TKey, TElement>::PagedBTree(const std::string &path, size_t poolPages)
+        : pool(path, poolPages), root(NO_PAGE), firstLeaf(NO_PAGE), count(0) {
+    if (pool.GetPageCount() > 0) {
+        BufferPool::PinnedPage metaPage = pool.FetchPage(0);
+        MetaPage meta;
+        std::memcpy(&meta, metaPage.GetData(), sizeof(MetaPage));
+        if (meta.magic != MAGIC || meta.keySize != sizeof(TKey) || meta.valueSize != sizeof(TElement))
+            throw std::runtime_error("PagedBTree: file has an incompatible format.");
+        root = meta.root;
+        firstLeaf = meta.firstLeaf;
+        count = meta.count;
+        return;
+    }
+
+    BufferPool::PinnedPage metaPage = pool.AllocatePage();
+    BufferPool::PinnedPage rootPage = pool.AllocatePage();
+    PageView(rootPage.GetData()).Header()->isLeaf = 1;
+    root = rootPage.GetId();
+    firstLeaf = root;
+    metaPage.Release();
+    WriteMeta();
+}
+
+template<typename TKey, typename TElement>
+PagedBTree<TKey, TElement>::~PagedBTree() {
+    try {
+        Flush();
+    } catch (...) {
+    }
+}
+
+template<typename TKey, typename TElement>
+void PagedBTree<TKey, TElement>::WriteMeta() {
+    MetaPage meta{MAGIC, count, root, firstLeaf, sizeof(TKey), sizeof(TElement)};
+    BufferPool::PinnedPage metaPage = pool.FetchPage(0);
+    std::memcpy(metaPage.GetData(), &meta, sizeof(MetaPage));
+    metaPage.MarkDirty();
+}
+
+template<typename TKey, typename TElement>
+void PagedBTree<TKey, TElement>::Flush() {
+    WriteMeta();
+    pool.FlushAll();
+}
+
+template<typename TKey, typename TElement>
+int PagedBTree<TKey, TElement>::LowerBound(const PageView &page, const TKey &key) {
+    int low = 0;
+    int high = static_cast<int>(page.Header()->numKeys);
+    const TKey *keys = page.Keys();
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (keys[middle] < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+template<typename TKey, typename TElement>
+int PagedBTree<TKey, TElement>::ChildIndex(const PageView &page, const TKey &key) {
+    int low = 0;
+    int high = static_cast<int>(page.Header()->numKeys);
+    const TKey *keys = page.Keys();
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (key < keys[middle])
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return low;
+}
+
+template<typename TKey, typename TElement>
+bool PagedBTree<TKey, TElement>::IsFull(const PageView &page) const {
+    int capacity = page.Header()->isLeaf ? LEAF_CAPACITY : INNER_CAPACITY;
+    return static_cast<int>(page.Header()->numKeys) >= capacity;
+}
+
+template<typename TKey, typename TElement>
+size_t PagedBTree<TKey, TElement>::GetCount() const {
+    return count;
+}
+
+// Спуск закрепляет не более двух страниц: текущую и следующую.
+template<typename TKey, typename TElement>
+BufferPool::PinnedPage PagedBTree<TKey, TElement>::FindLeaf(const TKey &key) const {
+    BufferPool::PinnedPage page = pool.FetchPage(root);
+    while (!PageView(page.GetData()).Header()->isLeaf) {
+        PageView view(page.GetData());
+        PageId child = view.Children()[ChildIndex(view, key)];
+        page = pool.FetchPage(child);
+    }
+    return page;
+}
+
+template<typename TKey, typename TElement>
+bool PagedBTree<TKey, TElement>::TryGet(const TKey &key, TElement &value) const {
+    BufferPool::PinnedPage leaf = FindLeaf(key);
+    PageView view(leaf.GetData());
+    int index = LowerBound(view, key);
+    if (index < static_cast<int>(view.Header()->numKeys) && view.Keys()[index] == key) {
+        value = view.Values()[index];
+        return true;
+    }
+    return false;
+}
+
+template<typename TKey, typename TElement>
+TElement PagedBTree<TKey, TElement>::Get(const TKey &key) const {
+    TElement value;
+    if (!TryGet(key, value))
+        throw std::runtime_error("Key not found.");
+    return value;
+}
+
+template<typename TKey, typename TElement>
+bool PagedBTree<TKey, TElement>::ContainsKey(const TKey &key) const {
+    TElement value;
+    return TryGet(key, value);
+}
+
+template<typename TKey, typename TElement>
+void PagedBTree<TKey, TElement>::Add(const TKey &key, const TElement &element) {
+    bool inserted = false;
+    InsertImpl(key, element, true, inserted);
+}
+
+template<typename TKey, typename TElement>
+TElement &PagedBTree<TKey, TElement>::operator[](const TKey &key) {
+    bool inserted = false;
+    return *InsertImpl(key, TElement(), false, inserted);
+}
+
+template<typename TKey, typename TElement>
+void PagedBTree<TKey, TElement>::SplitChild(BufferPool::PinnedPage &parent, int childIndex,
+                                            BufferPool::PinnedPage &child) {
+    PageView parentView(parent.GetData());
+    PageView childView(child.GetData());
+    BufferPool::PinnedPage sibling = pool.AllocatePage();
+    PageView siblingView(sibling.GetData());
+
+    int numKeys = static_cast<int>(childView.Header()->numKeys);
+    int middle = numKeys / 2;
+    TKey separator;
+
+    if (childView.Header()->isLeaf) {
+        siblingView.Header()->isLeaf = 1;
+        for (int i = middle; i < numKeys; ++i) {
+            siblingView.Keys()[i - middle] = childView.Keys()[i];
+            siblingView.Values()[i - middle] = childView.Values()[i];
+        }
+        siblingView.Header()->numKeys = static_cast<uint32_t>(numKeys - middle);
+        siblingView.Header()->next = childView.Header()->next;
+        childView.Header()->next = sibling.GetId();
+        childView.Header()->numKeys = static_cast<uint32_t>(middle);
+        separator = siblingView.Keys()[0];
+    } else {
+        siblingView.Header()->isLeaf = 0;
+        separator = childView.Keys()[middle];
+        for (int i = middle + 1; i < numKeys; ++i)
+            siblingView.Keys()[i - middle - 1] = childView.Keys()[i];
+        for (int i = middle + 1; i <= numKeys; ++i)
+            siblingView.Children()[i - middle - 1] = childView.Children()[i];
+        siblingView.Header()->numKeys = static_cast<uint32_t>(numKeys - middle - 1);
+        childView.Header()->numKeys = static_cast<uint32_t>(middle);
+    }
+
+    int parentKeys = static_cast<int>(parentView.Header()->numKeys);
+    for (int i = parentKeys; i > childIndex; --i) {
+        parentView.Keys()[i] = parentView.Keys()[i - 1];
+        parentView.Children()[i + 1] = parentView.Children()[i];
+    }
+    parentView.Keys()[childIndex] = separator;
+    parentView.Children()[childIndex + 1] = sibling.GetId();
+    parentView.Header()->numKeys = static_cast<uint32_t>(parentKeys + 1);
+
+    parent.MarkDirty();
+    child.MarkDirty();
+    sibling.MarkDirty();
+}
+
+template<typename TKey, typename TElement>
+TElement *PagedBTree<TKey, TElement>::InsertImpl(const TKey &key, const TElement &element,
+                                                 bool overwrite, bool &inserted) {
+    BufferPool::PinnedPage page = pool.FetchPage(root);
+    if (IsFull(PageView(page.GetData()))) {
+        BufferPool::PinnedPage newRoot = pool.AllocatePage();
+        PageView rootView(newRoot.GetData());
+        rootView.Header()->isLeaf = 0;
+        rootView.Children()[0] = page.GetId();
+        SplitChild(newRoot, 0, page);
+        root = newRoot.GetId();
+        page = std::move(newRoot);
+    }
+
+    while (!PageView(page.GetData()).Header()->isLeaf) {
+        PageView view(page.GetData());
+        int index = ChildIndex(view, key);
+        BufferPool::PinnedPage child = pool.FetchPage(view.Children()[index]);
+        if (IsFull(PageView(child.GetData()))) {
+            SplitChild(page, index, child);
+            if (!(key < view.Keys()[index])) {
+                ++index;
+                child = pool.FetchPage(view.Children()[index]);
+            }
+        }
+        page = std::move(child);
+    }
+
+    PageView leaf(page.GetData());
+    int numKeys = static_cast<int>(leaf.Header()->numKeys);
+    int index = LowerBound(leaf, key);
+    if (index < numKeys && leaf.Keys()[index] == key) {
+        if (overwrite) {
+            leaf.Values()[index] = element;
+            page.MarkDirty();
+        }
+        inserted = false;
+    } else {
+        for (int i = numKeys; i > index; --i) {
+            leaf.Keys()[i] = leaf.Keys()[i - 1];
+            leaf.Values()[i] = leaf.Values()[i - 1];
+        }
+        leaf.Keys()[index] = key;
+        leaf.Values()[index] = element;
+        leaf.Header()->numKeys = static_cast<uint32_t>(numKeys + 1);
+        page.MarkDirty();
+        ++count;
+        inserted = true;
+    }
+    if (!overwrite)
+        page.MarkDirty();
+    return &leaf.Values()[index];
+}
+
+template<typename TKey, typename TElement>
+void PagedBTree<TKey, TElement>::Remove(const TKey &key) {
+    BufferPool::PinnedPage page = FindLeaf(key);
+    PageView leaf(page.GetData());
+    int numKeys = static_cast<int>(leaf.Header()->numKeys);
+    int index = LowerBound(leaf, key);
+    if (index >= numKeys || !(leaf.Keys()[index] == key))
+        throw std::runtime_error("Key not found.");
+
+    for (int i = index; i < numKeys - 1; ++i) {
+        leaf.Keys()[i] = leaf.Keys()[i + 1];
+        leaf.Values()[i] = leaf.Values()[i + 1];
+    }
+    leaf.Header()->numKeys = static_cast<uint32_t>(numKeys - 1);
+    page.MarkDirty();
+    --count;
+}
+
+template<typename TKey, typename TElement>
+template<typename Func>
+void PagedBTree<TKey, TElement>::ForEachInRange(const TKey &low, const TKey &high, Func func) const {
+    BufferPool::PinnedPage page = FindLeaf(low);
+    int index = LowerBound(PageView(page.GetData()), low);
+    while (true) {
+        PageView leaf(page.GetData());
+        int numKeys = static_cast<int>(leaf.Header()->numKeys);
+        for (; index < numKeys; ++index) {
+            if (!(leaf.Keys()[index] < high))
+                return;
+            func(leaf.Keys()[index], leaf.Values()[index]);
+        }
+        PageId next = leaf.Header()->next;
+        if (next == NO_PAGE)
+            return;
+        page = pool.FetchPage(next);
+        index = 0;
+    }
+}
+
+template<typename TKey, typename TElement>
+PagedBTree<TKey, TElement>::PagedBTreeIterator::PagedBTreeIterator(const PagedBTree *tree)
+        : tree(tree), nextLeaf(tree->firstLeaf), keys(new TKey[LEAF_CAPACITY]),
+          values(new TElement[LEAF_CAPACITY]), bufferCount(0), position(-1) {
+}
+
+template<typename TKey, typename TElement>
+void PagedBTree<TKey, TElement>::PagedBTreeIterator::Reset() {
+    nextLeaf = tree->firstLeaf;
+    bufferCount = 0;
+    position = -1;
+}
+
+// Итератор копирует один лист за раз, поэтому не держит страницы закреплёнными
+// между вызовами MoveNext().
+template<typename TKey, typename TElement>
+bool PagedBTree<TKey, TElement>::PagedBTreeIterator::MoveNext() {
+    ++position;
+    while (position >= bufferCount) {
+        if (nextLeaf == NO_PAGE) {
+            position = bufferCount;
+            return false;
+        }
+        BufferPool::PinnedPage page = tree->pool.FetchPage(nextLeaf);
+        PageView leaf(page.GetData());
+        bufferCount = static_cast<int>(leaf.Header()->numKeys);
+        for (int i = 0; i < bufferCount; ++i) {
+            keys[i] = leaf.Keys()[i];
+            values[i] = leaf.Values()[i];
+        }
+        nextLeaf = leaf.Header()->next;
+        position = 0;
+    }
+    return true;
+}
+
+template<typename TKey, typename TElement>
+TKey PagedBTree<TKey, TElement>::PagedBTreeIterator::GetCurrentKey() const {
+    if (position < 0 || position >= bufferCount)
+        throw std::out_of_range("Iterator out of range");
+    return keys[position];
+}
+
+template<typename TKey, typename TElement>
+TElement PagedBTree<TKey, TElement>::PagedBTreeIterator::GetCurrentValue() const {
+    if (position < 0 || position >= bufferCount)
+        throw std::out_of_range("Iterator out of range");
+    return values[position];
+}
+
+template<typename TKey, typename TElement>
+bool PagedBTree<TKey, TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TKey, typename TElement>
+UnqPtr<IDictionaryIterator<TKey, TElement>> PagedBTree<TKey, TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<TKey, TElement>>(new PagedBTreeIterator(this));
+}
+
+#endif // PAGEDBTREE_H
@@ -0,0 +1,818 @@
+#ifndef ROARINGDICTIONARY_H
+#define ROARINGDICTIONARY_H
+
+#include "IDictionary.h"
+#include "UnqPtr.h"
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Упорядоченный словарь с ключами int в духе Roaring bitmap: множество ключей
+// делится на куски по 2^16 (старшие 16 бит), и в каждом куске младшие биты
+// хранятся в одном из контейнеров:
+// - Array: отсортированный массив uint16_t, пока ключей не больше 4096;
+// - Bitmap: 2^16 бит и счётчики ключей перед каждым блоком из 512 бит;
+// - Run: серии подряд идущих ключей, создаются RunOptimize().
+// Значения куска лежат в одном массиве в порядке возрастания ключей, поэтому
+// поиск значения - это запрос ранга в контейнере. Запись в Run-контейнер
+// сначала разворачивает его в Array или Bitmap.
+template<typename TElement>
+class RoaringDictionary : public IDictionary<int, TElement> {
+public:
+    RoaringDictionary();
+
+    virtual ~RoaringDictionary() {}
+
+    virtual size_t GetCount() const override;
+
+    virtual TElement Get(const int &key) const override;
+
+    virtual bool ContainsKey(const int &key) const override;
+
+    virtual void Add(const int &key, const TElement &element) override;
+
+    virtual void Remove(const int &key) override;
+
+    virtual TElement &operator[](const int &key) override;
+
+    virtual UnqPtr<IDictionaryIterator<int, TElement>> GetIterator() const override;
+
+    // Значения меняются на месте, удаления применяются к контейнеру одним
+    // сжатием, когда обход из него уходит.
+    virtual UnqPtr<IMutableDictionaryIterator<int, TElement>> GetMutableIterator() override;
+
+    virtual bool IsOrdered() const override;
+
+    // Переводит в серии те контейнеры, которые так займут меньше места.
+    void RunOptimize();
+
+    // Память под ключи, значения и служебные массивы.
+    size_t GetMemoryBytes() const;
+
+    // func(key, a[key], b[key]) для общих ключей по возрастанию. Куски
+    // сопоставляются по старшим битам, пара битовых карт пересекается
+    // пословным AND, остальные пары - запросами к большему контейнеру.
+    template<typename TFunc> requires std::invocable<TFunc &, int, const TElement &, const TElement &>
+    static void Intersect(const RoaringDictionary &a, const RoaringDictionary &b, TFunc func);
+
+private:
+    static constexpr uint32_t SIGN_BIT = 0x80000000u;
+    static constexpr size_t ARRAY_LIMIT = 4096;
+    static constexpr size_t BITMAP_WORDS = 1024;
+    static constexpr size_t RANK_BLOCK_WORDS = 8;
+
+    enum class ContainerKind {
+        Array,
+        Bitmap,
+        Run
+    };
+
+    // Ключи start, ..., start + length.
+    struct Run {
+        uint16_t start;
+        uint16_t length;
+    };
+
+    struct Container {
+        uint16_t high;
+        ContainerKind kind;
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> bitmap;
+        // Число ключей перед каждым блоком из RANK_BLOCK_WORDS слов.
+        std::vector<uint16_t> blockRanks;
+        std::vector<Run> runs;
+        // Число ключей перед каждой серией.
+        std::vector<uint32_t> runRanks;
+        std::vector<TElement> values;
+    };
+
+    std::vector<Container> containers;
+    size_t count;
+
+    // Инверсия знакового бита сохраняет порядок при переходе к беззнаковым.
+    static uint32_t Encode(int key) {
+        return static_cast<uint32_t>(key) ^ SIGN_BIT;
+    }
+
+    static int Decode(uint16_t high, uint16_t low) {
+        return static_cast<int>(((static_cast<uint32_t>(high) << 16) | low) ^ SIGN_BIT);
+    }
+
+    // Первый контейнер со старшими битами >= high, начиная с from.
+    size_t FindContainer(uint16_t high, size_t from = 0) const;
+
+    // Номер low среди ключей контейнера (число меньших ключей); true, если low есть.
+    static bool Locate(const Container &container, uint16_t low, size_t &rank);
+
+    template<typename TFunc>
+    static void ForEachLow(const Container &container, TFunc func);
+
+    // Заполняет контейнер ключами lows в форме Array или Bitmap по их числу.
+    static void SetLows(Container &container, const std::vector<uint16_t> &lows);
+
+    static void RebuildBlockRanks(Container &container);
+
+    static void Expand(Container &container);
+
+    static void InsertLow(Container &container, uint16_t low, size_t rank);
+
+    static void EraseLow(Container &container, uint16_t low, size_t rank);
+
+    const TElement *Find(int key) const;
+
+    class RoaringMutableIterator;
+
+    class RoaringIterator : public IDictionaryIterator<int, TElement> {
+        friend class RoaringMutableIterator;
+
+    public:
+        RoaringIterator(const RoaringDictionary *dictionary);
+
+        virtual ~RoaringIterator() {}
+
+        virtual bool MoveNext() override;
+
+        virtual bool SkipTo(const int &key) override;
+
+        virtual void Reset() override;
+
+        virtual int GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+    private:
+        const RoaringDictionary *dictionary;
+        size_t containerIndex;
+        // Номер текущего ключа в контейнере - позиция его значения.
+        size_t rank;
+        // Позиция в array, номер серии или номер слова битовой карты.
+        size_t slot;
+        // Ещё не пройденные биты текущего слова битовой карты.
+        uint64_t remaining;
+        uint16_t low;
+        bool started;
+        bool valid;
+
+        // Встаёт на первый ключ >= from в текущем контейнере.
+        bool PositionAt(uint16_t from);
+
+        bool Advance();
+
+        // С контейнера containerIndex ищет первый непустой остаток начиная с from.
+        bool SettleFrom(uint16_t from);
+    };
+
+    // Обходит словарь через RoaringIterator. Удалённые ранги копятся для одного
+    // контейнера: пока обход в нём, ключи и значения не сдвигаются. Опустевшие
+    // контейнеры убираются в конце обхода, чтобы не сбить номер текущего.
+    class RoaringMutableIterator : public IMutableDictionaryIterator<int, TElement> {
+    public:
+        RoaringMutableIterator(RoaringDictionary *dictionary);
+
+        virtual ~RoaringMutableIterator();
+
+        virtual bool MoveNext() override;
+
+        virtual bool SkipTo(const int &key) override;
+
+        virtual void Reset() override;
+
+        virtual int GetCurrentKey() const override;
+
+        virtual TElement GetCurrentValue() const override;
+
+        virtual TElement &GetCurrentValueRef() override;
+
+        virtual void RemoveCurrent() override;
+
+    private:
+        RoaringDictionary *dictionary;
+        RoaringIterator walker;
+        size_t pendingContainer;
+        // Ранги удалённых ключей контейнера pendingContainer по возрастанию.
+        std::vector<size_t> removedRanks;
+        bool removed;
+        bool emptied;
+
+        // Сжимает pendingContainer, если обход из него ушёл; в конце обхода
+        // убирает опустевшие контейнеры.
+        bool Settle(bool moved);
+
+        void CompactPending();
+
+        void Finish();
+
+        void CheckCurrent() const;
+    };
+};
+
+template<typename TElement>
+RoaringDictionary<TElement>::RoaringDictionary() : count(0) {
+}
+
+template<typename TElement>
+size_t RoaringDictionary<TElement>::GetCount() const {
+    return count;
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::IsOrdered() const {
+    return true;
+}
+
+template<typename TElement>
+size_t RoaringDictionary<TElement>::FindContainer(uint16_t high, size_t from) const {
+    return std::lower_bound(containers.begin() + from, containers.end(), high,
+                            [](const Container &container, uint16_t value) { return container.high < value; }) -
+           containers.begin();
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::Locate(const Container &container, uint16_t low, size_t &rank) {
+    switch (container.kind) {
+        case ContainerKind::Array: {
+            rank = std::lower_bound(container.array.begin(), container.array.end(), low) - container.array.begin();
+            return rank < container.array.size() && container.array[rank] == low;
+        }
+        case ContainerKind::Bitmap: {
+            size_t word = low >> 6;
+            size_t block = word / RANK_BLOCK_WORDS;
+            rank = container.blockRanks[block];
+            for (size_t w = block * RANK_BLOCK_WORDS; w < word; ++w)
+                rank += std::popcount(container.bitmap[w]);
+            uint64_t bit = uint64_t(1) << (low & 63);
+            rank += std::popcount(container.bitmap[word] & (bit - 1));
+            return (container.bitmap[word] & bit) != 0;
+        }
+        case ContainerKind::Run: {
+            size_t next = std::upper_bound(container.runs.begin(), container.runs.end(), low,
+                                           [](uint16_t value, const Run &run) { return value < run.start; }) -
+                          container.runs.begin();
+            if (next == 0) {
+                rank = 0;
+                return false;
+            }
+            const Run &run = container.runs[next - 1];
+            if (low - run.start <= run.length) {
+                rank = container.runRanks[next - 1] + (low - run.start);
+                return true;
+            }
+            rank = container.runRanks[next - 1] + run.length + 1;
+            return false;
+        }
+    }
+    return false;
+}
+
+template<typename TElement>
+template<typename TFunc>
+void RoaringDictionary<TElement>::ForEachLow(const Container &container, TFunc func) {
+    switch (container.kind) {
+        case ContainerKind::Array:
+            for (uint16_t low : container.array)
+                func(low);
+            break;
+        case ContainerKind::Bitmap:
+            for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+                for (uint64_t bits = container.bitmap[w]; bits != 0; bits &= bits - 1)
+                    func(static_cast<uint16_t>(w * 64 + std::countr_zero(bits)));
+            }
+            break;
+        case ContainerKind::Run:
+            for (const Run &run : container.runs) {
+                for (uint32_t low = run.start; low <= uint32_t(run.start) + run.length; ++low)
+                    func(static_cast<uint16_t>(low));
+            }
+            break;
+    }
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::RebuildBlockRanks(Container &container) {
+    container.blockRanks.assign(BITMAP_WORDS / RANK_BLOCK_WORDS, 0);
+    size_t rank = 0;
+    for (size_t block = 0; block < container.blockRanks.size(); ++block) {
+        container.blockRanks[block] = static_cast<uint16_t>(rank);
+        for (size_t w = block * RANK_BLOCK_WORDS; w < (block + 1) * RANK_BLOCK_WORDS; ++w)
+            rank += std::popcount(container.bitmap[w]);
+    }
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::SetLows(Container &container, const std::vector<uint16_t> &lows) {
+    container.runs.clear();
+    container.runs.shrink_to_fit();
+    container.runRanks.clear();
+    container.runRanks.shrink_to_fit();
+    if (lows.size() <= ARRAY_LIMIT) {
+        container.kind = ContainerKind::Array;
+        container.array = lows;
+        container.bitmap.clear();
+        container.bitmap.shrink_to_fit();
+        container.blockRanks.clear();
+        container.blockRanks.shrink_to_fit();
+        return;
+    }
+    container.kind = ContainerKind::Bitmap;
+    container.bitmap.assign(BITMAP_WORDS, 0);
+    for (uint16_t low : lows)
+        container.bitmap[low >> 6] |= uint64_t(1) << (low & 63);
+    RebuildBlockRanks(container);
+    container.array.clear();
+    container.array.shrink_to_fit();
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::Expand(Container &container) {
+    if (container.kind != ContainerKind::Run)
+        return;
+    std::vector<uint16_t> lows;
+    lows.reserve(container.values.size());
+    ForEachLow(container, [&lows](uint16_t low) { lows.push_back(low); });
+    SetLows(container, lows);
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::InsertLow(Container &container, uint16_t low, size_t rank) {
+    if (container.kind == ContainerKind::Array) {
+        container.array.insert(container.array.begin() + rank, low);
+        if (container.array.size() > ARRAY_LIMIT) {
+            std::vector<uint16_t> lows;
+            lows.swap(container.array);
+            SetLows(container, lows);
+        }
+        return;
+    }
+    container.bitmap[low >> 6] |= uint64_t(1) << (low & 63);
+    for (size_t block = (low >> 6) / RANK_BLOCK_WORDS + 1; block < container.blockRanks.size(); ++block)
+        ++container.blockRanks[block];
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::EraseLow(Container &container, uint16_t low, size_t rank) {
+    if (container.kind == ContainerKind::Array) {
+        container.array.erase(container.array.begin() + rank);
+        return;
+    }
+    container.bitmap[low >> 6] &= ~(uint64_t(1) << (low & 63));
+    for (size_t block = (low >> 6) / RANK_BLOCK_WORDS + 1; block < container.blockRanks.size(); ++block)
+        --container.blockRanks[block];
+    // Значение уже удалено вызывающим, поэтому values.size() - новое число ключей.
+    if (container.values.size() <= ARRAY_LIMIT) {
+        std::vector<uint16_t> lows;
+        lows.reserve(container.values.size());
+        ForEachLow(container, [&lows](uint16_t value) { lows.push_back(value); });
+        SetLows(container, lows);
+    }
+}
+
+template<typename TElement>
+const TElement *RoaringDictionary<TElement>::Find(int key) const {
+    uint32_t encoded = Encode(key);
+    uint16_t high = static_cast<uint16_t>(encoded >> 16);
+    size_t index = FindContainer(high);
+    if (index == containers.size() || containers[index].high != high)
+        return nullptr;
+    size_t rank;
+    if (!Locate(containers[index], static_cast<uint16_t>(encoded), rank))
+        return nullptr;
+    return &containers[index].values[rank];
+}
+
+template<typename TElement>
+TElement RoaringDictionary<TElement>::Get(const int &key) const {
+    const TElement *value = Find(key);
+    if (!value)
+        throw std::runtime_error("Key not found.");
+    return *value;
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::ContainsKey(const int &key) const {
+    return Find(key) != nullptr;
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::Add(const int &key, const TElement &element) {
+    (*this)[key] = element;
+}
+
+template<typename TElement>
+TElement &RoaringDictionary<TElement>::operator[](const int &key) {
+    uint32_t encoded = Encode(key);
+    uint16_t high = static_cast<uint16_t>(encoded >> 16);
+    uint16_t low = static_cast<uint16_t>(encoded);
+    size_t index = FindContainer(high);
+    if (index == containers.size() || containers[index].high != high) {
+        Container container;
+        container.high = high;
+        container.kind = ContainerKind::Array;
+        containers.insert(containers.begin() + index, std::move(container));
+    }
+
+    Container &container = containers[index];
+    size_t rank;
+    if (Locate(container, low, rank))
+        return container.values[rank];
+    if (container.kind == ContainerKind::Run) {
+        Expand(container);
+        Locate(container, low, rank);
+    }
+    InsertLow(container, low, rank);
+    ++count;
+    return *container.values.insert(container.values.begin() + rank, TElement());
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::Remove(const int &key) {
+    uint32_t encoded = Encode(key);
+    uint16_t high = static_cast<uint16_t>(encoded >> 16);
+    uint16_t low = static_cast<uint16_t>(encoded);
+    size_t index = FindContainer(high);
+    size_t rank;
+    if (index == containers.size() || containers[index].high != high || !Locate(containers[index], low, rank))
+        throw std::runtime_error("Key not found.");
+
+    Container &container = containers[index];
+    if (container.kind == ContainerKind::Run) {
+        Expand(container);
+        Locate(container, low, rank);
+    }
+    container.values.erase(container.values.begin() + rank);
+    --count;
+    if (container.values.empty()) {
+        containers.erase(containers.begin() + index);
+        return;
+    }
+    EraseLow(container, low, rank);
+}
+
+// Серия стоит 8 байт (Run и runRanks); она выгоднее, если ключи идут длинными
+// отрезками, как у признаков из последовательных диапазонов.
+template<typename TElement>
+void RoaringDictionary<TElement>::RunOptimize() {
+    for (Container &container : containers) {
+        if (container.kind == ContainerKind::Run)
+            continue;
+        std::vector<Run> runs;
+        std::vector<uint32_t> runRanks;
+        uint32_t rank = 0;
+        ForEachLow(container, [&](uint16_t low) {
+            if (!runs.empty() && uint32_t(runs.back().start) + runs.back().length + 1 == low) {
+                ++runs.back().length;
+            } else {
+                runs.push_back(Run{low, 0});
+                runRanks.push_back(rank);
+            }
+            ++rank;
+        });
+        size_t current = container.kind == ContainerKind::Array
+                         ? container.array.size() * sizeof(uint16_t)
+                         : BITMAP_WORDS * sizeof(uint64_t) + container.blockRanks.size() * sizeof(uint16_t);
+        if (runs.size() * (sizeof(Run) + sizeof(uint32_t)) >= current)
+            continue;
+        container.kind = ContainerKind::Run;
+        container.runs = std::move(runs);
+        container.runRanks = std::move(runRanks);
+        container.array.clear();
+        container.array.shrink_to_fit();
+        container.bitmap.clear();
+        container.bitmap.shrink_to_fit();
+        container.blockRanks.clear();
+        container.blockRanks.shrink_to_fit();
+    }
+}
+
+template<typename TElement>
+size_t RoaringDictionary<TElement>::GetMemoryBytes() const {
+    size_t bytes = sizeof(*this) + containers.capacity() * sizeof(Container);
+    for (const Container &container : containers) {
+        bytes += container.array.capacity() * sizeof(uint16_t) + container.bitmap.capacity() * sizeof(uint64_t) +
+                 container.blockRanks.capacity() * sizeof(uint16_t) + container.runs.capacity() * sizeof(Run) +
+                 container.runRanks.capacity() * sizeof(uint32_t) + container.values.capacity() * sizeof(TElement);
+    }
+    return bytes;
+}
+
+template<typename TElement>
+template<typename TFunc> requires std::invocable<TFunc &, int, const TElement &, const TElement &>
+void RoaringDictionary<TElement>::Intersect(const RoaringDictionary &a, const RoaringDictionary &b, TFunc func) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.containers.size() && j < b.containers.size()) {
+        const Container &left = a.containers[i];
+        const Container &right = b.containers[j];
+        if (left.high < right.high) {
+            i = a.FindContainer(right.high, i + 1);
+            continue;
+        }
+        if (right.high < left.high) {
+            j = b.FindContainer(left.high, j + 1);
+            continue;
+        }
+
+        uint16_t high = left.high;
+        if (left.kind == ContainerKind::Bitmap && right.kind == ContainerKind::Bitmap) {
+            size_t leftRank = 0;
+            size_t rightRank = 0;
+            for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+                uint64_t leftWord = left.bitmap[w];
+                uint64_t rightWord = right.bitmap[w];
+                for (uint64_t common = leftWord & rightWord; common != 0; common &= common - 1) {
+                    uint64_t below = (common & (0 - common)) - 1;
+                    func(Decode(high, static_cast<uint16_t>(w * 64 + std::countr_zero(common))),
+                         left.values[leftRank + std::popcount(leftWord & below)],
+                         right.values[rightRank + std::popcount(rightWord & below)]);
+                }
+                leftRank += std::popcount(leftWord);
+                rightRank += std::popcount(rightWord);
+            }
+        } else {
+            // Меньший контейнер перебирается, в большем ищется ранг.
+            bool leftSmaller = left.values.size() <= right.values.size();
+            const Container &smaller = leftSmaller ? left : right;
+            const Container &larger = leftSmaller ? right : left;
+            size_t smallerRank = 0;
+            ForEachLow(smaller, [&](uint16_t low) {
+                size_t largerRank;
+                if (Locate(larger, low, largerRank)) {
+                    if (leftSmaller)
+                        func(Decode(high, low), smaller.values[smallerRank], larger.values[largerRank]);
+                    else
+                        func(Decode(high, low), larger.values[largerRank], smaller.values[smallerRank]);
+                }
+                ++smallerRank;
+            });
+        }
+        ++i;
+        ++j;
+    }
+}
+
+template<typename TElement>
+UnqPtr<IDictionaryIterator<int, TElement>> RoaringDictionary<TElement>::GetIterator() const {
+    return UnqPtr<IDictionaryIterator<int, TElement>>(new RoaringIterator(this));
+}
+
+template<typename TElement>
+UnqPtr<IMutableDictionaryIterator<int, TElement>> RoaringDictionary<TElement>::GetMutableIterator() {
+    return UnqPtr<IMutableDictionaryIterator<int, TElement>>(new RoaringMutableIterator(this));
+}
+
+template<typename TElement>
+RoaringDictionary<TElement>::RoaringIterator::RoaringIterator(const RoaringDictionary *dictionary)
+        : dictionary(dictionary), containerIndex(0), rank(0), slot(0), remaining(0), low(0), started(false),
+          valid(false) {
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringIterator::PositionAt(uint16_t from) {
+    const Container &container = dictionary->containers[containerIndex];
+    switch (container.kind) {
+        case ContainerKind::Array:
+            slot = std::lower_bound(container.array.begin(), container.array.end(), from) - container.array.begin();
+            if (slot == container.array.size())
+                return false;
+            low = container.array[slot];
+            rank = slot;
+            return true;
+        case ContainerKind::Bitmap: {
+            slot = from >> 6;
+            uint64_t bits = container.bitmap[slot] & (~uint64_t(0) << (from & 63));
+            while (bits == 0 && ++slot < BITMAP_WORDS)
+                bits = container.bitmap[slot];
+            if (slot == BITMAP_WORDS)
+                return false;
+            low = static_cast<uint16_t>(slot * 64 + std::countr_zero(bits));
+            remaining = bits & (bits - 1);
+            Locate(container, low, rank);
+            return true;
+        }
+        case ContainerKind::Run: {
+            slot = std::upper_bound(container.runs.begin(), container.runs.end(), from,
+                                    [](uint16_t value, const Run &run) { return value < run.start; }) -
+                   container.runs.begin();
+            if (slot > 0 && from - container.runs[slot - 1].start <= container.runs[slot - 1].length) {
+                --slot;
+                low = from;
+            } else if (slot < container.runs.size()) {
+                low = container.runs[slot].start;
+            } else {
+                return false;
+            }
+            rank = container.runRanks[slot] + (low - container.runs[slot].start);
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringIterator::Advance() {
+    const Container &container = dictionary->containers[containerIndex];
+    ++rank;
+    switch (container.kind) {
+        case ContainerKind::Array:
+            if (++slot == container.array.size())
+                return false;
+            low = container.array[slot];
+            return true;
+        case ContainerKind::Bitmap:
+            while (remaining == 0 && ++slot < BITMAP_WORDS)
+                remaining = container.bitmap[slot];
+            if (remaining == 0)
+                return false;
+            low = static_cast<uint16_t>(slot * 64 + std::countr_zero(remaining));
+            remaining &= remaining - 1;
+            return true;
+        case ContainerKind::Run:
+            if (low - container.runs[slot].start < container.runs[slot].length) {
+                ++low;
+                return true;
+            }
+            if (++slot == container.runs.size())
+                return false;
+            low = container.runs[slot].start;
+            return true;
+    }
+    return false;
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringIterator::SettleFrom(uint16_t from) {
+    while (containerIndex < dictionary->containers.size()) {
+        if (PositionAt(from))
+            return valid = true;
+        ++containerIndex;
+        from = 0;
+    }
+    return valid = false;
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringIterator::MoveNext() {
+    if (!started) {
+        started = true;
+        containerIndex = 0;
+        return SettleFrom(0);
+    }
+    if (!valid)
+        return false;
+    if (Advance())
+        return true;
+    ++containerIndex;
+    return SettleFrom(0);
+}
+
+// Пропуск целых кусков - двоичным поиском по старшим битам, внутри куска -
+// поиском в контейнере, без перебора промежуточных ключей.
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringIterator::SkipTo(const int &key) {
+    if (started && (!valid || !(GetCurrentKey() < key)))
+        return MoveNext();
+    uint32_t encoded = Encode(key);
+    uint16_t high = static_cast<uint16_t>(encoded >> 16);
+    size_t from = started ? containerIndex : 0;
+    started = true;
+    if (from < dictionary->containers.size() && dictionary->containers[from].high == high) {
+        containerIndex = from;
+    } else {
+        containerIndex = dictionary->FindContainer(high, from);
+        if (containerIndex == dictionary->containers.size() || dictionary->containers[containerIndex].high != high)
+            return SettleFrom(0);
+    }
+    return SettleFrom(static_cast<uint16_t>(encoded));
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::RoaringIterator::Reset() {
+    containerIndex = 0;
+    started = false;
+    valid = false;
+}
+
+template<typename TElement>
+int RoaringDictionary<TElement>::RoaringIterator::GetCurrentKey() const {
+    if (!valid)
+        throw std::out_of_range("Iterator out of range");
+    return Decode(dictionary->containers[containerIndex].high, low);
+}
+
+template<typename TElement>
+TElement RoaringDictionary<TElement>::RoaringIterator::GetCurrentValue() const {
+    if (!valid)
+        throw std::out_of_range("Iterator out of range");
+    return dictionary->containers[containerIndex].values[rank];
+}
+
+template<typename TElement>
+RoaringDictionary<TElement>::RoaringMutableIterator::RoaringMutableIterator(RoaringDictionary *dictionary)
+        : dictionary(dictionary), walker(dictionary), pendingContainer(0), removed(false), emptied(false) {
+}
+
+template<typename TElement>
+RoaringDictionary<TElement>::RoaringMutableIterator::~RoaringMutableIterator() {
+    Finish();
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringMutableIterator::Settle(bool moved) {
+    removed = false;
+    if (!removedRanks.empty() && (!moved || walker.containerIndex != pendingContainer))
+        CompactPending();
+    if (!moved)
+        Finish();
+    return moved;
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringMutableIterator::MoveNext() {
+    return Settle(walker.MoveNext());
+}
+
+template<typename TElement>
+bool RoaringDictionary<TElement>::RoaringMutableIterator::SkipTo(const int &key) {
+    return Settle(walker.SkipTo(key));
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::RoaringMutableIterator::Reset() {
+    Finish();
+    walker.Reset();
+    removed = false;
+}
+
+// Один проход по контейнеру: оставшиеся значения сдвигаются к началу, а ключи
+// заново раскладываются в Array или Bitmap.
+template<typename TElement>
+void RoaringDictionary<TElement>::RoaringMutableIterator::CompactPending() {
+    Container &container = dictionary->containers[pendingContainer];
+    std::vector<uint16_t> lows;
+    lows.reserve(container.values.size() - removedRanks.size());
+    size_t rank = 0;
+    size_t next = 0;
+    ForEachLow(container, [&](uint16_t low) {
+        if (next < removedRanks.size() && removedRanks[next] == rank) {
+            ++next;
+        } else {
+            container.values[lows.size()] = std::move(container.values[rank]);
+            lows.push_back(low);
+        }
+        ++rank;
+    });
+    container.values.erase(container.values.begin() + lows.size(), container.values.end());
+    SetLows(container, lows);
+    dictionary->count -= removedRanks.size();
+    emptied = emptied || lows.empty();
+    removedRanks.clear();
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::RoaringMutableIterator::Finish() {
+    if (!removedRanks.empty())
+        CompactPending();
+    if (emptied) {
+        std::vector<Container> &containers = dictionary->containers;
+        containers.erase(std::remove_if(containers.begin(), containers.end(),
+                                        [](const Container &container) { return container.values.empty(); }),
+                         containers.end());
+        emptied = false;
+    }
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::RoaringMutableIterator::CheckCurrent() const {
+    if (removed || !walker.valid)
+        throw std::out_of_range("Iterator out of range");
+}
+
+template<typename TElement>
+int RoaringDictionary<TElement>::RoaringMutableIterator::GetCurrentKey() const {
+    CheckCurrent();
+    return walker.GetCurrentKey();
+}
+
+template<typename TElement>
+TElement RoaringDictionary<TElement>::RoaringMutableIterator::GetCurrentValue() const {
+    CheckCurrent();
+    return walker.GetCurrentValue();
+}
+
+template<typename TElement>
+TElement &RoaringDictionary<TElement>::RoaringMutableIterator::GetCurrentValueRef() {
+    CheckCurrent();
+    return dictionary->containers[walker.containerIndex].values[walker.rank];
+}
+
+template<typename TElement>
+void RoaringDictionary<TElement>::RoaringMutableIterator::RemoveCurrent() {
+    CheckCurrent();
+    pendingContainer = walker.containerIndex;
+    removedRanks.push_back(walker.rank);
+    removed = true;
+}
+
+#endif // ROARINGDICTIONARY_H
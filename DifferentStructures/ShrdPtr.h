@@ -1,6 +1,7 @@
 #ifndef SHRDPTR_H
 #define SHRDPTR_H
 
+#include <atomic>
 #include <cstddef>
 #include <type_traits>
 
@@ -8,18 +9,17 @@ template<typename T>
 class ShrdPtr {
 private:
     T *ptr;
-    size_t *ref_count;
+    std::atomic<size_t> *ref_count;
 
     void add_ref() {
         if (ref_count) {
-            ++(*ref_count);
+            ref_count->fetch_add(1, std::memory_order_relaxed);
         }
     }
 
     void release() {
         if (ref_count) {
-            --(*ref_count);
-            if (*ref_count == 0) {
+            if (ref_count->fetch_sub(1, std::memory_order_acq_rel) == 1) {
                 delete ptr;
                 delete ref_count;
                 ptr = nullptr;
@@ -30,7 +30,7 @@ private:
 
 public:
     explicit ShrdPtr(T *p = nullptr)
-            : ptr(p), ref_count(p ? new size_t(1) : nullptr) {}
+            : ptr(p), ref_count(p ? new std::atomic<size_t>(1) : nullptr) {}
 
     ShrdPtr(const ShrdPtr<T> &other)
             : ptr(other.ptr), ref_count(other.ref_count) {
@@ -41,12 +41,15 @@ public:
 
     ShrdPtr<T> &operator=(const ShrdPtr<T> &other) {
         if (this != &other) {
-            release();
-            ptr = other.ptr;
-            ref_count = other.ref_count;
-            if (ref_count) {
-                add_ref();
+            // Ссылку на новый объект берём до release(): other может принадлежать *ptr.
+            T *newPtr = other.ptr;
+            std::atomic<size_t> *newCount = other.ref_count;
+            if (newCount) {
+                newCount->fetch_add(1, std::memory_order_relaxed);
             }
+            release();
+            ptr = newPtr;
+            ref_count = newCount;
         }
         return *this;
     }
@@ -62,12 +65,14 @@ public:
     template<typename U, typename = std::enable_if_t<std::is_convertible<U*, T*>::value>>
     ShrdPtr<T> &operator=(const ShrdPtr<U> &other) {
         if (ptr != other.get()) {
-            release();
-            ptr = other.get();
-            ref_count = other.ref_count_internal();
-            if (ref_count) {
-                add_ref();
+            T *newPtr = other.get();
+            std::atomic<size_t> *newCount = other.ref_count_internal();
+            if (newCount) {
+                newCount->fetch_add(1, std::memory_order_relaxed);
             }
+            release();
+            ptr = newPtr;
+            ref_count = newCount;
         }
         return *this;
     }
@@ -96,7 +101,7 @@ public:
         release();
         if (p) {
             ptr = p;
-            ref_count = new size_t(1);
+            ref_count = new std::atomic<size_t>(1);
         } else {
             ptr = nullptr;
             ref_count = nullptr;
@@ -104,14 +109,14 @@ public:
     }
 
     size_t use_count() const {
-        return ref_count ? *ref_count : 0;
+        return ref_count ? ref_count->load(std::memory_order_relaxed) : 0;
     }
 
     T* get() const {
         return ptr;
     }
 
-    size_t* ref_count_internal() const {
+    std::atomic<size_t>* ref_count_internal() const {
         return ref_count;
     }
 };
@@ -120,18 +125,17 @@ template<typename T>
 class ShrdPtr<T[]> {
 private:
     T *ptr;
-    size_t *ref_count;
+    std::atomic<size_t> *ref_count;
 
     void add_ref() {
         if (ref_count) {
-            ++(*ref_count);
+            ref_count->fetch_add(1, std::memory_order_relaxed);
         }
     }
 
     void release() {
         if (ref_count) {
-            --(*ref_count);
-            if (*ref_count == 0) {
+            if (ref_count->fetch_sub(1, std::memory_order_acq_rel) == 1) {
                 delete[] ptr;
                 delete ref_count;
                 ptr = nullptr;
@@ -142,7 +146,7 @@ private:
 
 public:
     explicit ShrdPtr(T *p = nullptr)
-            : ptr(p), ref_count(p ? new size_t(1) : nullptr) {}
+            : ptr(p), ref_count(p ? new std::atomic<size_t>(1) : nullptr) {}
 
     ShrdPtr(const ShrdPtr<T[]> &other)
             : ptr(other.ptr), ref_count(other.ref_count) {
@@ -157,10 +161,14 @@ public:
 
     ShrdPtr<T[]> &operator=(const ShrdPtr<T[]> &other) {
         if (this != &other) {
+            T *newPtr = other.ptr;
+            std::atomic<size_t> *newCount = other.ref_count;
+            if (newCount) {
+                newCount->fetch_add(1, std::memory_order_relaxed);
+            }
             release();
-            ptr = other.ptr;
-            ref_count = other.ref_count;
-            add_ref();
+            ptr = newPtr;
+            ref_count = newCount;
         }
         return *this;
     }
@@ -168,10 +176,14 @@ public:
     template<typename U>
     ShrdPtr<T[]> &operator=(const ShrdPtr<U[]> &other) {
         if (ptr != other.get()) {
+            T *newPtr = other.get();
+            std::atomic<size_t> *newCount = other.ref_count_internal();
+            if (newCount) {
+                newCount->fetch_add(1, std::memory_order_relaxed);
+            }
             release();
-            ptr = other.get();
-            ref_count = other.ref_count_internal();
-            add_ref();
+            ptr = newPtr;
+            ref_count = newCount;
         }
         return *this;
     }
@@ -200,7 +212,7 @@ public:
         release();
         if (p) {
             ptr = p;
-            ref_count = new size_t(1);
+            ref_count = new std::atomic<size_t>(1);
         } else {
             ptr = nullptr;
             ref_count = nullptr;
@@ -208,7 +220,7 @@ public:
     }
 
     size_t use_count() const {
-        return ref_count ? *ref_count : 0;
+        return ref_count ? ref_count->load(std::memory_order_relaxed) : 0;
     }
 
     T &operator[](size_t index) const {
@@ -219,7 +231,7 @@ public:
         return ptr;
     }
 
-    size_t* ref_count_internal() const {
+    std::atomic<size_t>* ref_count_internal() const {
         return ref_count;
     }
 };
@@ -0,0 +1,305 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// Обмен между разреженной парой массивов (indices[], values[]) и плотным
+// буфером dense[]:
+// - GatherDense:     out[i] = dense[indices[i]];
+// - ScatterDense:    dense[indices[i]] = values[i];
+// - AccumulateDense: dense[indices[i]] += alpha * values[i].
+// Индексы в ScatterDense и AccumulateDense не должны повторяться.
+//
+// Для double и float с индексами int и int64_t на x86 набор команд выбирается
+// при первом вызове: AVX-512 даёт и gather, и scatter, у AVX2 есть только
+// gather, поэтому запись в буфер остаётся скалярной. Векторные функции
+// собираются с атрибутом target, так что отдельных флагов компиляции не нужно.
+
+enum class SimdInstructionSet {
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+inline SimdInstructionSet DetectSimdInstructionSet() {
+#ifdef SIMD_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdInstructionSet::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdInstructionSet::Avx2;
+#endif
+    return SimdInstructionSet::Scalar;
+}
+
+inline SimdInstructionSet ActiveSimdInstructionSet() {
+    static const SimdInstructionSet instructionSet = DetectSimdInstructionSet();
+    return instructionSet;
+}
+
+template<typename TElement, typename TIndex>
+void GatherDenseScalar(const TElement *dense, const TIndex *indices, size_t count, TElement *out) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = dense[indices[i]];
+}
+
+template<typename TElement, typename TIndex>
+void ScatterDenseScalar(const TIndex *indices, const TElement *values, size_t count, TElement *dense) {
+    for (size_t i = 0; i < count; ++i)
+        dense[indices[i]] = values[i];
+}
+
+template<typename TElement, typename TIndex>
+void AccumulateDenseScalar(TElement alpha, const TIndex *indices, const TElement *values, size_t count,
+                           TElement *dense) {
+    for (size_t i = 0; i < count; ++i)
+        dense[indices[i]] += alpha * values[i];
+}
+
+#ifdef SIMD_KERNELS_X86
+
+#define SIMD_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#define SIMD_AVX2 __attribute__((target("avx2,fma")))
+#define SIMD_AVX512_INLINE __attribute__((target("avx512f,avx2,fma"), always_inline)) inline
+#define SIMD_AVX2_INLINE __attribute__((target("avx2,fma"), always_inline)) inline
+
+// Регистры одной итерации: WIDTH индексов и столько же значений.
+// Комбинации без специализации обрабатываются скалярным циклом.
+// Gather используется в маскированной форме с нулевым источником: у
+// немаскированной GCC предупреждает о неинициализированном регистре.
+template<typename TElement, typename TIndex>
+struct Avx512Lanes {
+    static constexpr bool SUPPORTED = false;
+};
+
+template<>
+struct Avx512Lanes<double, int> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 8;
+
+    SIMD_AVX512_INLINE static __m256i LoadIndices(const int *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    SIMD_AVX512_INLINE static __m512d Load(const double *p) { return _mm512_loadu_pd(p); }
+    SIMD_AVX512_INLINE static void Store(double *p, __m512d v) { _mm512_storeu_pd(p, v); }
+    SIMD_AVX512_INLINE static __m512d Broadcast(double x) { return _mm512_set1_pd(x); }
+    SIMD_AVX512_INLINE static __m512d MultiplyAdd(__m512d a, __m512d b, __m512d c) { return _mm512_fmadd_pd(a, b, c); }
+    SIMD_AVX512_INLINE static __m512d Gather(const double *base, __m256i indices) {
+        return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, indices, base, 8);
+    }
+    SIMD_AVX512_INLINE static void Scatter(double *base, __m256i indices, __m512d v) {
+        _mm512_i32scatter_pd(base, indices, v, 8);
+    }
+};
+
+template<>
+struct Avx512Lanes<double, int64_t> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 8;
+
+    SIMD_AVX512_INLINE static __m512i LoadIndices(const int64_t *p) { return _mm512_loadu_si512(p); }
+    SIMD_AVX512_INLINE static __m512d Load(const double *p) { return _mm512_loadu_pd(p); }
+    SIMD_AVX512_INLINE static void Store(double *p, __m512d v) { _mm512_storeu_pd(p, v); }
+    SIMD_AVX512_INLINE static __m512d Broadcast(double x) { return _mm512_set1_pd(x); }
+    SIMD_AVX512_INLINE static __m512d MultiplyAdd(__m512d a, __m512d b, __m512d c) { return _mm512_fmadd_pd(a, b, c); }
+    SIMD_AVX512_INLINE static __m512d Gather(const double *base, __m512i indices) {
+        return _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, indices, base, 8);
+    }
+    SIMD_AVX512_INLINE static void Scatter(double *base, __m512i indices, __m512d v) {
+        _mm512_i64scatter_pd(base, indices, v, 8);
+    }
+};
+
+template<>
+struct Avx512Lanes<float, int> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 16;
+
+    SIMD_AVX512_INLINE static __m512i LoadIndices(const int *p) { return _mm512_loadu_si512(p); }
+    SIMD_AVX512_INLINE static __m512 Load(const float *p) { return _mm512_loadu_ps(p); }
+    SIMD_AVX512_INLINE static void Store(float *p, __m512 v) { _mm512_storeu_ps(p, v); }
+    SIMD_AVX512_INLINE static __m512 Broadcast(float x) { return _mm512_set1_ps(x); }
+    SIMD_AVX512_INLINE static __m512 MultiplyAdd(__m512 a, __m512 b, __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+    SIMD_AVX512_INLINE static __m512 Gather(const float *base, __m512i indices) {
+        return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, indices, base, 4);
+    }
+    SIMD_AVX512_INLINE static void Scatter(float *base, __m512i indices, __m512 v) {
+        _mm512_i32scatter_ps(base, indices, v, 4);
+    }
+};
+
+template<>
+struct Avx512Lanes<float, int64_t> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 8;
+
+    SIMD_AVX512_INLINE static __m512i LoadIndices(const int64_t *p) { return _mm512_loadu_si512(p); }
+    SIMD_AVX512_INLINE static __m256 Load(const float *p) { return _mm256_loadu_ps(p); }
+    SIMD_AVX512_INLINE static void Store(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+    SIMD_AVX512_INLINE static __m256 Broadcast(float x) { return _mm256_set1_ps(x); }
+    SIMD_AVX512_INLINE static __m256 MultiplyAdd(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+    SIMD_AVX512_INLINE static __m256 Gather(const float *base, __m512i indices) {
+        return _mm512_mask_i64gather_ps(_mm256_setzero_ps(), 0xFF, indices, base, 4);
+    }
+    SIMD_AVX512_INLINE static void Scatter(float *base, __m512i indices, __m256 v) {
+        _mm512_i64scatter_ps(base, indices, v, 4);
+    }
+};
+
+// У AVX2 нет scatter: векторно только чтение из буфера.
+template<typename TElement, typename TIndex>
+struct Avx2Lanes {
+    static constexpr bool SUPPORTED = false;
+};
+
+template<>
+struct Avx2Lanes<double, int> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 4;
+
+    SIMD_AVX2_INLINE static __m128i LoadIndices(const int *p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+    SIMD_AVX2_INLINE static void Store(double *p, __m256d v) { _mm256_storeu_pd(p, v); }
+    SIMD_AVX2_INLINE static __m256d Gather(const double *base, __m128i indices) {
+        return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, indices,
+                                        _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+    }
+};
+
+template<>
+struct Avx2Lanes<double, int64_t> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 4;
+
+    SIMD_AVX2_INLINE static __m256i LoadIndices(const int64_t *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    SIMD_AVX2_INLINE static void Store(double *p, __m256d v) { _mm256_storeu_pd(p, v); }
+    SIMD_AVX2_INLINE static __m256d Gather(const double *base, __m256i indices) {
+        return _mm256_mask_i64gather_pd(_mm256_setzero_pd(), base, indices,
+                                        _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+    }
+};
+
+template<>
+struct Avx2Lanes<float, int> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 8;
+
+    SIMD_AVX2_INLINE static __m256i LoadIndices(const int *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    SIMD_AVX2_INLINE static void Store(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+    SIMD_AVX2_INLINE static __m256 Gather(const float *base, __m256i indices) {
+        return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, indices,
+                                        _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+    }
+};
+
+template<>
+struct Avx2Lanes<float, int64_t> {
+    static constexpr bool SUPPORTED = true;
+    static constexpr size_t WIDTH = 4;
+
+    SIMD_AVX2_INLINE static __m256i LoadIndices(const int64_t *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    SIMD_AVX2_INLINE static void Store(float *p, __m128 v) { _mm_storeu_ps(p, v); }
+    SIMD_AVX2_INLINE static __m128 Gather(const float *base, __m256i indices) {
+        return _mm256_mask_i64gather_ps(_mm_setzero_ps(), base, indices, _mm_castsi128_ps(_mm_set1_epi32(-1)), 4);
+    }
+};
+
+template<typename TLanes, typename TElement, typename TIndex>
+SIMD_AVX512 void GatherDenseAvx512(const TElement *dense, const TIndex *indices, size_t count, TElement *out) {
+    size_t i = 0;
+    for (; i + TLanes::WIDTH <= count; i += TLanes::WIDTH)
+        TLanes::Store(out + i, TLanes::Gather(dense, TLanes::LoadIndices(indices + i)));
+    GatherDenseScalar(dense, indices + i, count - i, out + i);
+}
+
+template<typename TLanes, typename TElement, typename TIndex>
+SIMD_AVX512 void ScatterDenseAvx512(const TIndex *indices, const TElement *values, size_t count, TElement *dense) {
+    size_t i = 0;
+    for (; i + TLanes::WIDTH <= count; i += TLanes::WIDTH)
+        TLanes::Scatter(dense, TLanes::LoadIndices(indices + i), TLanes::Load(values + i));
+    ScatterDenseScalar(indices + i, values + i, count - i, dense);
+}
+
+// Индексы внутри итерации различны, поэтому gather-fma-scatter не теряет слагаемых.
+template<typename TLanes, typename TElement, typename TIndex>
+SIMD_AVX512 void AccumulateDenseAvx512(TElement alpha, const TIndex *indices, const TElement *values, size_t count,
+                                       TElement *dense) {
+    auto scale = TLanes::Broadcast(alpha);
+    size_t i = 0;
+    for (; i + TLanes::WIDTH <= count; i += TLanes::WIDTH) {
+        auto position = TLanes::LoadIndices(indices + i);
+        auto sum = TLanes::MultiplyAdd(scale, TLanes::Load(values + i), TLanes::Gather(dense, position));
+        TLanes::Scatter(dense, position, sum);
+    }
+    AccumulateDenseScalar(alpha, indices + i, values + i, count - i, dense);
+}
+
+template<typename TLanes, typename TElement, typename TIndex>
+SIMD_AVX2 void GatherDenseAvx2(const TElement *dense, const TIndex *indices, size_t count, TElement *out) {
+    size_t i = 0;
+    for (; i + TLanes::WIDTH <= count; i += TLanes::WIDTH)
+        TLanes::Store(out + i, TLanes::Gather(dense, TLanes::LoadIndices(indices + i)));
+    GatherDenseScalar(dense, indices + i, count - i, out + i);
+}
+
+#endif // SIMD_KERNELS_X86
+
+template<typename TElement, typename TIndex>
+void GatherDense(const TElement *dense, const TIndex *indices, size_t count, TElement *out) {
+#ifdef SIMD_KERNELS_X86
+    if constexpr (Avx512Lanes<TElement, TIndex>::SUPPORTED) {
+        switch (ActiveSimdInstructionSet()) {
+            case SimdInstructionSet::Avx512:
+                GatherDenseAvx512<Avx512Lanes<TElement, TIndex>>(dense, indices, count, out);
+                return;
+            case SimdInstructionSet::Avx2:
+                GatherDenseAvx2<Avx2Lanes<TElement, TIndex>>(dense, indices, count, out);
+                return;
+            case SimdInstructionSet::Scalar:
+                break;
+        }
+    }
+#endif
+    GatherDenseScalar(dense, indices, count, out);
+}
+
+template<typename TElement, typename TIndex>
+void ScatterDense(const TIndex *indices, const TElement *values, size_t count, TElement *dense) {
+#ifdef SIMD_KERNELS_X86
+    if constexpr (Avx512Lanes<TElement, TIndex>::SUPPORTED) {
+        if (ActiveSimdInstructionSet() == SimdInstructionSet::Avx512) {
+            ScatterDenseAvx512<Avx512Lanes<TElement, TIndex>>(indices, values, count, dense);
+            return;
+        }
+    }
+#endif
+    ScatterDenseScalar(indices, values, count, dense);
+}
+
+template<typename TElement, typename TIndex>
+void AccumulateDense(TElement alpha, const TIndex *indices, const TElement *values, size_t count, TElement *dense) {
+#ifdef SIMD_KERNELS_X86
+    if constexpr (Avx512Lanes<TElement, TIndex>::SUPPORTED) {
+        if (ActiveSimdInstructionSet() == SimdInstructionSet::Avx512) {
+            AccumulateDenseAvx512<Avx512Lanes<TElement, TIndex>>(alpha, indices, values, count, dense);
+            return;
+        }
+    }
+#endif
+    AccumulateDenseScalar(alpha, indices, values, count, dense);
+}
+
+#endif // SIMDKERNELS_H
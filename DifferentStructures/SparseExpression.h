@@ -0,0 +1,368 @@
+#ifndef SPARSEEXPRESSION_H
+#define SPARSEEXPRESSION_H
+
+#include "KeyValue.h"
+#include "SparseVector.h"
+#include "SparseVectorOps.h"
+#include <algorithm>
+#include <concepts>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Ленивые выражения над SparseVector: a * x + b * z - y строит дерево узлов,
+// которое ничего не вычисляет до присваивания. При присваивании все операнды
+// обходятся одновременно одним слиянием по возрастанию индексов, и каждый
+// элемент результата вычисляется сразу целиком, без промежуточных векторов.
+// Если какой-то словарь неупорядочен, индексы операндов собираются в один
+// отсортированный список, а значения читаются через GetElement.
+//
+// Узел выражения предоставляет:
+// - GetLength(), IsOrdered(), References(vector) - общие свойства;
+// - Evaluate(index) - значение в произвольной позиции;
+// - CollectIndices(indices) - ненулевые индексы операндов;
+// - MakeCursor() - курсор слияния: Index() - наименьший ещё не пройденный
+//   индекс (максимум IndexType в конце), ValueAt(index) и Skip(index) для него.
+// Узлы хранят векторы по ссылке, поэтому выражение не должно переживать операнды.
+
+template<typename TElement, typename TIndex>
+class SparseVectorLeaf : public SparseExpressionBase {
+public:
+    using ElementType = TElement;
+    using IndexType = TIndex;
+
+    explicit SparseVectorLeaf(const SparseVector<TElement, TIndex> &vector) : vector(vector) {}
+
+    TIndex GetLength() const {
+        return vector.GetLength();
+    }
+
+    bool IsOrdered() const {
+        return vector.IsOrdered();
+    }
+
+    bool References(const void *target) const {
+        return &vector == target;
+    }
+
+    TElement Evaluate(TIndex index) const {
+        return vector.GetElement(index);
+    }
+
+    void CollectIndices(std::vector<TIndex> &indices) const {
+        auto iterator = vector.GetIterator();
+        while (iterator->MoveNext())
+            indices.push_back(iterator->GetCurrentKey());
+    }
+
+    class Cursor {
+    public:
+        explicit Cursor(const SparseVector<TElement, TIndex> &vector) : iterator(vector.GetIterator()) {
+            Advance();
+        }
+
+        TIndex Index() const {
+            return index;
+        }
+
+        TElement ValueAt(TIndex at) const {
+            return index == at ? value : TElement();
+        }
+
+        void Skip(TIndex at) {
+            if (index == at)
+                Advance();
+        }
+
+    private:
+        UnqPtr<IDictionaryIterator<TIndex, TElement>> iterator;
+        TIndex index;
+        TElement value;
+
+        void Advance() {
+            if (iterator->MoveNext()) {
+                index = iterator->GetCurrentKey();
+                value = iterator->GetCurrentValue();
+            } else {
+                index = std::numeric_limits<TIndex>::max();
+            }
+        }
+    };
+
+    Cursor MakeCursor() const {
+        return Cursor(vector);
+    }
+
+private:
+    const SparseVector<TElement, TIndex> &vector;
+};
+
+// Превращает SparseVector в лист, узлы выражений возвращает как есть.
+template<typename TElement, typename TIndex>
+SparseVectorLeaf<TElement, TIndex> AsSparseExpression(const SparseVector<TElement, TIndex> &vector) {
+    return SparseVectorLeaf<TElement, TIndex>(vector);
+}
+
+template<typename TExpression> requires std::derived_from<TExpression, SparseExpressionBase>
+const TExpression &AsSparseExpression(const TExpression &expression) {
+    return expression;
+}
+
+template<typename T>
+using SparseExpressionType = std::decay_t<decltype(AsSparseExpression(std::declval<const T &>()))>;
+
+template<typename T>
+using SparseOperandElement = typename SparseExpressionType<T>::ElementType;
+
+template<typename TOperand>
+class SparseScaledExpression : public SparseExpressionBase {
+public:
+    using ElementType = typename TOperand::ElementType;
+    using IndexType = typename TOperand::IndexType;
+
+    SparseScaledExpression(ElementType scalar, const TOperand &operand) : scalar(scalar), operand(operand) {}
+
+    IndexType GetLength() const {
+        return operand.GetLength();
+    }
+
+    bool IsOrdered() const {
+        return operand.IsOrdered();
+    }
+
+    bool References(const void *target) const {
+        return operand.References(target);
+    }
+
+    ElementType Evaluate(IndexType index) const {
+        return scalar * operand.Evaluate(index);
+    }
+
+    void CollectIndices(std::vector<IndexType> &indices) const {
+        operand.CollectIndices(indices);
+    }
+
+    class Cursor {
+    public:
+        Cursor(ElementType scalar, typename TOperand::Cursor inner) : scalar(scalar), inner(std::move(inner)) {}
+
+        IndexType Index() const {
+            return inner.Index();
+        }
+
+        ElementType ValueAt(IndexType at) const {
+            return scalar * inner.ValueAt(at);
+        }
+
+        void Skip(IndexType at) {
+            inner.Skip(at);
+        }
+
+    private:
+        ElementType scalar;
+        typename TOperand::Cursor inner;
+    };
+
+    Cursor MakeCursor() const {
+        return Cursor(scalar, operand.MakeCursor());
+    }
+
+private:
+    ElementType scalar;
+    TOperand operand;
+};
+
+// Сумма или, при Subtract, разность двух выражений одной длины.
+template<typename TLeft, typename TRight, bool Subtract>
+class SparseSumExpression : public SparseExpressionBase {
+public:
+    using ElementType = typename TLeft::ElementType;
+    using IndexType = typename TLeft::IndexType;
+
+    static_assert(std::is_same_v<IndexType, typename TRight::IndexType>, "Operands must share the index type.");
+
+    SparseSumExpression(const TLeft &left, const TRight &right) : left(left), right(right) {
+        CheckSameLength(left, right);
+    }
+
+    IndexType GetLength() const {
+        return left.GetLength();
+    }
+
+    bool IsOrdered() const {
+        return left.IsOrdered() && right.IsOrdered();
+    }
+
+    bool References(const void *target) const {
+        return left.References(target) || right.References(target);
+    }
+
+    ElementType Evaluate(IndexType index) const {
+        return Combine(left.Evaluate(index), right.Evaluate(index));
+    }
+
+    void CollectIndices(std::vector<IndexType> &indices) const {
+        left.CollectIndices(indices);
+        right.CollectIndices(indices);
+    }
+
+    class Cursor {
+    public:
+        Cursor(typename TLeft::Cursor left, typename TRight::Cursor right)
+                : left(std::move(left)), right(std::move(right)) {}
+
+        IndexType Index() const {
+            return std::min(left.Index(), right.Index());
+        }
+
+        ElementType ValueAt(IndexType at) const {
+            return Combine(left.ValueAt(at), right.ValueAt(at));
+        }
+
+        void Skip(IndexType at) {
+            left.Skip(at);
+            right.Skip(at);
+        }
+
+    private:
+        typename TLeft::Cursor left;
+        typename TRight::Cursor right;
+    };
+
+    Cursor MakeCursor() const {
+        return Cursor(left.MakeCursor(), right.MakeCursor());
+    }
+
+    const TLeft &GetLeft() const {
+        return left;
+    }
+
+    const TRight &GetRight() const {
+        return right;
+    }
+
+private:
+    TLeft left;
+    TRight right;
+
+    static ElementType Combine(const ElementType &x, const ElementType &y) {
+        if constexpr (Subtract)
+            return x - y;
+        else
+            return x + y;
+    }
+};
+
+template<typename TLeft, typename TRight> requires SparseOperand<TLeft> && SparseOperand<TRight>
+auto operator+(const TLeft &left, const TRight &right) {
+    return SparseSumExpression<SparseExpressionType<TLeft>, SparseExpressionType<TRight>, false>(
+            AsSparseExpression(left), AsSparseExpression(right));
+}
+
+template<typename TLeft, typename TRight> requires SparseOperand<TLeft> && SparseOperand<TRight>
+auto operator-(const TLeft &left, const TRight &right) {
+    return SparseSumExpression<SparseExpressionType<TLeft>, SparseExpressionType<TRight>, true>(
+            AsSparseExpression(left), AsSparseExpression(right));
+}
+
+template<typename TOperand> requires SparseOperand<TOperand>
+auto operator*(const SparseOperandElement<TOperand> &scalar, const TOperand &operand) {
+    return SparseScaledExpression<SparseExpressionType<TOperand>>(scalar, AsSparseExpression(operand));
+}
+
+template<typename TOperand> requires SparseOperand<TOperand>
+auto operator*(const TOperand &operand, const SparseOperandElement<TOperand> &scalar) {
+    return SparseScaledExpression<SparseExpressionType<TOperand>>(scalar, AsSparseExpression(operand));
+}
+
+template<typename TOperand> requires SparseOperand<TOperand>
+auto operator-(const TOperand &operand) {
+    using TElement = SparseOperandElement<TOperand>;
+    return SparseScaledExpression<SparseExpressionType<TOperand>>(TElement() - TElement(1), AsSparseExpression(operand));
+}
+
+// Общий случай: выражение нельзя применить к result на месте.
+template<typename TElement, typename TIndex, typename TExpression>
+bool TryUpdateSparseVectorInPlace(SparseVector<TElement, TIndex> &, const TExpression &) {
+    return false;
+}
+
+// result = result ± rest, где rest не читает result (так раскрываются += и -=):
+// пишутся только индексы rest, через SetElement, который удаляет нули. Цена -
+// O(nnz(rest)) обращений к словарю вместо перестройки всего result.
+template<typename TElement, typename TIndex, typename TRest, bool Subtract>
+bool TryUpdateSparseVectorInPlace(SparseVector<TElement, TIndex> &result,
+                                  const SparseSumExpression<SparseVectorLeaf<TElement, TIndex>, TRest, Subtract> &expression) {
+    const TRest &rest = expression.GetRight();
+    if (!expression.GetLeft().References(&result) || rest.References(&result))
+        return false;
+
+    auto update = [&](TIndex index, const TElement &value) {
+        if (value == TElement())
+            return;
+        TElement current = result.GetElement(index);
+        if constexpr (Subtract)
+            result.SetElement(index, current - value);
+        else
+            result.SetElement(index, current + value);
+    };
+    if (rest.IsOrdered()) {
+        auto cursor = rest.MakeCursor();
+        for (TIndex index = cursor.Index(); index != std::numeric_limits<TIndex>::max(); index = cursor.Index()) {
+            update(index, cursor.ValueAt(index));
+            cursor.Skip(index);
+        }
+    } else {
+        std::vector<TIndex> indices;
+        rest.CollectIndices(indices);
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        for (TIndex index : indices)
+            update(index, rest.Evaluate(index));
+    }
+    return true;
+}
+
+// Вычисляет выражение в result. Если result сам входит в выражение, его
+// старые значения ещё читаются во время прохода, поэтому результат сначала
+// собирается в плоский список пар (как в Axpy) и записывается после.
+// Исключение - result ± rest без других вхождений result: он меняется на месте.
+template<typename TElement, typename TIndex, typename TExpression>
+void AssignSparseExpression(SparseVector<TElement, TIndex> &result, const TExpression &expression) {
+    CheckSameLength(result, expression);
+    if (TryUpdateSparseVectorInPlace(result, expression))
+        return;
+    bool aliased = expression.References(&result);
+    std::vector<KeyValue<TIndex, TElement>> entries;
+    auto emit = [&](TIndex index, const TElement &value) {
+        if (value == TElement())
+            return;
+        if (aliased)
+            entries.push_back(KeyValue<TIndex, TElement>(index, value));
+        else
+            result.SetElement(index, value);
+    };
+    if (!aliased)
+        result.Clear();
+
+    if (expression.IsOrdered()) {
+        auto cursor = expression.MakeCursor();
+        for (TIndex index = cursor.Index(); index != std::numeric_limits<TIndex>::max(); index = cursor.Index()) {
+            emit(index, cursor.ValueAt(index));
+            cursor.Skip(index);
+        }
+    } else {
+        std::vector<TIndex> indices;
+        expression.CollectIndices(indices);
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        for (TIndex index : indices)
+            emit(index, expression.Evaluate(index));
+    }
+
+    if (aliased)
+        AssignSparseVector(result, entries);
+}
+
+#endif // SPARSEEXPRESSION_H
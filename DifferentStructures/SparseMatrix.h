@@ -1,6 +1,7 @@
 #ifndef SPARSEMATRIX_H
 #define SPARSEMATRIX_H
 
+#include <concepts>
 #include <vector>
 #include <stdexcept>
 #include <iostream>
@@ -37,8 +38,10 @@ public:
         elements[row][column] = TElement();
     }
 
-    // Применение функции ко всем элементам
-    void ForEach(void (*func)(int, int, const TElement&)) const {
+    // Применение функции ко всем ненулевым элементам; func - любой вызываемый
+    // объект, вызов встраивается в цикл
+    template<typename TFunc> requires std::invocable<TFunc&, int, int, const TElement&>
+    void ForEach(TFunc func) const {
         for (int i = 0; i < rows; ++i) {
             for (int j = 0; j < columns; ++j) {
                 if (elements[i][j] != TElement()) {
@@ -49,9 +52,8 @@ public:
     }
 
     // Применение функции ко всем элементам
-#include <functional>  // Добавляем для std::function
-
-    void Map(std::function<TElement(TElement)> func) {
+    template<typename TFunc> requires std::invocable<TFunc&, TElement>
+    void Map(TFunc func) {
         for (int i = 0; i < rows; ++i) {
             for (int j = 0; j < columns; ++j) {
                 elements[i][j] = func(elements[i][j]);
@@ -72,7 +74,8 @@ public:
         }
     }
 
-    TElement Reduce(TElement (*func)(TElement, TElement), TElement initial) const {
+    template<typename TFunc> requires std::invocable<TFunc&, TElement, TElement>
+    TElement Reduce(TFunc func, TElement initial) const {
         TElement result = initial;
         for (int i = 0; i < rows; ++i) {
             for (int j = 0; j < columns; ++j) {
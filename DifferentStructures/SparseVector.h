@@ -5,25 +5,74 @@
 #include "ShrdPtr.h"
 #include "DynamicArraySmart.h"
 #include "KeyValue.h"
+#include "ThreadPool.h"
 #include <memory>
 #include <stdexcept>
 #include <vector>
 #include <iostream>
-#include <functional>
+#include <concepts>
 
-template <typename TElement>
+// Общая база узлов ленивых выражений из SparseExpression.h.
+struct SparseExpressionBase {};
+
+template <typename TElement, typename TIndex>
+class SparseVector;
+
+template <typename T>
+inline constexpr bool IsSparseVector = false;
+
+template <typename TElement, typename TIndex>
+inline constexpr bool IsSparseVector<SparseVector<TElement, TIndex>> = true;
+
+// Операнд выражения: сам SparseVector или узел из SparseExpression.h.
+template <typename T>
+concept SparseOperand = std::derived_from<T, SparseExpressionBase> || IsSparseVector<T>;
+
+// TIndex - тип индексов и длины. int - компактный режим по умолчанию;
+// int64_t позволяет задавать векторы длиной больше 2^31 (хеши признаков).
+template <typename TElement, typename TIndex = int>
 class SparseVector {
 public:
-    SparseVector(int length, UnqPtr<IDictionary<int, TElement>> dictionary)
+    SparseVector(TIndex length, UnqPtr<IDictionary<TIndex, TElement>> dictionary)
             : length(length), elements(std::move(dictionary)) {}
 
     ~SparseVector() {}
 
-    int GetLength() const {
+    // Присваивание выражения из SparseExpression.h (y = a * x + b * z):
+    // результат вычисляется одним слиянием операндов. += и -= принимают и
+    // обычный SparseVector и меняют только индексы правой части.
+    template <typename TExpression> requires std::derived_from<TExpression, SparseExpressionBase>
+    SparseVector& operator=(const TExpression& expression) {
+        AssignSparseExpression(*this, expression);
+        return *this;
+    }
+
+    template <typename TExpression> requires SparseOperand<TExpression>
+    SparseVector& operator+=(const TExpression& expression) {
+        AssignSparseExpression(*this, *this + expression);
+        return *this;
+    }
+
+    template <typename TExpression> requires SparseOperand<TExpression>
+    SparseVector& operator-=(const TExpression& expression) {
+        AssignSparseExpression(*this, *this - expression);
+        return *this;
+    }
+
+    TIndex GetLength() const {
         return length;
     }
 
-    TElement GetElement(int index) const {
+    size_t GetNonZeroCount() const {
+        return elements->GetCount();
+    }
+
+    // true, если GetIterator() перечисляет индексы по возрастанию.
+    bool IsOrdered() const {
+        return elements->IsOrdered();
+    }
+
+    TElement GetElement(TIndex index) const {
         if (index < 0 || index >= length) {
             throw std::out_of_range("Index is out of bounds.");
         }
@@ -37,7 +86,7 @@ public:
         }
     }
 
-    void SetElement(int index, const TElement& value) {
+    void SetElement(TIndex index, const TElement& value) {
         if (index < 0 || index >= length) {
             throw std::out_of_range("Index is out of bounds.");
         }
@@ -48,7 +97,7 @@ public:
         }
     }
 
-    void RemoveElement(int index) {
+    void RemoveElement(TIndex index) {
         if (index < 0 || index >= length) {
             throw std::out_of_range("Index is out of bounds.");
         }
@@ -57,42 +106,50 @@ public:
         }
     }
 
-    void ForEach(void (*func)(int, const TElement&)) const {
+    // Обработчики принимаются шаблонным параметром, а не указателем на
+    // функцию или std::function: лямбды с захватом допустимы, и компилятор
+    // может встроить вызов в цикл обхода.
+    template <typename TFunc> requires std::invocable<TFunc&, TIndex, const TElement&>
+    void ForEach(TFunc func) const {
         auto iterator = elements->GetIterator();
         while (iterator->MoveNext()) {
-            int key = iterator->GetCurrentKey();
+            TIndex key = iterator->GetCurrentKey();
             TElement value = iterator->GetCurrentValue();
             func(key, value);
         }
     }
 
-    void Map(std::function<TElement(TElement)> func) {
-        DynamicArraySmart<KeyValue<int, TElement>> updates;
-        auto iterator = elements->GetIterator();
+    // Один проход по словарю: значения меняются на месте, нулевые результаты
+    // удаляются сразу, без промежуточного списка.
+    template <typename TFunc> requires std::invocable<TFunc&, TElement>
+    void Map(TFunc func) {
+        auto iterator = elements->GetMutableIterator();
         while (iterator->MoveNext()) {
-            int key = iterator->GetCurrentKey();
-            TElement value = iterator->GetCurrentValue();
-            TElement newValue = func(value);
-            updates.Append(KeyValue<int, TElement>(key, newValue));
+            TElement &value = iterator->GetCurrentValueRef();
+            value = func(value);
+            if (value == TElement()) {
+                iterator->RemoveCurrent();
+            }
         }
-        for (int i = 0; i < updates.GetLength(); ++i) {
-            const KeyValue<int, TElement>& kv = updates.Get(i);
-            (*elements)[kv.key] = kv.value;
+    }
+
+    void Clear() {
+        auto iterator = elements->GetMutableIterator();
+        while (iterator->MoveNext()) {
+            iterator->RemoveCurrent();
         }
     }
 
     void MultiplyByScalar(TElement scalar) {
         if (scalar == 0) {
-            auto iterator = elements->GetIterator();
-            while (iterator->MoveNext()) {
-                elements->Remove(iterator->GetCurrentKey());
-            }
+            Clear();
         } else {
             Map([scalar](TElement x) { return x * scalar; });
         }
     }
 
-    TElement Reduce(TElement (*func)(TElement, TElement), TElement initial) const {
+    template <typename TFunc> requires std::invocable<TFunc&, TElement, TElement>
+    TElement Reduce(TFunc func, TElement initial) const {
         TElement result = initial;
         auto iterator = elements->GetIterator();
         while (iterator->MoveNext()) {
@@ -102,13 +159,123 @@ public:
         return result;
     }
 
-    UnqPtr<IDictionaryIterator<int, TElement>> GetIterator() const {
+    // Параллельные версии на пуле потоков: словарь делится на части
+    // (диапазоны корзин HashTable, диапазоны ключей BTree), и func вызывается
+    // из нескольких потоков одновременно. Словари без разбиения обходятся
+    // последовательно.
+    template <typename TFunc> requires std::invocable<TFunc&, TIndex, const TElement&>
+    void ParallelForEach(TFunc func, ThreadPool& pool = ThreadPool::Shared()) const {
+        auto partitions = elements->GetPartitions(PartitionCount(pool));
+        pool.Run(partitions.size(), [&](size_t part) {
+            auto& iterator = partitions[part];
+            while (iterator->MoveNext()) {
+                func(iterator->GetCurrentKey(), iterator->GetCurrentValue());
+            }
+        });
+    }
+
+    // Обнулившиеся элементы собираются по частям и удаляются после обхода.
+    // Однопоточный пул сразу уходит в Map; единственная часть, если словарь
+    // не делится, обходится здесь же, без второго изменяемого итератора.
+    template <typename TFunc> requires std::invocable<TFunc&, TElement>
+    void ParallelMap(TFunc func, ThreadPool& pool = ThreadPool::Shared()) {
+        if (PartitionCount(pool) == 1) {
+            Map(func);
+            return;
+        }
+        auto partitions = elements->GetMutablePartitions(PartitionCount(pool));
+        std::vector<std::vector<TIndex>> zeros(partitions.size());
+        auto mapPart = [&](size_t part) {
+            auto& iterator = partitions[part];
+            while (iterator->MoveNext()) {
+                TElement& value = iterator->GetCurrentValueRef();
+                value = func(value);
+                if (value == TElement()) {
+                    zeros[part].push_back(iterator->GetCurrentKey());
+                }
+            }
+        };
+        if (partitions.size() == 1) {
+            mapPart(0);
+        } else {
+            pool.Run(partitions.size(), mapPart);
+        }
+        partitions.clear();
+        for (const std::vector<TIndex>& keys : zeros) {
+            for (TIndex key : keys) {
+                elements->Remove(key);
+            }
+        }
+    }
+
+    // Вызывающий объявляет func ассоциативной: каждая часть сворачивается
+    // отдельно, затем частичные результаты объединяются попарно деревом, и
+    // initial применяется один раз в конце.
+    template <typename TFunc> requires std::invocable<TFunc&, TElement, TElement>
+    TElement ParallelReduce(TFunc func, TElement initial, ThreadPool& pool = ThreadPool::Shared()) const {
+        auto partitions = elements->GetPartitions(PartitionCount(pool));
+        size_t count = partitions.size();
+        std::vector<TElement> partial(count);
+        std::vector<char> hasValue(count, 0);
+        pool.Run(count, [&](size_t part) {
+            auto& iterator = partitions[part];
+            while (iterator->MoveNext()) {
+                TElement value = iterator->GetCurrentValue();
+                partial[part] = hasValue[part] ? func(partial[part], value) : value;
+                hasValue[part] = 1;
+            }
+        });
+        for (size_t step = 1; step < count; step *= 2) {
+            pool.Run((count + 2 * step - 1) / (2 * step), [&](size_t pair) {
+                size_t left = pair * 2 * step;
+                size_t right = left + step;
+                if (right >= count || !hasValue[right]) {
+                    return;
+                }
+                partial[left] = hasValue[left] ? func(partial[left], partial[right]) : partial[right];
+                hasValue[left] = 1;
+            });
+        }
+        return count > 0 && hasValue[0] ? func(initial, partial[0]) : initial;
+    }
+
+    // Обмен с плотным буфером из GetLength() элементов за один проход словаря.
+    // ScatterTo записывает ненулевые элементы, не трогая остальные позиции.
+    void ScatterTo(TElement* dense) const {
+        ForEach([dense](TIndex index, const TElement& value) { dense[index] = value; });
+    }
+
+    // Заменяет содержимое значениями dense[pattern[i]]; нули не сохраняются.
+    void GatherFrom(const TElement* dense, const std::vector<TIndex>& pattern) {
+        for (TIndex index : pattern) {
+            if (index < 0 || index >= length) {
+                throw std::out_of_range("Index is out of bounds.");
+            }
+        }
+        Clear();
+        for (TIndex index : pattern) {
+            if (dense[index] != TElement()) {
+                elements->Add(index, dense[index]);
+            }
+        }
+    }
+
+    void AccumulateInto(TElement* dense, TElement alpha) const {
+        ForEach([dense, alpha](TIndex index, const TElement& value) { dense[index] += alpha * value; });
+    }
+
+    UnqPtr<IDictionaryIterator<TIndex, TElement>> GetIterator() const {
         return elements->GetIterator();
     }
 
 private:
-    int length;
-    UnqPtr<IDictionary<int, TElement>> elements;
+    TIndex length;
+    UnqPtr<IDictionary<TIndex, TElement>> elements;
+
+    // Частей больше, чем потоков, чтобы пул мог выровнять неравные части.
+    static size_t PartitionCount(const ThreadPool& pool) {
+        return pool.GetConcurrency() == 1 ? 1 : pool.GetConcurrency() * 4;
+    }
 };
 
 #endif // SPARSEVECTOR_H
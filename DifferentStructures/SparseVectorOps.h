@@ -0,0 +1,383 @@
+#ifndef SPARSEVECTOROPS_H
+#define SPARSEVECTOROPS_H
+
+#include "CompressedSparseVector.h"
+#include "KeyValue.h"
+#include "SparseVector.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// Арифметика над разреженными векторами за время, зависящее от числа
+// ненулевых элементов, а не от длины. Если оба словаря перечисляют ключи по
+// возрастанию (IDictionary::IsOrdered), векторы сливаются одним проходом,
+// а при пересечении отстающий итератор перескакивает вперёд через SkipTo;
+// иначе меньший вектор проверяется по большему. У CompressedSparseVector
+// пересечение при сильно разных размерах ищется галопом.
+// Результат может совпадать с одним из аргументов.
+
+template<typename TLeft, typename TRight>
+void CheckSameLength(const TLeft &a, const TRight &b) {
+    if (a.GetLength() != b.GetLength())
+        throw std::runtime_error("Vector lengths differ.");
+}
+
+template<typename TVector, typename TElement>
+void CheckSameLength(const TVector &a, const std::vector<TElement> &dense) {
+    if (static_cast<size_t>(a.GetLength()) != dense.size())
+        throw std::runtime_error("Vector lengths differ.");
+}
+
+// func(index, a[index], b[index]) для индексов, ненулевых в обоих векторах.
+template<typename TElement, typename TIndex, typename TFunc>
+void IntersectSparseVectors(const SparseVector<TElement, TIndex> &a, const SparseVector<TElement, TIndex> &b, TFunc func) {
+    if (a.IsOrdered() && b.IsOrdered()) {
+        auto left = a.GetIterator();
+        auto right = b.GetIterator();
+        bool hasLeft = left->MoveNext();
+        bool hasRight = hasLeft && right->MoveNext();
+        while (hasLeft && hasRight) {
+            TIndex leftIndex = left->GetCurrentKey();
+            TIndex rightIndex = right->GetCurrentKey();
+            if (leftIndex < rightIndex) {
+                hasLeft = left->SkipTo(rightIndex);
+            } else if (rightIndex < leftIndex) {
+                hasRight = right->SkipTo(leftIndex);
+            } else {
+                func(leftIndex, left->GetCurrentValue(), right->GetCurrentValue());
+                hasLeft = left->MoveNext();
+                hasRight = right->MoveNext();
+            }
+        }
+        return;
+    }
+
+    bool leftSmaller = a.GetNonZeroCount() <= b.GetNonZeroCount();
+    const SparseVector<TElement, TIndex> &smaller = leftSmaller ? a : b;
+    const SparseVector<TElement, TIndex> &larger = leftSmaller ? b : a;
+    auto iterator = smaller.GetIterator();
+    while (iterator->MoveNext()) {
+        TIndex index = iterator->GetCurrentKey();
+        TElement other = larger.GetElement(index);
+        if (other == TElement())
+            continue;
+        if (leftSmaller)
+            func(index, iterator->GetCurrentValue(), other);
+        else
+            func(index, other, iterator->GetCurrentValue());
+    }
+}
+
+// func(index, a[index], b[index]) для индексов, ненулевых хотя бы в одном векторе.
+template<typename TElement, typename TIndex, typename TFunc>
+void UnionSparseVectors(const SparseVector<TElement, TIndex> &a, const SparseVector<TElement, TIndex> &b, TFunc func) {
+    if (a.IsOrdered() && b.IsOrdered()) {
+        auto left = a.GetIterator();
+        auto right = b.GetIterator();
+        bool hasLeft = left->MoveNext();
+        bool hasRight = right->MoveNext();
+        while (hasLeft || hasRight) {
+            if (!hasRight || (hasLeft && left->GetCurrentKey() < right->GetCurrentKey())) {
+                func(left->GetCurrentKey(), left->GetCurrentValue(), TElement());
+                hasLeft = left->MoveNext();
+            } else if (!hasLeft || right->GetCurrentKey() < left->GetCurrentKey()) {
+                func(right->GetCurrentKey(), TElement(), right->GetCurrentValue());
+                hasRight = right->MoveNext();
+            } else {
+                func(left->GetCurrentKey(), left->GetCurrentValue(), right->GetCurrentValue());
+                hasLeft = left->MoveNext();
+                hasRight = right->MoveNext();
+            }
+        }
+        return;
+    }
+
+    auto left = a.GetIterator();
+    while (left->MoveNext())
+        func(left->GetCurrentKey(), left->GetCurrentValue(), b.GetElement(left->GetCurrentKey()));
+    auto right = b.GetIterator();
+    while (right->MoveNext()) {
+        if (a.GetElement(right->GetCurrentKey()) == TElement())
+            func(right->GetCurrentKey(), TElement(), right->GetCurrentValue());
+    }
+}
+
+// Записывает вычисленные элементы в result по возрастанию индекса.
+template<typename TElement, typename TIndex>
+void AssignSparseVector(SparseVector<TElement, TIndex> &result, std::vector<KeyValue<TIndex, TElement>> &entries) {
+    std::sort(entries.begin(), entries.end(),
+              [](const KeyValue<TIndex, TElement> &x, const KeyValue<TIndex, TElement> &y) { return x.key < y.key; });
+    result.Clear();
+    for (const auto &entry : entries)
+        result.SetElement(entry.key, entry.value);
+}
+
+template<typename TElement, typename TIndex>
+TElement Dot(const SparseVector<TElement, TIndex> &a, const SparseVector<TElement, TIndex> &b) {
+    CheckSameLength(a, b);
+    TElement sum = TElement();
+    IntersectSparseVectors(a, b, [&sum](TIndex, const TElement &x, const TElement &y) { sum += x * y; });
+    return sum;
+}
+
+template<typename TElement, typename TIndex>
+TElement Dot(const SparseVector<TElement, TIndex> &a, const std::vector<TElement> &dense) {
+    CheckSameLength(a, dense);
+    TElement sum = TElement();
+    auto iterator = a.GetIterator();
+    while (iterator->MoveNext())
+        sum += iterator->GetCurrentValue() * dense[iterator->GetCurrentKey()];
+    return sum;
+}
+
+// y = alpha * x + y.
+template<typename TElement, typename TIndex>
+void Axpy(TElement alpha, const SparseVector<TElement, TIndex> &x, SparseVector<TElement, TIndex> &y) {
+    CheckSameLength(x, y);
+    if (&x == &y) {
+        y.MultiplyByScalar(alpha + TElement(1));
+        return;
+    }
+    std::vector<KeyValue<TIndex, TElement>> updates;
+    updates.reserve(x.GetNonZeroCount());
+    auto iterator = x.GetIterator();
+    while (iterator->MoveNext()) {
+        TIndex index = iterator->GetCurrentKey();
+        updates.push_back(KeyValue<TIndex, TElement>(index, y.GetElement(index) + alpha * iterator->GetCurrentValue()));
+    }
+    for (const auto &update : updates)
+        y.SetElement(update.key, update.value);
+}
+
+template<typename TElement, typename TIndex>
+void Axpy(TElement alpha, const SparseVector<TElement, TIndex> &x, std::vector<TElement> &y) {
+    CheckSameLength(x, y);
+    auto iterator = x.GetIterator();
+    while (iterator->MoveNext())
+        y[iterator->GetCurrentKey()] += alpha * iterator->GetCurrentValue();
+}
+
+template<typename TElement, typename TIndex>
+void Add(const SparseVector<TElement, TIndex> &a, const SparseVector<TElement, TIndex> &b, SparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, b);
+    CheckSameLength(a, result);
+    std::vector<KeyValue<TIndex, TElement>> entries;
+    UnionSparseVectors(a, b, [&entries](TIndex index, const TElement &x, const TElement &y) {
+        entries.push_back(KeyValue<TIndex, TElement>(index, x + y));
+    });
+    AssignSparseVector(result, entries);
+}
+
+template<typename TElement, typename TIndex>
+void Subtract(const SparseVector<TElement, TIndex> &a, const SparseVector<TElement, TIndex> &b, SparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, b);
+    CheckSameLength(a, result);
+    std::vector<KeyValue<TIndex, TElement>> entries;
+    UnionSparseVectors(a, b, [&entries](TIndex index, const TElement &x, const TElement &y) {
+        entries.push_back(KeyValue<TIndex, TElement>(index, x - y));
+    });
+    AssignSparseVector(result, entries);
+}
+
+// Поэлементное произведение (Адамара).
+template<typename TElement, typename TIndex>
+void Multiply(const SparseVector<TElement, TIndex> &a, const SparseVector<TElement, TIndex> &b, SparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, b);
+    CheckSameLength(a, result);
+    std::vector<KeyValue<TIndex, TElement>> entries;
+    IntersectSparseVectors(a, b, [&entries](TIndex index, const TElement &x, const TElement &y) {
+        entries.push_back(KeyValue<TIndex, TElement>(index, x * y));
+    });
+    AssignSparseVector(result, entries);
+}
+
+template<typename TElement, typename TIndex>
+void Multiply(const SparseVector<TElement, TIndex> &a, const std::vector<TElement> &dense, SparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, dense);
+    CheckSameLength(a, result);
+    std::vector<KeyValue<TIndex, TElement>> entries;
+    auto iterator = a.GetIterator();
+    while (iterator->MoveNext()) {
+        TIndex index = iterator->GetCurrentKey();
+        entries.push_back(KeyValue<TIndex, TElement>(index, iterator->GetCurrentValue() * dense[index]));
+    }
+    AssignSparseVector(result, entries);
+}
+
+// Первая позиция в [from, size) с индексом >= index: шаг удваивается, затем
+// двоичный поиск в последнем отрезке. O(log d), где d - пройденное расстояние.
+template<typename TIndex>
+size_t GallopLowerBound(const TIndex *indices, size_t from, size_t size, TIndex index) {
+    size_t step = 1;
+    size_t low = from;
+    size_t high = from;
+    while (high < size && indices[high] < index) {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    return std::lower_bound(indices + low, indices + std::min(high, size), index) - indices;
+}
+
+template<typename TElement, typename TIndex, typename TFunc>
+void IntersectCompressed(const CompressedSparseVector<TElement, TIndex> &a, const CompressedSparseVector<TElement, TIndex> &b,
+                         TFunc func) {
+    const TIndex *aIndices = a.Indices();
+    const TElement *aValues = a.Values();
+    const TIndex *bIndices = b.Indices();
+    const TElement *bValues = b.Values();
+    size_t aSize = a.GetNonZeroCount();
+    size_t bSize = b.GetNonZeroCount();
+
+    // Галоп окупается, когда один вектор заметно короче другого.
+    if (aSize * 8 < bSize || bSize * 8 < aSize) {
+        bool leftSmaller = aSize < bSize;
+        const TIndex *small = leftSmaller ? aIndices : bIndices;
+        const TIndex *large = leftSmaller ? bIndices : aIndices;
+        size_t smallSize = leftSmaller ? aSize : bSize;
+        size_t largeSize = leftSmaller ? bSize : aSize;
+        size_t position = 0;
+        for (size_t i = 0; i < smallSize && position < largeSize; ++i) {
+            position = GallopLowerBound(large, position, largeSize, small[i]);
+            if (position < largeSize && large[position] == small[i]) {
+                if (leftSmaller)
+                    func(small[i], aValues[i], bValues[position]);
+                else
+                    func(small[i], aValues[position], bValues[i]);
+            }
+        }
+        return;
+    }
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < aSize && j < bSize) {
+        if (aIndices[i] < bIndices[j]) {
+            ++i;
+        } else if (bIndices[j] < aIndices[i]) {
+            ++j;
+        } else {
+            func(aIndices[i], aValues[i], bValues[j]);
+            ++i;
+            ++j;
+        }
+    }
+}
+
+template<typename TElement, typename TIndex, typename TFunc>
+void UnionCompressed(const CompressedSparseVector<TElement, TIndex> &a, const CompressedSparseVector<TElement, TIndex> &b,
+                     TFunc func) {
+    const TIndex *aIndices = a.Indices();
+    const TElement *aValues = a.Values();
+    const TIndex *bIndices = b.Indices();
+    const TElement *bValues = b.Values();
+    size_t aSize = a.GetNonZeroCount();
+    size_t bSize = b.GetNonZeroCount();
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < aSize || j < bSize) {
+        if (j == bSize || (i < aSize && aIndices[i] < bIndices[j])) {
+            func(aIndices[i], aValues[i], TElement());
+            ++i;
+        } else if (i == aSize || bIndices[j] < aIndices[i]) {
+            func(bIndices[j], TElement(), bValues[j]);
+            ++j;
+        } else {
+            func(aIndices[i], aValues[i], bValues[j]);
+            ++i;
+            ++j;
+        }
+    }
+}
+
+template<typename TElement, typename TIndex>
+TElement Dot(const CompressedSparseVector<TElement, TIndex> &a, const CompressedSparseVector<TElement, TIndex> &b) {
+    CheckSameLength(a, b);
+    TElement sum = TElement();
+    IntersectCompressed(a, b, [&sum](TIndex, const TElement &x, const TElement &y) { sum += x * y; });
+    return sum;
+}
+
+template<typename TElement, typename TIndex>
+TElement Dot(const CompressedSparseVector<TElement, TIndex> &a, const std::vector<TElement> &dense) {
+    CheckSameLength(a, dense);
+    const TIndex *indices = a.Indices();
+    const TElement *values = a.Values();
+    size_t size = a.GetNonZeroCount();
+    TElement sum = TElement();
+    for (size_t i = 0; i < size; ++i)
+        sum += values[i] * dense[indices[i]];
+    return sum;
+}
+
+// y = alpha * x + y.
+template<typename TElement, typename TIndex>
+void Axpy(TElement alpha, const CompressedSparseVector<TElement, TIndex> &x, CompressedSparseVector<TElement, TIndex> &y) {
+    CheckSameLength(x, y);
+    CompressedSparseVector<TElement, TIndex> result(y.GetLength());
+    UnionCompressed(x, y, [&result, alpha](TIndex index, const TElement &a, const TElement &b) {
+        result.SetElement(index, alpha * a + b);
+    });
+    y = std::move(result);
+}
+
+template<typename TElement, typename TIndex>
+void Axpy(TElement alpha, const CompressedSparseVector<TElement, TIndex> &x, std::vector<TElement> &y) {
+    CheckSameLength(x, y);
+    const TIndex *indices = x.Indices();
+    const TElement *values = x.Values();
+    size_t size = x.GetNonZeroCount();
+    for (size_t i = 0; i < size; ++i)
+        y[indices[i]] += alpha * values[i];
+}
+
+template<typename TElement, typename TIndex>
+void Add(const CompressedSparseVector<TElement, TIndex> &a, const CompressedSparseVector<TElement, TIndex> &b,
+         CompressedSparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, b);
+    CheckSameLength(a, result);
+    CompressedSparseVector<TElement, TIndex> sum(a.GetLength());
+    UnionCompressed(a, b, [&sum](TIndex index, const TElement &x, const TElement &y) { sum.SetElement(index, x + y); });
+    result = std::move(sum);
+}
+
+template<typename TElement, typename TIndex>
+void Subtract(const CompressedSparseVector<TElement, TIndex> &a, const CompressedSparseVector<TElement, TIndex> &b,
+              CompressedSparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, b);
+    CheckSameLength(a, result);
+    CompressedSparseVector<TElement, TIndex> difference(a.GetLength());
+    UnionCompressed(a, b, [&difference](TIndex index, const TElement &x, const TElement &y) {
+        difference.SetElement(index, x - y);
+    });
+    result = std::move(difference);
+}
+
+template<typename TElement, typename TIndex>
+void Multiply(const CompressedSparseVector<TElement, TIndex> &a, const CompressedSparseVector<TElement, TIndex> &b,
+              CompressedSparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, b);
+    CheckSameLength(a, result);
+    CompressedSparseVector<TElement, TIndex> product(a.GetLength());
+    IntersectCompressed(a, b, [&product](TIndex index, const TElement &x, const TElement &y) {
+        product.SetElement(index, x * y);
+    });
+    result = std::move(product);
+}
+
+template<typename TElement, typename TIndex>
+void Multiply(const CompressedSparseVector<TElement, TIndex> &a, const std::vector<TElement> &dense,
+              CompressedSparseVector<TElement, TIndex> &result) {
+    CheckSameLength(a, dense);
+    CheckSameLength(a, result);
+    const TIndex *indices = a.Indices();
+    const TElement *values = a.Values();
+    size_t size = a.GetNonZeroCount();
+    CompressedSparseVector<TElement, TIndex> product(a.GetLength());
+    for (size_t i = 0; i < size; ++i)
+        product.SetElement(indices[i], values[i] * dense[indices[i]]);
+    result = std::move(product);
+}
+
+#endif // SPARSEVECTOROPS_H
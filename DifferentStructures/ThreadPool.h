@@ -0,0 +1,200 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include "UnqPtr.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с захватом работы (work stealing). У каждого потока своя
+// очередь: хозяин берёт задачи с её конца, а освободившиеся потоки забирают
+// задачи с начала чужих очередей. Поток, вызвавший Run(), сам выполняет
+// задачи, пока ждёт, поэтому Run() можно вызывать и изнутри задачи.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workerCount = DefaultWorkerCount())
+            : queues(new Queue[workerCount + 1]), queueCount(workerCount + 1), pending(0), stopping(false) {
+        for (size_t i = 0; i < workerCount; ++i)
+            workers.emplace_back([this, i] { WorkerLoop(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Число потоков, одновременно выполняющих задачи Run(), включая вызывающий.
+    size_t GetConcurrency() const {
+        return workers.size() + 1;
+    }
+
+    // Выполняет task(0), ..., task(count - 1) и возвращается, когда все они
+    // завершены. Первое исключение из задач пробрасывается вызывающему.
+    void Run(size_t count, const std::function<void(size_t)> &task) {
+        if (count == 0)
+            return;
+        if (workers.empty()) {
+            for (size_t i = 0; i < count; ++i)
+                task(i);
+            return;
+        }
+
+        Batch batch(task, count);
+        size_t self = CurrentQueue();
+        // Задачи раскладываются по всем очередям сразу: до захвата работы
+        // дело доходит только при неравных по стоимости задачах.
+        for (size_t i = 0; i < count; ++i) {
+            Queue &queue = queues[(self + i) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(Job{&batch, i});
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            pending += count;
+        }
+        wake.notify_all();
+
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                if (batch.remaining == 0)
+                    break;
+            }
+            Job job;
+            if (TryPop(self, job)) {
+                Execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(batch.mutex);
+            batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+        }
+
+        if (batch.error)
+            std::rethrow_exception(batch.error);
+    }
+
+    // Общий пул на все ядра машины.
+    static ThreadPool &Shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    static size_t DefaultWorkerCount() {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 0;
+    }
+
+private:
+    struct Batch {
+        const std::function<void(size_t)> &task;
+        size_t remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+
+        Batch(const std::function<void(size_t)> &task, size_t count) : task(task), remaining(count) {}
+    };
+
+    struct Job {
+        Batch *batch = nullptr;
+        size_t index = 0;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // Последняя очередь принадлежит потокам, не входящим в пул.
+    UnqPtr<Queue[]> queues;
+    size_t queueCount;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    size_t pending;
+    bool stopping;
+
+    // Очередь текущего потока: своя для рабочего потока этого пула, иначе общая.
+    size_t CurrentQueue() const {
+        return CurrentWorker().pool == this ? CurrentWorker().index : queueCount - 1;
+    }
+
+    struct WorkerIdentity {
+        const ThreadPool *pool = nullptr;
+        size_t index = 0;
+    };
+
+    static WorkerIdentity &CurrentWorker() {
+        thread_local WorkerIdentity identity;
+        return identity;
+    }
+
+    bool TryPop(size_t self, Job &job) {
+        for (size_t offset = 0; offset < queueCount; ++offset) {
+            Queue &queue = queues[(self + offset) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+                continue;
+            if (offset == 0) {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            } else {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+            std::lock_guard<std::mutex> sleepLock(sleepMutex);
+            --pending;
+            return true;
+        }
+        return false;
+    }
+
+    // После уменьшения счётчика до нуля Batch может быть уже разрушен
+    // вызывающим потоком, поэтому счётчик меняется под его мьютексом.
+    static void Execute(const Job &job) {
+        Batch *batch = job.batch;
+        std::exception_ptr error;
+        try {
+            batch->task(job.index);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        if (error && !batch->error)
+            batch->error = error;
+        if (--batch->remaining == 0)
+            batch->done.notify_all();
+    }
+
+    void WorkerLoop(size_t index) {
+        CurrentWorker() = WorkerIdentity{this, index};
+        while (true) {
+            Job job;
+            if (TryPop(index, job)) {
+                Execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping && pending == 0)
+                return;
+        }
+    }
+};
+
+#endif // THREADPOOL_H
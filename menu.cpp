@@ -5,6 +5,7 @@ using namespace std;
 #include "DifferentStructures/SparseMatrix.h"
 #include "DifferentStructures/HashTable.h"
 #include "DifferentStructures/BTree.h"
+#include "DifferentStructures/RoaringDictionary.h"
 #include "DifferentStructures/UnqPtr.h"
 #include <cmath>
 
@@ -21,6 +22,7 @@ void displayMenu() {
     std::cout << "\n=== Select Dictionary ===\n";
     std::cout << "1. HashTable\n";
     std::cout << "2. BTree\n";
+    std::cout << "3. RoaringDictionary (Sparse Vector only)\n";
     std::cout << "Your choice: ";
     std::cin >> dictionaryChoice;
 
@@ -34,6 +36,9 @@ void displayMenu() {
         } else if (dictionaryChoice == 2) {
             dictionary = UnqPtr<IDictionary<int, double>>(new BTree<int, double>());
             std::cout << "\n[INFO] Using BTree for Sparse Vector.\n";
+        } else if (dictionaryChoice == 3) {
+            dictionary = UnqPtr<IDictionary<int, double>>(new RoaringDictionary<double>());
+            std::cout << "\n[INFO] Using RoaringDictionary for Sparse Vector.\n";
         } else {
             std::cerr << "Error: Invalid dictionary choice.\n";
             return;
@@ -52,6 +57,9 @@ void displayMenu() {
         } else if (dictionaryChoice == 2) {
             dictionary = UnqPtr<IDictionary<IndexPair, double>>(new BTree<IndexPair, double>());
             std::cout << "\n[INFO] Using BTree for Sparse Matrix.\n";
+        } else if (dictionaryChoice == 3) {
+            std::cerr << "Error: RoaringDictionary supports only int keys (Sparse Vector).\n";
+            return;
         } else {
             std::cerr << "Error: Invalid dictionary choice.\n";
             return;
@@ -4,15 +4,40 @@
 #include "DifferentStructures/BTree.h"
 #include "DifferentStructures/UnqPtr.h"
 #include "DifferentStructures/HashTable.h"
+#include "DifferentStructures/ConcurrentBTree.h"
+#include "DifferentStructures/PagedBTree.h"
+#include "DifferentStructures/BEpsilonTree.h"
+#include "DifferentStructures/BTreeAlgorithms.h"
+#include "DifferentStructures/AdaptiveRadixTree.h"
+#include "DifferentStructures/ConcurrentSkipList.h"
+#include "DifferentStructures/LearnedIndex.h"
+#include "DifferentStructures/EytzingerDictionary.h"
+#include "DifferentStructures/CompressedSparseVector.h"
+#include "DifferentStructures/AdaptiveSparseVector.h"
+#include "DifferentStructures/SparseVectorOps.h"
+#include "DifferentStructures/SparseExpression.h"
+#include "DifferentStructures/ThreadPool.h"
+#include "DifferentStructures/SimdKernels.h"
+#include "DifferentStructures/RoaringDictionary.h"
 #include <iostream>
 #include <fstream>
 #include <chrono>
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <cstdio>
+#include <cmath>
 #include <unordered_set>
 #include <algorithm>
 #include <random>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <climits>
+#include <map>
+#include <filesystem>
+#include <sstream>
 
 void run_tests() {
     std::cout << "Executing functional checks..." << std::endl;
@@ -27,12 +52,43 @@ void run_tests() {
 void functional_tests() {
     test_dictionary<HashTable<int, std::string>, int, std::string>("HashTable");
     test_dictionary<BTree<int, std::string>, int, std::string>("BTree");
+    test_dictionary<BEpsilonTree<int, std::string>, int, std::string>("BEpsilonTree");
+    test_dictionary<AdaptiveRadixTree<int, std::string>, int, std::string>("AdaptiveRadixTree");
+    test_dictionary<RoaringDictionary<std::string>, int, std::string>("RoaringDictionary");
 
     test_sparse_vector<HashTable<int, double>>("HashTable", true);
     test_sparse_vector<BTree<int, double>>("BTree", true);
+    test_sparse_vector<BEpsilonTree<int, double>>("BEpsilonTree", true);
+    test_sparse_vector<AdaptiveRadixTree<int, double>>("AdaptiveRadixTree", true);
+    test_sparse_vector<ConcurrentSkipList<int, double>>("ConcurrentSkipList", true);
+    test_sparse_vector<RoaringDictionary<double>>("RoaringDictionary", true);
+
+    test_compressed_sparse_vector();
+    test_adaptive_sparse_vector();
+    test_sparse_vector_ops();
+    test_sparse_expressions();
+    test_wide_index_sparse_vector();
+    test_dense_exchange();
+    test_roaring_dictionary();
+    test_sparse_vector_map();
+    test_parallel_sparse_vector();
 
     test_sparse_matrix<HashTable<IndexPair, double>>("HashTable", true);
     test_sparse_matrix<BTree<IndexPair, double>>("BTree", true);
+    test_sparse_matrix<AdaptiveRadixTree<IndexPair, double>>("AdaptiveRadixTree", true);
+
+    test_concurrent_btree_stress();
+    test_concurrent_skip_list_stress();
+    test_btree_snapshot();
+    test_btree_order_statistics();
+    test_btree_upsert_erase();
+    test_bepsilon_tree_count();
+    test_adaptive_radix_tree_layouts();
+    test_btree_set_operations();
+    test_btree_metrics();
+    test_learned_index();
+    test_eytzinger_dictionary();
+    test_paged_btree();
 
     std::cout << "All functional verifications succeeded." << std::endl;
 }
@@ -137,6 +193,1279 @@ void test_sparse_matrix(const std::string& dictionary_name, bool extended) {
     std::cout << "Calculated Reduce sum: " << sum << std::endl;
 }
 
+// Случайные записи через буфер сверяются с SparseVector поверх HashTable.
+void test_compressed_sparse_vector() {
+    std::cout << "Testing CompressedSparseVector..." << std::endl;
+    const int length = 5000;
+    CompressedSparseVector<double> vector(length);
+    UnqPtr<IDictionary<int, double>> dictionary(new HashTable<int, double>());
+    SparseVector<double> reference(length, std::move(dictionary));
+
+    std::mt19937 gen(17);
+    bool ok = true;
+    for (int i = 0; ok && i < 50000; ++i) {
+        int index = static_cast<int>(gen() % length);
+        double value = gen() % 4 == 0 ? 0.0 : static_cast<double>(gen() % 100);
+        if (i % 7 == 0) {
+            vector.RemoveElement(index);
+            reference.RemoveElement(index);
+        } else if (i % 3 == 0) {
+            ok = vector.GetElement(index) == reference.GetElement(index);
+        } else {
+            vector.SetElement(index, value);
+            reference.SetElement(index, value);
+        }
+    }
+
+    size_t nonZero = 0;
+    for (int index = 0; ok && index < length; ++index) {
+        ok = vector.GetElement(index) == reference.GetElement(index);
+        if (reference.GetElement(index) != 0.0)
+            ++nonZero;
+    }
+    ok = ok && vector.GetNonZeroCount() == nonZero;
+    for (size_t i = 1; ok && i < nonZero; ++i)
+        ok = vector.Indices()[i - 1] < vector.Indices()[i];
+
+    vector.MultiplyByScalar(2.0);
+    double sum = vector.Reduce([](double acc, double x) { return acc + x; }, 0.0);
+    double expectedSum = 2.0 * reference.Reduce([](double acc, double x) { return acc + x; }, 0.0);
+
+    if (!ok || sum != expectedSum)
+        std::cerr << "Error: CompressedSparseVector disagrees with SparseVector." << std::endl;
+    else
+        std::cout << "CompressedSparseVector passed with " << nonZero << " nonzeros." << std::endl;
+}
+
+// Ядра сверяются с поэлементным расчётом через GetElement.
+// Заполнение до полной плотности и обратно проводит вектор через все три
+// формы; после каждого шага содержимое сверяется с обычным массивом.
+void test_adaptive_sparse_vector() {
+    std::cout << "Testing AdaptiveSparseVector..." << std::endl;
+    using Representation = AdaptiveSparseVector<double>::Representation;
+    const int length = 5000;
+    AdaptiveSparseVector<double> vector(length);
+    std::vector<double> reference(length);
+    std::vector<int> order(length);
+    for (int index = 0; index < length; ++index)
+        order[index] = index;
+    std::mt19937 gen(46);
+    std::shuffle(order.begin(), order.end(), gen);
+
+    auto matches = [&]() {
+        size_t nonZeros = 0;
+        for (int index = 0; index < length; ++index) {
+            if (vector.GetElement(index) != reference[index])
+                return false;
+            nonZeros += reference[index] != 0.0;
+        }
+        size_t iterated = 0;
+        auto iterator = vector.GetIterator();
+        while (iterator->MoveNext()) {
+            if (reference[iterator->GetCurrentKey()] != iterator->GetCurrentValue())
+                return false;
+            ++iterated;
+        }
+        return vector.GetNonZeroCount() == nonZeros && iterated == nonZeros;
+    };
+
+    bool ok = true;
+    bool visited[3] = {false, false, false};
+    for (int step = 0; ok && step < length; ++step) {
+        vector.SetElement(order[step], step + 1.0);
+        reference[order[step]] = step + 1.0;
+        visited[static_cast<int>(vector.GetRepresentation())] = true;
+        if (step % 500 == 0)
+            ok = matches();
+    }
+    ok = ok && vector.GetRepresentation() == Representation::Dense && matches();
+
+    vector.Map([](double x) { return static_cast<long long>(x) % 2 == 0 ? 0.0 : x; });
+    for (double &value : reference)
+        value = static_cast<long long>(value) % 2 == 0 ? 0.0 : value;
+    ok = ok && matches();
+
+    for (int step = 0; ok && step < length; ++step) {
+        vector.RemoveElement(order[step]);
+        reference[order[step]] = 0.0;
+        if (step % 500 == 0)
+            ok = matches();
+    }
+    ok = ok && vector.GetRepresentation() == Representation::Sparse && matches() &&
+         visited[0] && visited[1] && visited[2];
+
+    // Чередование удаления и вставки у границы Sparse/Bitmap должно стоить
+    // столько же, сколько вдали от неё, а не сливать буфер на каждой записи.
+    const int wideLength = 1 << 20;
+    auto churn = [&](int nonZeros) {
+        AdaptiveSparseVector<double> wide(wideLength);
+        for (int i = 0; i < nonZeros; ++i)
+            wide.SetElement(i * 2, 1.0);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 4000; ++i) {
+            wide.RemoveElement(i * 2);
+            wide.SetElement(i * 2 + 1, 1.0);
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ok = ok && wide.GetNonZeroCount() == static_cast<size_t>(nonZeros);
+        return elapsed;
+    };
+    AdaptiveSparseVector<double> probe(wideLength);
+    int promoted = 0;
+    while (probe.GetRepresentation() == Representation::Sparse)
+        probe.SetElement(promoted++ * 2, 1.0);
+    double far = churn(promoted / 2);
+    // promoted / 5 * 4 - само значение границы, promoted - 2 - её верх с запасом.
+    for (int nonZeros : {promoted / 5 * 4 - 2, promoted / 5 * 4 + 2, promoted - 2})
+        ok = ok && churn(nonZeros) < 20 * far + 0.01;
+
+    if (!ok)
+        std::cerr << "Error: AdaptiveSparseVector disagrees with the dense reference." << std::endl;
+    else
+        std::cout << "AdaptiveSparseVector passed through all representations." << std::endl;
+}
+
+void test_sparse_vector_ops() {
+    std::cout << "Testing sparse vector arithmetic..." << std::endl;
+    const int length = 2000;
+    UnqPtr<IDictionary<int, double>> ordered(new BTree<int, double>());
+    UnqPtr<IDictionary<int, double>> hashed(new HashTable<int, double>());
+    UnqPtr<IDictionary<int, double>> target(new BTree<int, double>());
+    SparseVector<double> a(length, std::move(ordered));
+    SparseVector<double> b(length, std::move(hashed));
+    SparseVector<double> result(length, std::move(target));
+    CompressedSparseVector<double> compressedA(length), compressedB(length), compressedResult(length);
+    std::vector<double> dense(length);
+
+    for (int index = 0; index < length; index += 3) {
+        a.SetElement(index, index % 7 + 1.0);
+        compressedA.SetElement(index, index % 7 + 1.0);
+    }
+    for (int index = 0; index < length; index += 5) {
+        b.SetElement(index, index % 4 + 1.0);
+        compressedB.SetElement(index, index % 4 + 1.0);
+    }
+    for (int index = 0; index < length; ++index)
+        dense[index] = index % 3;
+
+    double expectedDot = 0;
+    double expectedDenseDot = 0;
+    for (int index = 0; index < length; ++index) {
+        expectedDot += a.GetElement(index) * b.GetElement(index);
+        expectedDenseDot += a.GetElement(index) * dense[index];
+    }
+    bool ok = Dot(a, b) == expectedDot && Dot(compressedA, compressedB) == expectedDot &&
+              Dot(a, dense) == expectedDenseDot && Dot(compressedA, dense) == expectedDenseDot;
+
+    Add(a, b, result);
+    Add(compressedA, compressedB, compressedResult);
+    for (int index = 0; ok && index < length; ++index)
+        ok = result.GetElement(index) == a.GetElement(index) + b.GetElement(index) &&
+             compressedResult.GetElement(index) == result.GetElement(index);
+
+    Multiply(a, b, result);
+    Multiply(compressedA, compressedB, compressedResult);
+    for (int index = 0; ok && index < length; ++index)
+        ok = result.GetElement(index) == a.GetElement(index) * b.GetElement(index) &&
+             compressedResult.GetElement(index) == result.GetElement(index);
+
+    Subtract(a, a, result);
+    ok = ok && result.GetNonZeroCount() == 0;
+
+    Axpy(2.0, b, a);
+    Axpy(2.0, compressedB, compressedA);
+    for (int index = 0; ok && index < length; ++index)
+        ok = a.GetElement(index) == compressedA.GetElement(index);
+
+    if (!ok)
+        std::cerr << "Error: sparse vector arithmetic disagrees with elementwise results." << std::endl;
+    else
+        std::cout << "Sparse vector arithmetic passed, dot product " << expectedDot << "." << std::endl;
+}
+
+// Map меняет значения на месте и сразу выбрасывает обнулившиеся элементы;
+// проверяется собственный обход BTree и HashTable и обход по снимку ключей (ART).
+template <typename DictionaryType>
+bool check_sparse_vector_map(const std::string& dictionary_name) {
+    const int length = 3000;
+    UnqPtr<IDictionary<int, int>> dictionary(new DictionaryType());
+    SparseVector<int> vector(length, std::move(dictionary));
+    for (int index = 0; index < length; ++index)
+        vector.SetElement(index, index % 5);
+
+    vector.Map([](int x) { return x % 2 == 0 ? 0 : x * 3; });
+    bool ok = vector.GetNonZeroCount() == static_cast<size_t>(length / 5 * 2);
+    for (int index = 0; ok && index < length; ++index) {
+        int expected = index % 5 % 2 == 0 ? 0 : index % 5 * 3;
+        ok = vector.GetElement(index) == expected;
+    }
+
+    vector.MultiplyByScalar(0);
+    ok = ok && vector.GetNonZeroCount() == 0;
+    if (!ok)
+        std::cerr << "Error: SparseVector::Map with " << dictionary_name << " kept wrong elements." << std::endl;
+    return ok;
+}
+
+void test_sparse_vector_map() {
+    std::cout << "Testing in-place SparseVector::Map..." << std::endl;
+    bool ok = check_sparse_vector_map<HashTable<int, int>>("HashTable");
+    ok = check_sparse_vector_map<BTree<int, int>>("BTree") && ok;
+    ok = check_sparse_vector_map<AdaptiveRadixTree<int, int>>("AdaptiveRadixTree") && ok;
+
+    // Узлы, общие со снимком, копируются при обходе, снимок не меняется.
+    BTree<int, int> tree;
+    for (int key = 0; key < 1000; ++key)
+        tree.Add(key, key + 1);
+    auto snapshot = tree.Snapshot();
+    {
+        auto iterator = tree.GetMutableIterator();
+        while (iterator->MoveNext()) {
+            if (iterator->GetCurrentKey() % 2)
+                iterator->RemoveCurrent();
+            else
+                iterator->GetCurrentValueRef() *= 2;
+        }
+    }
+    ok = ok && tree.GetCount() == 500 && snapshot->GetCount() == 1000;
+    for (int key = 0; ok && key < 1000; ++key)
+        ok = snapshot->Get(key) == key + 1 && (key % 2 ? !tree.ContainsKey(key) : tree.Get(key) == 2 * (key + 1));
+
+    if (!ok)
+        std::cerr << "Error: mutable dictionary iteration failed." << std::endl;
+    else
+        std::cout << "In-place SparseVector::Map passed." << std::endl;
+}
+
+std::atomic<long long> parallel_for_each_sum(0);
+
+void add_to_parallel_sum(int, const int& value) {
+    parallel_for_each_sum += value;
+}
+
+int add_ints(int a, int b) {
+    return a + b;
+}
+
+// Параллельные версии сверяются с последовательными на пуле из нескольких
+// потоков независимо от числа ядер.
+template <typename DictionaryType>
+bool check_parallel_sparse_vector(ThreadPool& pool) {
+    const int length = 20000;
+    UnqPtr<IDictionary<int, int>> parallelDictionary(new DictionaryType());
+    UnqPtr<IDictionary<int, int>> serialDictionary(new DictionaryType());
+    SparseVector<int> parallel(length, std::move(parallelDictionary));
+    SparseVector<int> serial(length, std::move(serialDictionary));
+    for (int index = 0; index < length; index += 2) {
+        parallel.SetElement(index, index % 9 + 1);
+        serial.SetElement(index, index % 9 + 1);
+    }
+
+    auto func = [](int x) { return x % 3 == 0 ? 0 : x * 2; };
+    parallel.ParallelMap(func, pool);
+    serial.Map(func);
+    bool ok = parallel.GetNonZeroCount() == serial.GetNonZeroCount();
+    for (int index = 0; ok && index < length; ++index)
+        ok = parallel.GetElement(index) == serial.GetElement(index);
+
+    ok = ok && parallel.ParallelReduce(add_ints, 7, pool) == serial.Reduce(add_ints, 7);
+    parallel_for_each_sum = 0;
+    parallel.ParallelForEach(add_to_parallel_sum, pool);
+    return ok && parallel_for_each_sum == serial.Reduce(add_ints, 0);
+}
+
+void test_parallel_sparse_vector() {
+    std::cout << "Testing parallel SparseVector operations..." << std::endl;
+    ThreadPool pool(3);
+    bool ok = check_parallel_sparse_vector<HashTable<int, int>>(pool);
+    ok = check_parallel_sparse_vector<BTree<int, int>>(pool) && ok;
+    ok = check_parallel_sparse_vector<BTree<int, int, 4>>(pool) && ok;
+    ok = check_parallel_sparse_vector<AdaptiveRadixTree<int, int>>(pool) && ok;
+    // Пул без рабочих потоков: ParallelMap сразу сводится к Map.
+    ThreadPool callerOnly(0);
+    ok = check_parallel_sparse_vector<AdaptiveRadixTree<int, int>>(callerOnly) && ok;
+    ok = check_parallel_sparse_vector<BTree<int, int>>(callerOnly) && ok;
+
+    // Вложенный Run() выполняется потоками пула и вызывающим без взаимной блокировки.
+    std::atomic<int> nested(0);
+    pool.Run(8, [&](size_t) { pool.Run(8, [&](size_t) { ++nested; }); });
+    ok = ok && nested == 64;
+
+    bool thrown = false;
+    try {
+        pool.Run(4, [](size_t index) {
+            if (index == 2)
+                throw std::runtime_error("task failed");
+        });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+
+    if (!ok || !thrown)
+        std::cerr << "Error: parallel SparseVector operations disagree with serial ones." << std::endl;
+    else
+        std::cout << "Parallel SparseVector operations passed." << std::endl;
+}
+
+// Выражения сверяются с поэлементным вычислением: упорядоченные операнды
+// (слияние), смешанные с HashTable (список индексов) и присваивание в операнд.
+void test_sparse_expressions() {
+    std::cout << "Testing lazy SparseVector expressions..." << std::endl;
+    const int length = 3000;
+    UnqPtr<IDictionary<int, double>> xDictionary(new BTree<int, double>());
+    UnqPtr<IDictionary<int, double>> zDictionary(new AdaptiveRadixTree<int, double>());
+    UnqPtr<IDictionary<int, double>> hDictionary(new HashTable<int, double>());
+    UnqPtr<IDictionary<int, double>> yDictionary(new BTree<int, double>());
+    SparseVector<double> x(length, std::move(xDictionary));
+    SparseVector<double> z(length, std::move(zDictionary));
+    SparseVector<double> h(length, std::move(hDictionary));
+    SparseVector<double> y(length, std::move(yDictionary));
+    for (int index = 0; index < length; index += 2)
+        x.SetElement(index, index % 5 + 1.0);
+    for (int index = 0; index < length; index += 3)
+        z.SetElement(index, index % 4 + 1.0);
+    for (int index = 0; index < length; index += 7)
+        h.SetElement(index, 2.0);
+    for (int index = 1; index < length; index += 11)
+        y.SetElement(index, 100.0);
+
+    auto check = [&](auto expected) {
+        size_t nonZeros = 0;
+        for (int index = 0; index < length; ++index) {
+            double value = expected(index);
+            if (y.GetElement(index) != value)
+                return false;
+            nonZeros += value != 0.0;
+        }
+        return y.GetNonZeroCount() == nonZeros;
+    };
+
+    y = 2.0 * x + 3.0 * z;
+    bool ok = check([&](int i) { return 2.0 * x.GetElement(i) + 3.0 * z.GetElement(i); });
+
+    // x - x даёт нули, которые не должны попасть в результат.
+    y = x - x + z * 0.5 - h;
+    ok = ok && check([&](int i) { return 0.5 * z.GetElement(i) - h.GetElement(i); });
+
+    std::vector<double> before(length);
+    for (int index = 0; index < length; ++index)
+        before[index] = y.GetElement(index);
+    y += -x + 2.0 * y;
+    ok = ok && check([&](int i) { return before[i] - x.GetElement(i) + 2.0 * before[i]; });
+
+    // Обычный вектор справа меняет y на месте; y -= x после y = x должен удалить все индексы.
+    for (int index = 0; index < length; ++index)
+        before[index] = y.GetElement(index);
+    y += h;
+    y -= x;
+    y += 0.5 * z;
+    ok = ok && check([&](int i) { return before[i] + h.GetElement(i) - x.GetElement(i) + 0.5 * z.GetElement(i); });
+    y = 1.0 * x;
+    y -= x;
+    ok = ok && check([](int) { return 0.0; });
+
+    UnqPtr<IDictionary<int, double>> shortDictionary(new BTree<int, double>());
+    SparseVector<double> shorter(length - 1, std::move(shortDictionary));
+    bool thrown = false;
+    try {
+        y = x + shorter;
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+
+    if (!ok || !thrown)
+        std::cerr << "Error: lazy SparseVector expressions disagree with elementwise results." << std::endl;
+    else
+        std::cout << "Lazy SparseVector expressions passed." << std::endl;
+}
+
+// Индексы за пределами int: хеши признаков в пространстве 2^40.
+void test_wide_index_sparse_vector() {
+    std::cout << "Testing 64-bit SparseVector indices..." << std::endl;
+    const int64_t length = int64_t(1) << 40;
+    const int64_t stride = (int64_t(1) << 32) + 7;
+    UnqPtr<IDictionary<int64_t, double>> ordered(new BTree<int64_t, double>());
+    UnqPtr<IDictionary<int64_t, double>> hashed(new HashTable<int64_t, double>());
+    UnqPtr<IDictionary<int64_t, double>> target(new BTree<int64_t, double>());
+    SparseVector<double, int64_t> a(length, std::move(ordered));
+    SparseVector<double, int64_t> b(length, std::move(hashed));
+    SparseVector<double, int64_t> result(length, std::move(target));
+    CompressedSparseVector<double, int64_t> compressedA(length), compressedB(length), compressedResult(length);
+
+    std::vector<int64_t> keys;
+    for (int64_t index = 1; index < length; index += stride)
+        keys.push_back(index);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        a.SetElement(keys[i], i % 7 + 1.0);
+        compressedA.SetElement(keys[i], i % 7 + 1.0);
+        if (i % 2 == 0) {
+            b.SetElement(keys[i], i % 3 + 1.0);
+            compressedB.SetElement(keys[i], i % 3 + 1.0);
+        }
+    }
+
+    double expectedDot = 0;
+    for (int64_t key : keys)
+        expectedDot += a.GetElement(key) * b.GetElement(key);
+    bool ok = a.GetLength() == length && Dot(a, b) == expectedDot && Dot(compressedA, compressedB) == expectedDot;
+
+    Add(a, b, result);
+    Add(compressedA, compressedB, compressedResult);
+    for (int64_t key : keys)
+        ok = ok && result.GetElement(key) == a.GetElement(key) + b.GetElement(key) &&
+             compressedResult.GetElement(key) == result.GetElement(key);
+
+    result = 2.0 * a - b;
+    for (int64_t key : keys)
+        ok = ok && result.GetElement(key) == 2.0 * a.GetElement(key) - b.GetElement(key);
+    ok = ok && result.GetElement(length - 1) == 0.0;
+
+    bool thrown = false;
+    try {
+        a.SetElement(length, 1.0);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+
+    // Ключ матрицы с 64-битными строками и столбцами.
+    HashTable<IndexPair64, double> hashedMatrix;
+    BTree<IndexPair64, double> orderedMatrix;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        IndexPair64 key(keys[i], keys[keys.size() - 1 - i]);
+        hashedMatrix.Add(key, static_cast<double>(i));
+        orderedMatrix.Add(key, static_cast<double>(i));
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        IndexPair64 key(keys[i], keys[keys.size() - 1 - i]);
+        ok = ok && hashedMatrix.Get(key) == static_cast<double>(i) && orderedMatrix.Get(key) == static_cast<double>(i);
+    }
+    ok = ok && !hashedMatrix.ContainsKey(IndexPair64(keys[0] + 1, keys[0]));
+
+    if (!ok || !thrown)
+        std::cerr << "Error: 64-bit SparseVector indices lost or misplaced elements." << std::endl;
+    else
+        std::cout << "64-bit SparseVector indices passed, " << keys.size() << " elements." << std::endl;
+}
+
+// Обмен с плотным буфером проверяется для всех сочетаний double/float и
+// int/int64_t; длины не кратны ширине регистров, чтобы пройти и хвостовой цикл.
+template <typename TVector, typename TElement, typename TIndex>
+bool check_dense_exchange(TVector& vector, TIndex length) {
+    std::vector<TElement> dense(length);
+    std::vector<TIndex> pattern;
+    for (TIndex index = 0; index < length; ++index) {
+        dense[index] = static_cast<TElement>(index % 5);
+        if (index % 3 != 2)
+            pattern.push_back(index);
+    }
+    vector.GatherFrom(dense.data(), pattern);
+    bool ok = true;
+    for (TIndex index = 0; index < length; ++index)
+        ok = ok && vector.GetElement(index) == (index % 3 != 2 ? dense[index] : TElement());
+    ok = ok && vector.GetNonZeroCount() == static_cast<size_t>(std::count_if(pattern.begin(), pattern.end(),
+            [&](TIndex index) { return dense[index] != TElement(); }));
+
+    std::vector<TElement> scattered(length, TElement(-1));
+    vector.ScatterTo(scattered.data());
+    std::vector<TElement> accumulated(dense);
+    vector.AccumulateInto(accumulated.data(), TElement(2));
+    for (TIndex index = 0; index < length; ++index) {
+        TElement value = vector.GetElement(index);
+        ok = ok && scattered[index] == (value != TElement() ? value : TElement(-1)) &&
+             accumulated[index] == dense[index] + TElement(2) * value;
+    }
+
+    bool thrown = false;
+    try {
+        vector.GatherFrom(dense.data(), std::vector<TIndex>{0, length});
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    return ok && thrown;
+}
+
+void test_dense_exchange() {
+    std::cout << "Testing sparse/dense gather and scatter (" << (ActiveSimdInstructionSet() ==
+            SimdInstructionSet::Avx512 ? "AVX-512" : ActiveSimdInstructionSet() == SimdInstructionSet::Avx2 ?
+            "AVX2" : "scalar") << ")..." << std::endl;
+    CompressedSparseVector<double> doubles(1003);
+    CompressedSparseVector<float> floats(1003);
+    CompressedSparseVector<double, int64_t> wideDoubles(1003);
+    CompressedSparseVector<float, int64_t> wideFloats(1003);
+    UnqPtr<IDictionary<int, double>> dictionary(new BTree<int, double>());
+    SparseVector<double> tree(1003, std::move(dictionary));
+    bool ok = check_dense_exchange<CompressedSparseVector<double>, double, int>(doubles, 1003) &&
+              check_dense_exchange<CompressedSparseVector<float>, float, int>(floats, 1003) &&
+              check_dense_exchange<CompressedSparseVector<double, int64_t>, double, int64_t>(wideDoubles, 1003) &&
+              check_dense_exchange<CompressedSparseVector<float, int64_t>, float, int64_t>(wideFloats, 1003) &&
+              check_dense_exchange<SparseVector<double>, double, int>(tree, 1003);
+
+    bool thrown = false;
+    std::vector<double> dense(1003, 1.0);
+    try {
+        doubles.GatherFrom(dense.data(), std::vector<int>{5, 3});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+
+    if (!ok || !thrown)
+        std::cerr << "Error: sparse/dense exchange kernels disagree with elementwise results." << std::endl;
+    else
+        std::cout << "Sparse/dense gather and scatter passed." << std::endl;
+}
+
+// Случайные вставки и удаления сверяются с std::map; плотный диапазон
+// проводит кусок через Array, Bitmap и обратно, RunOptimize - через Run.
+void test_roaring_dictionary() {
+    std::cout << "Testing RoaringDictionary..." << std::endl;
+    RoaringDictionary<double> dictionary;
+    std::map<int, double> reference;
+    std::mt19937 gen(23);
+    bool ok = true;
+
+    auto matches = [&]() {
+        if (dictionary.GetCount() != reference.size())
+            return false;
+        auto iterator = dictionary.GetIterator();
+        for (const auto& [key, value] : reference) {
+            if (!iterator->MoveNext() || iterator->GetCurrentKey() != key || iterator->GetCurrentValue() != value)
+                return false;
+        }
+        return !iterator->MoveNext();
+    };
+
+    for (int i = 0; i < 40000; ++i) {
+        int key = static_cast<int>(gen() % 400000) - 200000;
+        if (i % 5 == 0 && reference.count(key)) {
+            dictionary.Remove(key);
+            reference.erase(key);
+        } else {
+            dictionary.Add(key, i + 1.0);
+            reference[key] = i + 1.0;
+        }
+    }
+    // Кусок 1: 20000 ключей (Bitmap), затем прореживание до Array.
+    for (int key = 65536; key < 85536; ++key) {
+        dictionary.Add(key, key);
+        reference[key] = key;
+    }
+    ok = ok && matches();
+    for (int key = 65536; key < 85536; key += 2) {
+        dictionary.Remove(key);
+        reference.erase(key);
+    }
+    for (int key = 65537; key < 85536; key += 8) {
+        dictionary.Remove(key);
+        reference.erase(key);
+    }
+    ok = ok && matches();
+
+    // Длинные серии: RunOptimize уменьшает память, запись разворачивает контейнер.
+    for (int key = 1 << 20; key < (1 << 20) + 30000; ++key) {
+        dictionary.Add(key, 2.0);
+        reference[key] = 2.0;
+    }
+    size_t before = dictionary.GetMemoryBytes();
+    dictionary.RunOptimize();
+    ok = ok && dictionary.GetMemoryBytes() < before && matches();
+    for (int key = (1 << 20) + 5; key < (1 << 20) + 30000; key += 1000)
+        ok = ok && dictionary.Get(key) == 2.0;
+    dictionary.Add((1 << 20) + 40000, 3.0);
+    reference[(1 << 20) + 40000] = 3.0;
+    dictionary.Remove((1 << 20) + 100);
+    reference.erase((1 << 20) + 100);
+    dictionary[(1 << 20) + 101] = 4.0;
+    reference[(1 << 20) + 101] = 4.0;
+    ok = ok && matches();
+    dictionary.RunOptimize();
+
+    // Изменяемый обход: правка на месте, удаления в каждом виде контейнера и
+    // целый опустевший кусок 2 (ключи 131072..196607).
+    auto mutableIterator = dictionary.GetMutableIterator();
+    while (mutableIterator->MoveNext()) {
+        int key = mutableIterator->GetCurrentKey();
+        if (key % 3 == 0 || (key >= 131072 && key < 196608)) {
+            mutableIterator->RemoveCurrent();
+            reference.erase(key);
+        } else {
+            mutableIterator->GetCurrentValueRef() *= 2.0;
+            reference[key] *= 2.0;
+        }
+    }
+    mutableIterator.reset();
+    ok = ok && matches() && !dictionary.ContainsKey(131073) && !dictionary.ContainsKey((1 << 20) + 2);
+
+    // SkipTo с возрастающими целями совпадает с lower_bound, короткие шаги
+    // идут внутри контейнеров, длинные перескакивают через куски.
+    auto iterator = dictionary.GetIterator();
+    for (int walk = 0; ok && walk < 20; ++walk) {
+        iterator->Reset();
+        int target = static_cast<int>(gen() % 1000) - 200000;
+        while (ok) {
+            auto expected = reference.lower_bound(target);
+            bool moved = iterator->SkipTo(target);
+            ok = moved == (expected != reference.end()) &&
+                 (!moved || (iterator->GetCurrentKey() == expected->first &&
+                             iterator->GetCurrentValue() == expected->second));
+            if (!moved)
+                break;
+            target = iterator->GetCurrentKey() + 1 + static_cast<int>(gen() % (walk < 10 ? 50 : 200000));
+        }
+    }
+
+    RoaringDictionary<double> other;
+    std::map<int, double> otherReference;
+    for (int i = 0; i < 30000; ++i) {
+        int key = i % 3 == 0 ? static_cast<int>(gen() % 100000) + 60000 : static_cast<int>(gen() % 2000000) - 200000;
+        other.Add(key, 0.5 * i);
+        otherReference[key] = 0.5 * i;
+    }
+    for (int key = 70000; key < 80000; ++key) {
+        other.Add(key, 1.5);
+        otherReference[key] = 1.5;
+    }
+    double expected = 0;
+    size_t expectedCommon = 0;
+    for (const auto& [key, value] : reference) {
+        auto found = otherReference.find(key);
+        if (found != otherReference.end()) {
+            expected += value * found->second;
+            ++expectedCommon;
+        }
+    }
+    double product = 0;
+    size_t common = 0;
+    int previous = INT_MIN;
+    bool ordered = true;
+    RoaringDictionary<double>::Intersect(dictionary, other, [&](int key, const double& x, const double& y) {
+        ordered = ordered && (common == 0 || key > previous);
+        previous = key;
+        product += x * y;
+        ++common;
+    });
+    ok = ok && ordered && common == expectedCommon && product == expected;
+
+    // Тот же результат через SparseVector: слияние со SkipTo и проверка по HashTable.
+    const int length = 1 << 21;
+    UnqPtr<IDictionary<int, double>> left(new RoaringDictionary<double>());
+    UnqPtr<IDictionary<int, double>> right(new RoaringDictionary<double>());
+    UnqPtr<IDictionary<int, double>> hashed(new HashTable<int, double>());
+    SparseVector<double> a(length, std::move(left));
+    SparseVector<double> b(length, std::move(right));
+    SparseVector<double> h(length, std::move(hashed));
+    for (const auto& [key, value] : reference)
+        if (key >= 0 && key < length)
+            a.SetElement(key, value);
+    for (const auto& [key, value] : otherReference) {
+        if (key >= 0 && key < length) {
+            b.SetElement(key, value);
+            h.SetElement(key, value);
+        }
+    }
+    ok = ok && Dot(a, b) == Dot(a, h) && Dot(b, a) == Dot(h, a);
+
+    if (!ok)
+        std::cerr << "Error: RoaringDictionary disagrees with std::map." << std::endl;
+    else
+        std::cout << "RoaringDictionary passed with " << reference.size() << " keys, " << common
+                  << " shared with the second set." << std::endl;
+}
+
+void test_concurrent_btree_stress() {
+    std::cout << "Stress testing ConcurrentBTree..." << std::endl;
+    const int threads = std::max(2u, std::thread::hardware_concurrency());
+    const int keysPerThread = 20000;
+    ConcurrentBTree<int, long long> tree(8);
+    std::atomic<bool> failed(false);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 gen(t);
+            for (int i = 0; i < keysPerThread; ++i) {
+                int key = i * threads + t;
+                tree.Add(key, static_cast<long long>(key) * 3);
+
+                int probe = static_cast<int>(gen() % (keysPerThread * threads));
+                long long value = 0;
+                if (tree.TryGet(probe, value) && value != static_cast<long long>(probe) * 3)
+                    failed = true;
+
+                if (i % 4 == 3 && !tree.Erase(key - 3 * threads))
+                    failed = true;
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    size_t expected = 0;
+    for (int key = 0; key < keysPerThread * threads; ++key) {
+        bool removed = (key / threads) % 4 == 0 && key / threads < keysPerThread - 3;
+        if (tree.ContainsKey(key) == removed)
+            failed = true;
+        if (!removed)
+            ++expected;
+    }
+
+    size_t iterated = 0;
+    int previous = -1;
+    auto iterator = tree.GetIterator();
+    while (iterator->MoveNext()) {
+        if (iterator->GetCurrentKey() <= previous)
+            failed = true;
+        previous = iterator->GetCurrentKey();
+        ++iterated;
+    }
+
+    if (failed || tree.GetCount() != expected || iterated != expected) {
+        std::cerr << "Error: ConcurrentBTree stress test failed (count " << tree.GetCount()
+                  << ", iterated " << iterated << ", expected " << expected << ")." << std::endl;
+    } else {
+        std::cout << "ConcurrentBTree stress test passed with " << threads << " threads." << std::endl;
+    }
+}
+
+// Производители вставляют возрастающие индексы, потребители параллельно
+// сканируют диапазоны и проверяют порядок и значения.
+void test_concurrent_skip_list_stress() {
+    std::cout << "Stress testing ConcurrentSkipList..." << std::endl;
+    const int producers = std::max(2u, std::thread::hardware_concurrency());
+    const int consumers = 2;
+    const int keysPerThread = 20000;
+    ConcurrentSkipList<int, long long> list;
+    std::atomic<bool> failed(false);
+    std::atomic<int> finished(0);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < producers; ++t) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < keysPerThread; ++i) {
+                int key = i * producers + t;
+                list.Add(key, static_cast<long long>(key) * 2);
+                if (i % 4 == 3 && !list.Erase(key - 3 * producers))
+                    failed = true;
+            }
+            ++finished;
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        workers.emplace_back([&, c]() {
+            std::mt19937 gen(c);
+            while (finished.load() < producers) {
+                int low = static_cast<int>(gen() % (keysPerThread * producers));
+                int previous = low - 1;
+                list.ForEachInRange(low, low + 1000, [&](int key, long long value) {
+                    if (key <= previous || value != static_cast<long long>(key) * 2)
+                        failed = true;
+                    previous = key;
+                });
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    size_t expected = 0;
+    for (int key = 0; key < keysPerThread * producers; ++key) {
+        bool removed = (key / producers) % 4 == 0 && key / producers < keysPerThread - 3;
+        if (list.ContainsKey(key) == removed)
+            failed = true;
+        if (!removed)
+            ++expected;
+    }
+
+    size_t iterated = 0;
+    int previous = -1;
+    auto iterator = list.GetIterator();
+    while (iterator->MoveNext()) {
+        if (iterator->GetCurrentKey() <= previous)
+            failed = true;
+        previous = iterator->GetCurrentKey();
+        ++iterated;
+    }
+
+    if (failed || list.GetCount() != expected || iterated != expected) {
+        std::cerr << "Error: ConcurrentSkipList stress test failed (count " << list.GetCount()
+                  << ", iterated " << iterated << ", expected " << expected << ")." << std::endl;
+    } else {
+        std::cout << "ConcurrentSkipList stress test passed with " << producers << " producers and "
+                  << consumers << " consumers." << std::endl;
+    }
+}
+
+void test_btree_snapshot() {
+    std::cout << "Testing BTree snapshots..." << std::endl;
+    BTree<int, double> tree;
+    for (int key = 0; key < 10000; ++key)
+        tree.Add(key, 1.0);
+
+    auto snapshot = tree.Snapshot();
+
+    double snapshotSum = 0;
+    std::thread reader([&]() {
+        auto iterator = snapshot->GetIterator();
+        while (iterator->MoveNext())
+            snapshotSum += iterator->GetCurrentValue();
+    });
+
+    for (int key = 0; key < 10000; key += 2)
+        tree.Remove(key);
+    for (int key = 10000; key < 20000; ++key)
+        tree.Add(key, 2.0);
+    tree[1] = 5.0;
+    reader.join();
+
+    if (snapshotSum != 10000.0 || snapshot->GetCount() != 10000 || snapshot->Get(0) != 1.0 ||
+        snapshot->Get(1) != 1.0 || snapshot->ContainsKey(10000)) {
+        std::cerr << "Error: BTree snapshot was modified by later updates." << std::endl;
+    } else if (tree.GetCount() != 15000 || tree.ContainsKey(0) || tree.Get(1) != 5.0) {
+        std::cerr << "Error: BTree lost updates made after a snapshot." << std::endl;
+    } else {
+        std::cout << "BTree snapshot stayed consistent during ingestion." << std::endl;
+    }
+}
+
+void test_btree_order_statistics() {
+    std::cout << "Testing BTree order statistics..." << std::endl;
+    BTree<IndexPair, double, 0, true> tree(4);
+    for (int row = 0; row < 100; ++row) {
+        for (int column = row % 3; column < 100; column += 3)
+            tree.Add(IndexPair(row, column), row + column);
+    }
+    for (int row = 0; row < 100; row += 2)
+        tree.Remove(IndexPair(row, row % 3));
+
+    // Строки 10..19: в каждой 33 или 34 ненулевых, в чётных строках один удалён.
+    size_t expectedBand = 0;
+    for (int row = 10; row < 20; ++row)
+        expectedBand += (100 - row % 3 + 2) / 3 - (row % 2 == 0 ? 1 : 0);
+    size_t band = tree.CountInRange(IndexPair(10, 0), IndexPair(19, 99));
+
+    bool ok = band == expectedBand;
+    for (size_t k = 0; ok && k < tree.GetCount(); k += 97)
+        ok = tree.Rank(tree.Select(k)) == k;
+    IndexPair median = tree.Select(tree.GetCount() / 2);
+    ok = ok && tree.Rank(median) == tree.GetCount() / 2 && tree.CountInRange(IndexPair(99, 99), IndexPair(0, 0)) == 0;
+
+    if (!ok)
+        std::cerr << "Error: BTree order statistics are inconsistent (band " << band << ", expected "
+                  << expectedBand << ")." << std::endl;
+    else
+        std::cout << "BTree order statistics passed, median key " << median << "." << std::endl;
+}
+
+void test_btree_upsert_erase() {
+    std::cout << "Testing BTree Upsert and Erase results..." << std::endl;
+    BTree<int, double> tree(2);
+    bool ok = tree.Upsert(7, 1.0) == BTreeUpdateResult::Inserted;
+    ok = ok && tree.Upsert(7, 2.0) == BTreeUpdateResult::Updated && tree.Get(7) == 2.0;
+    ok = ok && tree.Erase(7) == BTreeUpdateResult::Removed && !tree.ContainsKey(7);
+    ok = ok && tree.Erase(7) == BTreeUpdateResult::Absent && tree.Erase(42) == BTreeUpdateResult::Absent;
+    ok = ok && tree.GetCount() == 0;
+
+    // При порядке 2 корень полон уже на трёх ключах; operator[] с новым ключом
+    // должен расщепить его, а не бросить исключение.
+    for (int key = 1; key <= 3; ++key)
+        tree.Add(key, key * 1.0);
+    try {
+        tree[4] = 4.0;
+        tree[0] += 5.0;
+        tree[2] *= 10.0;
+    } catch (const std::exception &) {
+        ok = false;
+    }
+    ok = ok && tree.GetCount() == 5 && tree.Get(4) == 4.0 && tree.Get(0) == 5.0 && tree.Get(2) == 20.0;
+
+    // Случайные Upsert и Erase против std::map проходят пути слияния и заимствования.
+    std::map<int, double> reference{{0, 5.0}, {1, 1.0}, {2, 20.0}, {3, 3.0}, {4, 4.0}};
+    std::mt19937 gen(30);
+    for (int i = 0; ok && i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 2000);
+        if (gen() % 2) {
+            BTreeUpdateResult expected = reference.count(key) ? BTreeUpdateResult::Updated : BTreeUpdateResult::Inserted;
+            ok = tree.Upsert(key, i) == expected;
+            reference[key] = i;
+        } else {
+            BTreeUpdateResult expected = reference.erase(key) ? BTreeUpdateResult::Removed : BTreeUpdateResult::Absent;
+            ok = tree.Erase(key) == expected;
+        }
+    }
+    ok = ok && tree.GetCount() == reference.size();
+    auto iterator = tree.GetIterator();
+    for (const auto& [key, value] : reference)
+        ok = ok && iterator->MoveNext() && iterator->GetCurrentKey() == key && iterator->GetCurrentValue() == value;
+    ok = ok && !iterator->MoveNext();
+
+    if (!ok)
+        std::cerr << "Error: BTree Upsert/Erase reported wrong results." << std::endl;
+    else
+        std::cout << "BTree Upsert and Erase passed." << std::endl;
+}
+
+void test_bepsilon_tree_count() {
+    std::cout << "Testing BEpsilonTree count..." << std::endl;
+    // Маленькие узлы и буферы, чтобы сообщения доходили до листьев пакетами
+    // через несколько уровней.
+    BEpsilonTree<int, double> tree(4, 8, 4);
+    std::map<int, double> reference;
+    std::mt19937 gen(33);
+    bool ok = true;
+    for (int i = 0; ok && i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 1500);
+        switch (gen() % 4) {
+            case 0:
+            case 1:
+                tree.Add(key, i);
+                reference[key] = i;
+                break;
+            case 2:
+                // Erase отсутствующего ключа не должен менять число.
+                tree.Erase(key);
+                reference.erase(key);
+                break;
+            default:
+                tree[key] += 1.0;
+                reference[key] += 1.0;
+                break;
+        }
+        if (i % 97 == 0)
+            ok = tree.GetCount() == reference.size();
+    }
+    ok = ok && tree.GetCount() == reference.size();
+    auto iterator = tree.GetIterator();
+    for (const auto& [key, value] : reference)
+        ok = ok && iterator->MoveNext() && iterator->GetCurrentKey() == key && iterator->GetCurrentValue() == value;
+    ok = ok && !iterator->MoveNext();
+
+    // После одной записи GetCount сбрасывает только её путь, а не всё дерево.
+    BEpsilonTree<int, double> large;
+    for (int key = 0; key < 200000; ++key)
+        large.Add(key, key);
+    ok = ok && large.GetCount() == 200000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; ++i) {
+        large.Add(200000 + i, i);
+        ok = ok && large.GetCount() == static_cast<size_t>(200001 + i);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ok = ok && elapsed < 1.0;
+
+    if (!ok)
+        std::cerr << "Error: BEpsilonTree count differs from the reference." << std::endl;
+    else
+        std::cout << "BEpsilonTree count passed (" << elapsed * 1000 << " ms for 2000 writes)." << std::endl;
+}
+
+void test_adaptive_radix_tree_layouts() {
+    std::cout << "Testing AdaptiveRadixTree node layouts..." << std::endl;
+    // У всех ключей общие старшие шесть байт, поэтому корень - один узел со
+    // сжатым путём, ветвящийся по седьмому байту. Под каждым его ребёнком
+    // Node4 с двумя листами (младший байт 1 и 2).
+    const int base = 0x12340000;
+    AdaptiveRadixTree<int, double> tree;
+    std::map<int, double> reference;
+    auto matches = [&]() {
+        if (tree.GetCount() != reference.size())
+            return false;
+        auto iterator = tree.GetIterator();
+        for (const auto& [key, value] : reference)
+            if (!iterator->MoveNext() || iterator->GetCurrentKey() != key || iterator->GetCurrentValue() != value)
+                return false;
+        return !iterator->MoveNext();
+    };
+
+    std::vector<int> order;
+    for (int b = 0; b < 256; ++b)
+        order.push_back(b);
+    std::mt19937 gen(37);
+    std::shuffle(order.begin(), order.end(), gen);
+
+    // Заполнение: корень проходит Node4 -> Node16 -> Node48 -> Node256
+    // (5-й, 17-й и 49-й ребёнок); проверка после каждого ребёнка.
+    bool ok = true;
+    for (int b : order) {
+        for (int low = 1; low <= 2; ++low) {
+            int key = base | (b << 8) | low;
+            tree.Add(key, key * 0.5);
+            reference[key] = key * 0.5;
+        }
+        ok = ok && matches();
+    }
+
+    // Опустошение: у каждого ребёнка сначала удаляется один лист (Node4 под
+    // ним схлопывается в лист), потом второй. Корень сжимается на 37, 12 и
+    // 3 детях; последний ребёнок остаётся внутренним узлом.
+    for (size_t i = 0; ok && i + 1 < order.size(); ++i) {
+        for (int low = 1; low <= 2; ++low) {
+            int key = base | (order[i] << 8) | low;
+            tree.Remove(key);
+            reference.erase(key);
+            ok = ok && matches();
+        }
+    }
+
+    // У корня-Node4 остался один внутренний ребёнок: узлы слились, и
+    // префикс нового корня склеен из обоих путей и байта ветвления.
+    int last = order.back();
+    ok = ok && tree.ContainsKey(base | (last << 8) | 1) && tree.ContainsKey(base | (last << 8) | 2);
+    ok = ok && !tree.ContainsKey(base | (last << 8)) && !tree.ContainsKey(base | (((last + 1) & 0xFF) << 8) | 1);
+    ok = ok && tree.Get(base | (last << 8) | 2) == (base | (last << 8) | 2) * 0.5;
+
+    // Ключ, расходящийся внутри склеенного префикса, снова разрезает путь.
+    for (int key : {base | (((last + 1) & 0xFF) << 8) | 1, base ^ 0x10000, base | (last << 8) | 3}) {
+        tree[key] = 1.0;
+        reference[key] = 1.0;
+        ok = ok && matches();
+    }
+    while (ok && !reference.empty()) {
+        int key = reference.begin()->first;
+        tree.Remove(key);
+        reference.erase(key);
+        ok = !tree.ContainsKey(key) && matches();
+    }
+    ok = ok && tree.GetCount() == 0;
+
+    if (!ok)
+        std::cerr << "Error: AdaptiveRadixTree lost order or count across node layouts." << std::endl;
+    else
+        std::cout << "AdaptiveRadixTree node layouts passed." << std::endl;
+}
+
+void test_btree_set_operations() {
+    std::cout << "Testing BTree merge, intersection and difference..." << std::endl;
+    BTree<int, double> a, b;
+    for (int key = 0; key < 3000; key += 2)
+        a.Add(key, 1.0);
+    for (int key = 0; key < 3000; key += 3)
+        b.Add(key, 2.0);
+
+    auto sum = [](double x, double y) { return x + y; };
+    auto merged = Merge(a, b, sum);
+    auto common = Intersect(a, b, sum);
+    auto onlyA = Difference(a, b);
+    auto parallel = ParallelMerge(a, b, sum, 4);
+
+    // Кратные 2: 1500, кратные 3: 1000, кратные 6: 500.
+    bool ok = merged->GetCount() == 2000 && common->GetCount() == 500 && onlyA->GetCount() == 1000 &&
+              parallel->GetCount() == 2000 && merged->Get(6) == 3.0 && merged->Get(3) == 2.0 &&
+              common->Get(12) == 3.0 && !onlyA->ContainsKey(6) && onlyA->Get(4) == 1.0;
+
+    auto expected = merged->GetIterator();
+    auto actual = parallel->GetIterator();
+    while (ok && expected->MoveNext())
+        ok = actual->MoveNext() && actual->GetCurrentKey() == expected->GetCurrentKey() &&
+             actual->GetCurrentValue() == expected->GetCurrentValue();
+
+    // SkipTo даёт первый ключ >= цели после текущего: короткие шаги идут
+    // внутри листа, длинные - спуском от корня.
+    auto skipping = a.GetIterator();
+    for (int step : {1, 3, 40, 700}) {
+        skipping->Reset();
+        int previous = -1;
+        for (int target = -5; ok; target += step) {
+            int from = std::max(target, previous + 1);
+            int expectedKey = from + from % 2;
+            bool moved = skipping->SkipTo(target);
+            ok = moved == (expectedKey < 3000) && (!moved || skipping->GetCurrentKey() == expectedKey);
+            if (!moved)
+                break;
+            previous = expectedKey;
+        }
+        ok = ok && !skipping->SkipTo(0) && !skipping->MoveNext();
+    }
+
+    merged->Add(3001, 1.0);
+    merged->Remove(0);
+    ok = ok && merged->GetCount() == 2000 && merged->ContainsKey(3001);
+
+    if (!ok)
+        std::cerr << "Error: BTree set operations returned wrong results." << std::endl;
+    else
+        std::cout << "BTree set operations passed." << std::endl;
+}
+
+void test_btree_metrics() {
+    std::cout << "Collecting BTree metrics after heavy removal..." << std::endl;
+    BTree<int, double> tree(4);
+    for (int key = 0; key < 20000; ++key)
+        tree.Add(key, 1.0);
+    BTreeMetrics filled = tree.GetMetrics();
+    for (int key = 0; key < 20000; ++key) {
+        if (key % 10 != 0)
+            tree.Remove(key);
+    }
+    BTreeMetrics sparse = tree.GetMetrics();
+
+    size_t levelTotal = 0;
+    for (size_t nodes : sparse.nodesPerLevel)
+        levelTotal += nodes;
+
+    // CSV пишется в память: заголовок, 13 общих строк и по строке на уровень.
+    std::ostringstream csv;
+    sparse.WriteCsv(csv);
+    std::istringstream lines(csv.str());
+    std::string header;
+    std::getline(lines, header);
+    size_t rows = 0;
+    for (std::string line; std::getline(lines, line);)
+        ++rows;
+
+    if (header != "metric,value" || rows != 13 + sparse.nodesPerLevel.size() ||
+        csv.str().find("entry_count,2000\n") == std::string::npos || filled.entryCount != 20000 || sparse.entryCount != 2000 || levelTotal != sparse.nodeCount ||
+        sparse.height > filled.height || sparse.merges == 0 || filled.splits == 0 ||
+        sparse.fillFactor <= 0.0 || sparse.fillFactor > 1.0) {
+        std::cerr << "Error: BTree metrics are inconsistent." << std::endl;
+    } else {
+        std::cout << "BTree metrics: height " << filled.height << " -> " << sparse.height << ", fill "
+                  << filled.fillFactor << " -> " << sparse.fillFactor << ", bytes/entry " << filled.bytesPerEntry
+                  << " -> " << sparse.bytesPerEntry << ", comparisons/lookup " << sparse.comparisonsPerLookup
+                  << std::endl;
+    }
+}
+
+void test_learned_index() {
+    std::cout << "Testing LearnedIndex over dense and sparse index ranges..." << std::endl;
+    HashTable<int, double> source;
+    for (int index = 0; index < 50000; ++index)
+        source.Add(index, index * 0.5);
+    std::mt19937 gen(7);
+    for (int i = 0; i < 50000; ++i) {
+        int index = 100000 + static_cast<int>(gen() % 100000000);
+        source.Add(index, index * 0.5);
+    }
+
+    LearnedIndex<double> index(source, 16);
+    bool ok = index.GetCount() == source.GetCount();
+    auto iterator = source.GetIterator();
+    while (ok && iterator->MoveNext())
+        ok = index.Get(iterator->GetCurrentKey()) == iterator->GetCurrentValue();
+    for (int i = 0; ok && i < 100000; ++i) {
+        int probe = static_cast<int>(gen() % 200000000) - 1000;
+        ok = index.ContainsKey(probe) == source.ContainsKey(probe);
+    }
+
+    int previous = -1;
+    auto ordered = index.GetIterator();
+    while (ok && ordered->MoveNext()) {
+        ok = ordered->GetCurrentKey() > previous;
+        previous = ordered->GetCurrentKey();
+    }
+
+    bool readOnly = false;
+    try {
+        index.Add(-5, 1.0);
+    } catch (const std::runtime_error &) {
+        readOnly = true;
+    }
+
+    if (!ok || !readOnly)
+        std::cerr << "Error: LearnedIndex lookups disagree with the source dictionary." << std::endl;
+    else
+        std::cout << "LearnedIndex passed with " << index.GetSegmentCount() << " segments, "
+                  << index.GetIndexBytes() << " bytes of model." << std::endl;
+}
+
+void test_eytzinger_dictionary() {
+    std::cout << "Testing EytzingerDictionary..." << std::endl;
+    BTree<int, double> source;
+    for (int key = 0; key < 3000; key += 3)
+        source.Add(key, key * 2.0);
+
+    EytzingerDictionary<int, double> dictionary(source);
+    bool ok = dictionary.GetCount() == source.GetCount();
+    for (int key = -1; ok && key <= 3001; ++key)
+        ok = dictionary.ContainsKey(key) == source.ContainsKey(key) &&
+             (!dictionary.ContainsKey(key) || dictionary.Get(key) == key * 2.0);
+
+    // LowerBound(1000) начинается с 1002 и проходит оставшиеся ключи по порядку.
+    auto range = dictionary.LowerBound(1000);
+    int expected = 1002;
+    while (ok && range->MoveNext()) {
+        ok = range->GetCurrentKey() == expected;
+        expected += 3;
+    }
+    ok = ok && expected == 3000 && !dictionary.LowerBound(2998)->MoveNext();
+
+    if (!ok)
+        std::cerr << "Error: EytzingerDictionary disagrees with the source BTree." << std::endl;
+    else
+        std::cout << "EytzingerDictionary lookups and ordered scans passed." << std::endl;
+}
+
+void test_paged_btree() {
+    std::cout << "Testing PagedBTree with a small buffer pool..." << std::endl;
+    const std::string path = "paged_btree_test.db";
+    const int keys = 50000;
+    std::remove(path.c_str());
+    bool failed = false;
+
+    {
+        PagedBTree<int, double> tree(path, 8);
+        for (int i = 0; i < keys; ++i) {
+            int key = (i * 7919) % keys;
+            tree.Add(key, key * 0.5);
+        }
+        for (int key = 0; key < keys; key += 3)
+            tree.Remove(key);
+        tree[1] = -1.0;
+
+        int rangeCount = 0;
+        tree.ForEachInRange(100, 200, [&](int, double) {
+            ++rangeCount;
+        });
+        if (rangeCount != 67)
+            failed = true;
+        std::cout << "Buffer pool hits: " << tree.GetBufferPool().GetHits()
+                  << ", misses: " << tree.GetBufferPool().GetMisses() << std::endl;
+    }
+
+    {
+        PagedBTree<int, double> reopened(path, 8);
+        size_t expected = keys - (keys + 2) / 3;
+        if (reopened.GetCount() != expected || reopened.Get(1) != -1.0 || reopened.ContainsKey(3))
+            failed = true;
+        for (int key = 2; key < keys; key += 3) {
+            if (reopened.Get(key) != key * 0.5)
+                failed = true;
+        }
+
+        size_t iterated = 0;
+        int previous = -1;
+        auto iterator = reopened.GetIterator();
+        while (iterator->MoveNext()) {
+            if (iterator->GetCurrentKey() <= previous)
+                failed = true;
+            previous = iterator->GetCurrentKey();
+            ++iterated;
+        }
+        if (iterated != expected)
+            failed = true;
+    }
+
+    {
+        // Файл, укороченный во время работы, должен давать ошибку ввода-вывода, а не страницы из нулей.
+        PagedBTree<int, double> truncated(path, 8);
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+        bool thrown = false;
+        try {
+            for (int key = 2; key < keys; key += 3)
+                truncated.Get(key);
+        } catch (const std::runtime_error &error) {
+            thrown = std::string(error.what()) == BUFFERPOOL_IO_ERROR;
+        }
+        if (!thrown)
+            failed = true;
+    }
+    std::remove(path.c_str());
+
+    if (failed) {
+        std::cerr << "Error: PagedBTree returned wrong data." << std::endl;
+    } else {
+        std::cout << "PagedBTree survived eviction and reopening." << std::endl;
+    }
+}
+
 template<typename Func>
 long long measure_time(Func func) {
     auto start = std::chrono::high_resolution_clock::now();
@@ -174,6 +1503,34 @@ void performance_test_vector(int size, const std::string& dict_name, std::ostrea
                << insertion_time << "," << search_time << "\n";
 }
 
+void performance_test_compressed_vector(int size, std::ostream& log_stream) {
+    CompressedSparseVector<double> vector(size);
+
+    std::unordered_set<int> indices;
+    std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<> dis(0, size - 1);
+
+    while (indices.size() < static_cast<size_t>(size / 10)) {
+        indices.insert(dis(gen));
+    }
+
+    long long insertion_time = measure_time([&]() {
+        for (int idx : indices) {
+            vector.SetElement(idx, static_cast<double>(std::rand()) / RAND_MAX);
+        }
+        vector.Compact();
+    });
+
+    long long search_time = measure_time([&]() {
+        for (int idx : indices) {
+            vector.GetElement(idx);
+        }
+    });
+
+    log_stream << "CompressedSparseVector,Vector," << size << "," << indices.size() << ","
+               << insertion_time << "," << search_time << "\n";
+}
+
 template<typename TDictionary>
 void performance_test_matrix(int size, const std::string& dict_name, std::ostream& log_stream) {
     int rows = std::max(1, size);
@@ -244,6 +1601,626 @@ void performance_test_matrix(int size, const std::string& dict_name, std::ostrea
                << reduce_time << "," << update_time << "," << iteration_time << "\n";
 }
 
+// YCSB-подобная нагрузка: 95% чтений и 5% обновлений по равномерным ключам.
+void performance_test_concurrent_btree(int keyCount, int operations) {
+    ConcurrentBTree<int, double> tree(16);
+    for (int key = 0; key < keyCount; ++key)
+        tree.Add(key, key * 0.5);
+
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        long long elapsed = measure_time([&]() {
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t]() {
+                    std::mt19937 gen(t);
+                    std::uniform_int_distribution<> key_dist(0, keyCount - 1);
+                    double sink = 0;
+                    for (int i = 0; i < operations / threads; ++i) {
+                        int key = key_dist(gen);
+                        if (i % 20 == 0) {
+                            tree.Add(key, sink);
+                        } else {
+                            double value = 0;
+                            tree.TryGet(key, value);
+                            sink += value;
+                        }
+                    }
+                });
+            }
+            for (auto &worker : workers)
+                worker.join();
+        });
+        std::cout << "ConcurrentBTree YCSB-B, " << threads << " threads: "
+                  << (elapsed > 0 ? operations * 1000LL / elapsed : 0) << " ops/s" << std::endl;
+    }
+}
+
+// Параллельная вставка возрастающих индексов несколькими производителями.
+void performance_test_concurrent_skip_list(int keyCount) {
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        ConcurrentSkipList<int, double> list;
+        ConcurrentBTree<int, double> tree(16);
+        auto ingest = [&](auto &dictionary) {
+            return measure_time([&]() {
+                std::vector<std::thread> workers;
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&, t]() {
+                        for (int key = t; key < keyCount; key += threads)
+                            dictionary.Add(key, key * 0.5);
+                    });
+                }
+                for (auto &worker : workers)
+                    worker.join();
+            });
+        };
+        long long listTime = ingest(list);
+        long long treeTime = ingest(tree);
+        std::cout << "Sorted ingest of " << keyCount << " keys, " << threads << " threads: ConcurrentSkipList "
+                  << listTime << " ms, ConcurrentBTree " << treeTime << " ms" << std::endl;
+    }
+}
+
+// Поиск в замороженном векторе: обученный индекс против BTree и HashTable.
+void performance_test_learned_index(int num_keys) {
+    std::mt19937 gen(11);
+    BTree<int, double> tree;
+    HashTable<int, double> table;
+    for (int i = 0; i < num_keys; ++i) {
+        int key = i % 2 == 0 ? i : static_cast<int>(gen() % 1000000000);
+        tree.Add(key, 1.0);
+        table.Add(key, 1.0);
+    }
+    LearnedIndex<double> index(tree, 32);
+
+    std::vector<int> probes;
+    auto iterator = tree.GetIterator();
+    while (iterator->MoveNext())
+        probes.push_back(iterator->GetCurrentKey());
+    std::shuffle(probes.begin(), probes.end(), gen);
+
+    auto lookups = [&](const IDictionary<int, double> &dictionary) {
+        return measure_time([&]() {
+            double sum = 0;
+            for (int key : probes)
+                sum += dictionary.Get(key);
+            volatile double sink = sum;
+            (void)sink;
+        });
+    };
+    long long indexTime = lookups(index);
+    long long treeTime = lookups(tree);
+    long long tableTime = lookups(table);
+
+    BTreeMetrics metrics = tree.GetMetrics();
+    std::cout << "Frozen lookups over " << probes.size() << " keys: LearnedIndex " << indexTime << " ms, BTree "
+              << treeTime << " ms, HashTable " << tableTime << " ms" << std::endl;
+    std::cout << "  LearnedIndex model: " << index.GetSegmentCount() << " segments, " << index.GetIndexBytes()
+              << " bytes; BTree: " << static_cast<size_t>(metrics.bytesPerEntry * metrics.entryCount) << " bytes"
+              << std::endl;
+}
+
+template<int Order>
+long long performance_test_btree_lookups(const std::vector<int>& keys, const std::vector<int>& probes) {
+    BTree<int, double, Order> tree;
+    for (int key : keys)
+        tree.Add(key, 1.0);
+    return measure_time([&]() {
+        double sum = 0;
+        for (int key : probes)
+            sum += tree.Get(key);
+        volatile double sink = sum;
+        (void)sink;
+    });
+}
+
+// Поиск в статической раскладке Эйтцингера против BTree разных порядков.
+void performance_test_eytzinger(int num_keys) {
+    std::mt19937 gen(13);
+    std::vector<int> keys(num_keys);
+    for (int &key : keys)
+        key = static_cast<int>(gen() % 1000000000);
+    std::vector<int> probes(keys);
+    std::shuffle(probes.begin(), probes.end(), gen);
+
+    BTree<int, double, 16> source;
+    for (int key : keys)
+        source.Add(key, 1.0);
+    EytzingerDictionary<int, double> dictionary(source);
+    long long eytzingerTime = measure_time([&]() {
+        double sum = 0;
+        for (int key : probes)
+            sum += dictionary.Get(key);
+        volatile double sink = sum;
+        (void)sink;
+    });
+
+    std::cout << "Static lookups over " << num_keys << " keys: EytzingerDictionary " << eytzingerTime << " ms, BTree order 3 "
+              << performance_test_btree_lookups<3>(keys, probes) << " ms, order 16 "
+              << performance_test_btree_lookups<16>(keys, probes) << " ms, order 64 "
+              << performance_test_btree_lookups<64>(keys, probes) << " ms" << std::endl;
+}
+
+// Скалярное произведение ядрами против цикла GetElement по всей длине.
+void performance_test_sparse_vector_ops(int length) {
+    UnqPtr<IDictionary<int, double>> leftDictionary(new BTree<int, double>());
+    UnqPtr<IDictionary<int, double>> rightDictionary(new BTree<int, double>());
+    SparseVector<double> a(length, std::move(leftDictionary));
+    SparseVector<double> b(length, std::move(rightDictionary));
+    CompressedSparseVector<double> compressedA(length), compressedB(length);
+    std::mt19937 gen(19);
+    for (int i = 0; i < length / 100; ++i) {
+        int index = static_cast<int>(gen() % length);
+        a.SetElement(index, 1.0);
+        compressedA.SetElement(index, 1.0);
+        index = static_cast<int>(gen() % length);
+        b.SetElement(index, 2.0);
+        compressedB.SetElement(index, 2.0);
+    }
+
+    double naive = 0;
+    long long naiveTime = measure_time([&]() {
+        for (int index = 0; index < length; ++index)
+            naive += a.GetElement(index) * b.GetElement(index);
+    });
+    double merged = 0;
+    long long mergeTime = measure_time([&]() { merged = Dot(a, b); });
+    double compressed = 0;
+    long long compressedTime = measure_time([&]() { compressed = Dot(compressedA, compressedB); });
+
+    std::cout << "Dot product over length " << length << " (" << a.GetNonZeroCount() << " nonzeros): GetElement loop "
+              << naiveTime << " ms, BTree merge-join " << mergeTime << " ms, CompressedSparseVector "
+              << compressedTime << " ms" << (naive == merged && merged == compressed ? "" : " (MISMATCH)")
+              << std::endl;
+}
+
+// Память и случайное чтение при разной плотности: словарь, сжатый вектор и
+// адаптивный вектор, выбирающий форму сам.
+void performance_test_adaptive_vector(int length) {
+    const char *names[] = {"Sparse", "Bitmap", "Dense"};
+    for (double density : {0.001, 0.01, 0.1, 0.4, 0.9}) {
+        UnqPtr<IDictionary<int, double>> dictionary(new HashTable<int, double>());
+        SparseVector<double> hashed(length, std::move(dictionary));
+        CompressedSparseVector<double> compressed(length);
+        AdaptiveSparseVector<double> adaptive(length);
+        std::mt19937 gen(7);
+        std::bernoulli_distribution present(density);
+        for (int index = 0; index < length; ++index) {
+            if (present(gen)) {
+                hashed.SetElement(index, 1.0);
+                compressed.SetElement(index, 1.0);
+                adaptive.SetElement(index, 1.0);
+            }
+        }
+
+        std::vector<int> probes(1000000);
+        for (int &probe : probes)
+            probe = static_cast<int>(gen() % length);
+        double sums[3] = {0, 0, 0};
+        long long hashedTime = measure_time([&]() { for (int probe : probes) sums[0] += hashed.GetElement(probe); });
+        long long compressedTime = measure_time([&]() { for (int probe : probes) sums[1] += compressed.GetElement(probe); });
+        long long adaptiveTime = measure_time([&]() { for (int probe : probes) sums[2] += adaptive.GetElement(probe); });
+
+        std::cout << "Density " << density << " (" << adaptive.GetNonZeroCount() << " nonzeros): 1M random reads "
+                  << "HashTable " << hashedTime << " ms, CompressedSparseVector " << compressedTime << " ms ("
+                  << compressed.GetNonZeroCount() * (sizeof(int) + sizeof(double)) << " bytes), Adaptive/"
+                  << names[static_cast<int>(adaptive.GetRepresentation())] << " " << adaptiveTime << " ms ("
+                  << adaptive.GetMemoryBytes() << " bytes, dense " << length * sizeof(double) << ")"
+                  << (sums[0] == sums[1] && sums[1] == sums[2] ? "" : " (MISMATCH)") << std::endl;
+    }
+}
+
+// y = a * x + b * z: очистка и два прохода Axpy против одного слитого
+// прохода выражения.
+void performance_test_sparse_expressions(int length) {
+    UnqPtr<IDictionary<int, double>> xDictionary(new BTree<int, double>());
+    UnqPtr<IDictionary<int, double>> zDictionary(new BTree<int, double>());
+    UnqPtr<IDictionary<int, double>> yDictionary(new BTree<int, double>());
+    SparseVector<double> x(length, std::move(xDictionary));
+    SparseVector<double> z(length, std::move(zDictionary));
+    SparseVector<double> y(length, std::move(yDictionary));
+    std::mt19937 gen(47);
+    for (int i = 0; i < length / 10; ++i) {
+        x.SetElement(static_cast<int>(gen() % length), 1.0 + gen() % 9);
+        z.SetElement(static_cast<int>(gen() % length), 1.0 + gen() % 9);
+    }
+    const double a = 2.0;
+    const double b = -0.5;
+
+    long long separateTime = measure_time([&]() {
+        y.Clear();
+        Axpy(a, x, y);
+        Axpy(b, z, y);
+    });
+    double separateSum = y.Reduce([](double p, double q) { return p + q; }, 0.0);
+    long long fusedTime = measure_time([&]() { y = a * x + b * z; });
+    double fusedSum = y.Reduce([](double p, double q) { return p + q; }, 0.0);
+
+    std::cout << "y = a*x + b*z over length " << length << ": Clear + two Axpy passes " << separateTime
+              << " ms, fused expression " << fusedTime << " ms"
+              << (std::abs(separateSum - fusedSum) <= 1e-9 * std::abs(separateSum) ? "" : " (MISMATCH)") << std::endl;
+
+    // y += a*x при nnz(x) много меньше nnz(y): обновление на месте против Axpy.
+    UnqPtr<IDictionary<int, double>> smallDictionary(new BTree<int, double>());
+    SparseVector<double> small(length, std::move(smallDictionary));
+    for (int i = 0; i < length / 1000; ++i)
+        small.SetElement(static_cast<int>(gen() % length), 1.0 + gen() % 9);
+    long long axpyTime = measure_time([&]() { Axpy(a, small, y); });
+    double axpySum = y.Reduce([](double p, double q) { return p + q; }, 0.0);
+    long long updateTime = measure_time([&]() { y += -a * small; });
+    double updateSum = y.Reduce([](double p, double q) { return p + q; }, 0.0);
+
+    std::cout << "y += a*x with nnz(x) = " << small.GetNonZeroCount() << ", nnz(y) = " << y.GetNonZeroCount()
+              << ": Axpy " << axpyTime << " ms, in-place expression " << updateTime << " ms"
+              << (std::abs(updateSum - fusedSum) <= 1e-9 * std::abs(axpySum) ? "" : " (MISMATCH)") << std::endl;
+}
+
+// Перенос признаков в плотный буфер весов и обратно: GetElement по каждому
+// индексу, один проход словаря и ядра CompressedSparseVector (скалярные и
+// выбранные по процессору). Всего около 20M обращений на каждый способ; при
+// большом буфере время определяют промахи кеша, а не команды.
+void performance_test_dense_exchange(int nonZeros) {
+    const int length = nonZeros * 16;
+    const int rounds = std::max(1, 20000000 / nonZeros);
+    std::mt19937 gen(11);
+    std::vector<int> pattern;
+    for (int index = 0; index < length; ++index)
+        if (gen() % 16 == 0)
+            pattern.push_back(index);
+    std::vector<double> weights(length);
+    for (int index = 0; index < length; ++index)
+        weights[index] = index % 7 + 1.0;
+
+    UnqPtr<IDictionary<int, double>> dictionary(new HashTable<int, double>());
+    SparseVector<double> hashed(length, std::move(dictionary));
+    CompressedSparseVector<double> compressed(length);
+    hashed.GatherFrom(weights.data(), pattern);
+    compressed.GatherFrom(weights.data(), pattern);
+    std::vector<double> dense(length);
+    std::vector<double> gathered(pattern.size());
+    const int *indices = compressed.Indices();
+    const double *values = compressed.Values();
+    size_t count = compressed.GetNonZeroCount();
+
+    long long perIndex = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            for (int index : pattern)
+                dense[index] += 0.5 * hashed.GetElement(index);
+    });
+    long long dictionaryPass = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            hashed.AccumulateInto(dense.data(), 0.5);
+    });
+    long long scalarGather = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            GatherDenseScalar(weights.data(), indices, count, gathered.data());
+    });
+    long long simdGather = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            GatherDense(weights.data(), indices, count, gathered.data());
+    });
+    long long scalarScatter = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            ScatterDenseScalar(indices, values, count, dense.data());
+    });
+    long long simdScatter = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            compressed.ScatterTo(dense.data());
+    });
+    long long scalarAccumulate = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            AccumulateDenseScalar(0.5, indices, values, count, dense.data());
+    });
+    long long simdAccumulate = measure_time([&]() {
+        for (int round = 0; round < rounds; ++round)
+            compressed.AccumulateInto(dense.data(), 0.5);
+    });
+
+    std::cout << "Dense exchange, " << count << " nonzeros x " << rounds << " rounds: accumulate via GetElement "
+              << perIndex << " ms, via dictionary pass " << dictionaryPass << " ms; CompressedSparseVector scalar/"
+              << (ActiveSimdInstructionSet() == SimdInstructionSet::Avx512 ? "AVX-512" :
+                  ActiveSimdInstructionSet() == SimdInstructionSet::Avx2 ? "AVX2" : "scalar")
+              << " gather " << scalarGather << "/" << simdGather << " ms, scatter " << scalarScatter << "/"
+              << simdScatter << " ms, accumulate " << scalarAccumulate << "/" << simdAccumulate << " ms" << std::endl;
+}
+
+// Пересечение разреженных векторов: Dot на HashTable, BTree и RoaringDictionary
+// для векторов одного размера и для короткого вектора против длинного, а
+// также прямое пересечение RoaringDictionary::Intersect по контейнерам.
+template <typename DictionaryType>
+void performance_test_intersection(const std::vector<int>& left, const std::vector<int>& right, int length,
+                                   const std::string& dictionary_name) {
+    UnqPtr<IDictionary<int, double>> leftDictionary(new DictionaryType());
+    UnqPtr<IDictionary<int, double>> rightDictionary(new DictionaryType());
+    SparseVector<double> a(length, std::move(leftDictionary));
+    SparseVector<double> b(length, std::move(rightDictionary));
+    for (int index : left)
+        a.SetElement(index, 1.0);
+    for (int index : right)
+        b.SetElement(index, 2.0);
+    double dot = 0;
+    long long time = measure_time([&]() { dot = Dot(a, b); });
+    std::cout << "  " << dictionary_name << ": Dot " << time << " ms (" << dot << ")" << std::endl;
+}
+
+void performance_test_roaring(int nonZeros) {
+    const int length = nonZeros * 8;
+    std::mt19937 gen(31);
+    auto sample = [&](int size) {
+        std::vector<int> indices;
+        for (int i = 0; i < size; ++i)
+            indices.push_back(static_cast<int>(gen() % length));
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        return indices;
+    };
+    std::vector<int> large = sample(nonZeros);
+    std::vector<int> other = sample(nonZeros);
+    std::vector<int> small = sample(nonZeros / 1000);
+
+    for (const auto& [name, right] : {std::pair<const char*, std::vector<int>*>{"equal sizes", &other},
+                                      std::pair<const char*, std::vector<int>*>{"1000x smaller", &small}}) {
+        std::cout << "Sparse intersection, " << large.size() << " x " << right->size() << " nonzeros (" << name
+                  << "):" << std::endl;
+        performance_test_intersection<HashTable<int, double>>(large, *right, length, "HashTable");
+        performance_test_intersection<BTree<int, double>>(large, *right, length, "BTree");
+        performance_test_intersection<RoaringDictionary<double>>(large, *right, length, "RoaringDictionary");
+
+        RoaringDictionary<double> a;
+        RoaringDictionary<double> b;
+        for (int index : large)
+            a.Add(index, 1.0);
+        for (int index : *right)
+            b.Add(index, 2.0);
+        double dot = 0;
+        long long time = measure_time([&]() {
+            RoaringDictionary<double>::Intersect(a, b, [&dot](int, const double& x, const double& y) { dot += x * y; });
+        });
+        std::cout << "  RoaringDictionary::Intersect " << time << " ms (" << dot << "), "
+                  << a.GetMemoryBytes() << " bytes for " << a.GetCount() << " entries (keys and values alone "
+                  << a.GetCount() * (sizeof(int) + sizeof(double)) << ")" << std::endl;
+    }
+
+    // Map и обнуление идут через изменяемый итератор словаря.
+    std::cout << "SparseVector Map and MultiplyByScalar(0) over " << large.size() << " nonzeros:" << std::endl;
+    auto mapAndClear = [&]<typename TDictionary>(const char* dictionaryName) {
+        UnqPtr<IDictionary<int, double>> dictionary(new TDictionary());
+        SparseVector<double> vector(length, std::move(dictionary));
+        for (int index : large)
+            vector.SetElement(index, 1.0);
+        long long mapTime = measure_time([&]() { vector.Map([](double x) { return 3.0 * x; }); });
+        long long clearTime = measure_time([&]() { vector.MultiplyByScalar(0.0); });
+        std::cout << "  " << dictionaryName << ": Map " << mapTime << " ms, MultiplyByScalar(0) " << clearTime
+                  << " ms" << (vector.GetNonZeroCount() == 0 ? "" : " (NOT CLEARED)") << std::endl;
+    };
+    mapAndClear.template operator()<BTree<int, double>>("BTree");
+    mapAndClear.template operator()<RoaringDictionary<double>>("RoaringDictionary");
+
+    // Плотные диапазоны признаков: серии вместо битовых карт.
+    RoaringDictionary<double> ranges;
+    for (int start = 0; start < length; start += 4096)
+        for (int index = start; index < start + 1024; ++index)
+            ranges.Add(index, 1.0);
+    size_t before = ranges.GetMemoryBytes();
+    ranges.RunOptimize();
+    std::cout << "RoaringDictionary with " << ranges.GetCount() << " keys in 1024-wide ranges: " << before
+              << " bytes, after RunOptimize " << ranges.GetMemoryBytes() << " bytes" << std::endl;
+}
+
+double add_doubles(double a, double b) {
+    return a + b;
+}
+
+// Стоимость одного элемента в Reduce со сложением: через стёртый тип
+// (std::function, как было раньше) и с лямбдой, встраиваемой в цикл.
+template <typename TVector>
+void performance_test_reduce_callback(const TVector& vector, size_t nonZeros, const std::string& name) {
+    const int repeats = 10;
+    std::function<double(double, double)> erased = add_doubles;
+    double erasedSum = 0;
+    double inlinedSum = 0;
+    long long erasedTime = measure_time([&]() {
+        for (int r = 0; r < repeats; ++r)
+            erasedSum += vector.Reduce(erased, 0.0);
+    });
+    long long inlinedTime = measure_time([&]() {
+        for (int r = 0; r < repeats; ++r)
+            inlinedSum += vector.Reduce([](double a, double b) { return a + b; }, 0.0);
+    });
+    double perElement = 1e6 / (static_cast<double>(nonZeros) * repeats);
+    std::cout << name << " Reduce(+): std::function " << erasedTime * perElement << " ns/element, lambda "
+              << inlinedTime * perElement << " ns/element" << (erasedSum == inlinedSum ? "" : " (MISMATCH)")
+              << std::endl;
+}
+
+void performance_test_reduce_callbacks(int nonZeros) {
+    UnqPtr<IDictionary<int, double>> hashed(new HashTable<int, double>());
+    UnqPtr<IDictionary<int, double>> ordered(new BTree<int, double>());
+    SparseVector<double> hashedVector(nonZeros, std::move(hashed));
+    SparseVector<double> orderedVector(nonZeros, std::move(ordered));
+    CompressedSparseVector<double> compressedVector(nonZeros);
+    for (int index = 0; index < nonZeros; ++index) {
+        hashedVector.SetElement(index, index % 10 + 1.0);
+        orderedVector.SetElement(index, index % 10 + 1.0);
+        compressedVector.SetElement(index, index % 10 + 1.0);
+    }
+
+    performance_test_reduce_callback(hashedVector, nonZeros, "SparseVector<HashTable>");
+    performance_test_reduce_callback(orderedVector, nonZeros, "SparseVector<BTree>");
+    performance_test_reduce_callback(compressedVector, nonZeros, "CompressedSparseVector");
+}
+
+template <typename DictionaryType>
+void performance_test_parallel_vector(int nonZeros, const std::string& dictionary_name) {
+    UnqPtr<IDictionary<int, double>> dictionary(new DictionaryType());
+    SparseVector<double> vector(nonZeros, std::move(dictionary));
+    for (int index = 0; index < nonZeros; ++index)
+        vector.SetElement(index, index % 100 + 1.0);
+
+    auto scale = [](double x) { return x * 1.000001; };
+    auto add = [](double a, double b) { return a + b; };
+    long long serialMap = measure_time([&]() { vector.Map(scale); });
+    long long parallelMap = measure_time([&]() { vector.ParallelMap(scale); });
+    double serialSum = 0;
+    double parallelSum = 0;
+    long long serialReduce = measure_time([&]() { serialSum = vector.Reduce(add, 0.0); });
+    long long parallelReduce = measure_time([&]() { parallelSum = vector.ParallelReduce(add, 0.0); });
+
+    std::cout << dictionary_name << " with " << nonZeros << " nonzeros on " << ThreadPool::Shared().GetConcurrency()
+              << " threads: Map " << serialMap << " ms, ParallelMap " << parallelMap << " ms, Reduce "
+              << serialReduce << " ms, ParallelReduce " << parallelReduce << " ms"
+              << (std::abs(serialSum - parallelSum) <= 1e-9 * std::abs(serialSum) ? "" : " (MISMATCH)") << std::endl;
+}
+
+void performance_test_parallel_sparse_vector(int nonZeros) {
+    performance_test_parallel_vector<HashTable<int, double>>(nonZeros, "HashTable");
+    performance_test_parallel_vector<BTree<int, double>>(nonZeros, "BTree");
+}
+
+template<typename TKey, int Order>
+long long performance_test_btree_order(const std::vector<TKey>& keys) {
+    BTree<TKey, double, Order> tree;
+    long long elapsed = measure_time([&]() {
+        for (const TKey& key : keys)
+            tree.Add(key, 1.0);
+        double sum = 0;
+        for (const TKey& key : keys)
+            sum += tree.Get(key);
+        volatile double sink = sum;
+        (void)sink;
+    });
+    BTreeMetrics metrics = tree.GetMetrics();
+    std::cout << "  order " << metrics.order << ": height " << metrics.height << ", fill " << metrics.fillFactor
+              << ", bytes/entry " << metrics.bytesPerEntry << ", comparisons/lookup "
+              << metrics.comparisonsPerLookup << std::endl;
+    return elapsed;
+}
+
+template<typename TKey>
+void choose_btree_order(const std::vector<TKey>& keys, const std::string& key_name) {
+    const int orders[] = {4, 8, 16, 32, 64};
+    const long long times[] = {
+            performance_test_btree_order<TKey, 4>(keys),
+            performance_test_btree_order<TKey, 8>(keys),
+            performance_test_btree_order<TKey, 16>(keys),
+            performance_test_btree_order<TKey, 32>(keys),
+            performance_test_btree_order<TKey, 64>(keys)
+    };
+    long long runtime_time = performance_test_btree_order<TKey, 0>(keys);
+    std::cout << "BTree<" << key_name << "> runtime order 3: " << runtime_time << " ms" << std::endl;
+
+    int best = 0;
+    for (int i = 0; i < 5; ++i) {
+        std::cout << "BTree<" << key_name << "> order " << orders[i] << ": " << times[i] << " ms" << std::endl;
+        if (times[i] < times[best])
+            best = i;
+    }
+    std::cout << "Best compile-time order for " << key_name << ": " << orders[best] << std::endl;
+}
+
+void performance_test_btree_orders(int num_keys) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dis(0, num_keys * 10);
+
+    std::vector<int> int_keys;
+    std::vector<IndexPair> pair_keys;
+    for (int i = 0; i < num_keys; ++i) {
+        int_keys.push_back(dis(gen));
+        pair_keys.emplace_back(dis(gen) % 5000, dis(gen) % 5000);
+    }
+
+    choose_btree_order(int_keys, "int");
+    choose_btree_order(pair_keys, "IndexPair");
+}
+
+template<typename TDictionary>
+void performance_test_ingest(TDictionary& dictionary, const std::vector<int>& keys, const std::string& name) {
+    long long insertion_time = measure_time([&]() {
+        for (int key : keys)
+            dictionary.Add(key, 1.0);
+    });
+    double sum = 0;
+    long long search_time = measure_time([&]() {
+        for (int key : keys)
+            sum += dictionary.Get(key);
+    });
+    std::cout << name << " random ingest: insert " << insertion_time << " ms, search " << search_time
+              << " ms (" << sum << " hits)" << std::endl;
+}
+
+// Пакетная вставка случайных ключей: B^ε-дерево против обычных BTree.
+void performance_test_bepsilon_ingest(int num_keys) {
+    std::mt19937 gen(7);
+    std::vector<int> keys(num_keys);
+    for (int& key : keys)
+        key = static_cast<int>(gen());
+
+    BTree<int, double> btree;
+    performance_test_ingest(btree, keys, "BTree");
+    BTree<int, double, 16> btree16;
+    performance_test_ingest(btree16, keys, "BTree<16>");
+    BEpsilonTree<int, double> bepsilon;
+    performance_test_ingest(bepsilon, keys, "BEpsilonTree");
+}
+
+// Сборка матрицы построчно: ключи приходят по возрастанию и вставляются
+// через палец без спуска от корня.
+void performance_test_btree_sorted_ingest(int rows, int columns) {
+    BTree<IndexPair, double, 16> sorted;
+    long long sorted_time = measure_time([&]() {
+        for (int row = 0; row < rows; ++row)
+            for (int column = 0; column < columns; ++column)
+                sorted.Add(IndexPair(row, column), 1.0);
+    });
+
+    std::vector<IndexPair> shuffled;
+    shuffled.reserve(static_cast<size_t>(rows) * columns);
+    for (int row = 0; row < rows; ++row)
+        for (int column = 0; column < columns; ++column)
+            shuffled.emplace_back(row, column);
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+
+    BTree<IndexPair, double, 16> random;
+    long long random_time = measure_time([&]() {
+        for (const IndexPair& key : shuffled)
+            random.Add(key, 1.0);
+    });
+
+    std::cout << "BTree row-major ingest of " << sorted.GetCount() << " keys: " << sorted_time
+              << " ms, shuffled: " << random_time << " ms" << std::endl;
+}
+
+// Сложение двух разреженных векторов: поэлементный Add против слияния за
+// O(m + n) и его параллельного варианта.
+void performance_test_btree_merge(int num_keys) {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> dis(0, num_keys * 4);
+    BTree<int, double, 16> a, b;
+    for (int i = 0; i < num_keys; ++i) {
+        a.Add(dis(gen), 1.0);
+        b.Add(dis(gen), 2.0);
+    }
+
+    size_t naive_count = 0;
+    long long naive_time = measure_time([&]() {
+        BTree<int, double, 16> sum;
+        a.ForEach([&](int key, double value) { sum.Add(key, value); });
+        b.ForEach([&](int key, double value) { sum[key] += value; });
+        naive_count = sum.GetCount();
+    });
+
+    size_t merge_count = 0, parallel_count = 0;
+    auto add = [](double x, double y) { return x + y; };
+    long long merge_time = measure_time([&]() { merge_count = Merge(a, b, add)->GetCount(); });
+    long long parallel_time = measure_time([&]() { parallel_count = ParallelMerge(a, b, add)->GetCount(); });
+
+    std::cout << "BTree sum of two vectors (" << naive_count << " keys): Add " << naive_time << " ms, Merge "
+              << merge_time << " ms, ParallelMerge " << parallel_time << " ms" << std::endl;
+    if (merge_count != naive_count || parallel_count != naive_count)
+        std::cerr << "Error: BTree merge produced " << merge_count << " and " << parallel_count << " keys." << std::endl;
+}
+
 std::vector<int> read_test_sizes(const std::string& filename) {
     std::vector<int> sizes;
     std::ifstream file(filename);
@@ -287,6 +2264,15 @@ void performance_tests() {
 
             performance_test_vector<BTree<int, double>>(size, "BTree", log_file);
             std::cout << "Completed BTree vector test for size: " << size << std::endl;
+
+            performance_test_vector<BEpsilonTree<int, double>>(size, "BEpsilonTree", log_file);
+            std::cout << "Completed BEpsilonTree vector test for size: " << size << std::endl;
+
+            performance_test_vector<AdaptiveRadixTree<int, double>>(size, "AdaptiveRadixTree", log_file);
+            std::cout << "Completed AdaptiveRadixTree vector test for size: " << size << std::endl;
+
+            performance_test_compressed_vector(size, log_file);
+            std::cout << "Completed CompressedSparseVector vector test for size: " << size << std::endl;
         } else {
             std::cout << "Running matrix tests for size: " << size << std::endl;
             performance_test_matrix<HashTable<IndexPair, double>>(size, "HashTable", log_file);
@@ -294,9 +2280,30 @@ void performance_tests() {
 
             performance_test_matrix<BTree<IndexPair, double>>(size, "BTree", log_file);
             std::cout << "Completed BTree matrix test for size: " << size << std::endl;
+
+            performance_test_matrix<AdaptiveRadixTree<IndexPair, double>>(size, "AdaptiveRadixTree", log_file);
+            std::cout << "Completed AdaptiveRadixTree matrix test for size: " << size << std::endl;
         }
     }
 
     log_file.close();
+
+    performance_test_concurrent_btree(1000000, 2000000);
+    performance_test_concurrent_skip_list(1000000);
+    performance_test_btree_orders(200000);
+    performance_test_bepsilon_ingest(1000000);
+    performance_test_btree_sorted_ingest(2000, 1000);
+    performance_test_btree_merge(2000000);
+    performance_test_learned_index(1000000);
+    performance_test_eytzinger(1000000);
+    performance_test_sparse_vector_ops(10000000);
+    performance_test_parallel_sparse_vector(2000000);
+    performance_test_reduce_callbacks(1000000);
+    performance_test_adaptive_vector(4000000);
+    performance_test_sparse_expressions(2000000);
+    performance_test_dense_exchange(16384);
+    performance_test_dense_exchange(1000000);
+    performance_test_roaring(1000000);
+
     std::cout << "Performance tests completed. Results saved in performance_results.csv" << std::endl;
 }
@@ -9,6 +9,43 @@ void run_tests();
 void functional_tests();
 void performance_tests();
 std::vector<int> read_test_sizes(const std::string& filename);
+void test_compressed_sparse_vector();
+void test_adaptive_sparse_vector();
+void test_sparse_vector_ops();
+void test_sparse_expressions();
+void test_wide_index_sparse_vector();
+void test_dense_exchange();
+void test_roaring_dictionary();
+void test_sparse_vector_map();
+void test_parallel_sparse_vector();
+void test_concurrent_btree_stress();
+void test_concurrent_skip_list_stress();
+void test_btree_snapshot();
+void test_btree_order_statistics();
+void test_btree_upsert_erase();
+void test_bepsilon_tree_count();
+void test_adaptive_radix_tree_layouts();
+void test_btree_set_operations();
+void test_btree_metrics();
+void test_learned_index();
+void test_eytzinger_dictionary();
+void test_paged_btree();
+void performance_test_compressed_vector(int size, std::ostream& log_stream);
+void performance_test_concurrent_btree(int keyCount, int operations);
+void performance_test_concurrent_skip_list(int keyCount);
+void performance_test_btree_orders(int num_keys);
+void performance_test_bepsilon_ingest(int num_keys);
+void performance_test_btree_sorted_ingest(int rows, int columns);
+void performance_test_btree_merge(int num_keys);
+void performance_test_learned_index(int num_keys);
+void performance_test_eytzinger(int num_keys);
+void performance_test_sparse_vector_ops(int length);
+void performance_test_parallel_sparse_vector(int nonZeros);
+void performance_test_reduce_callbacks(int nonZeros);
+void performance_test_adaptive_vector(int length);
+void performance_test_sparse_expressions(int length);
+void performance_test_dense_exchange(int nonZeros);
+void performance_test_roaring(int nonZeros);
 
 template <typename DictionaryType, typename KeyType, typename ValueType>
 void test_dictionary(const std::string& dictionary_name);